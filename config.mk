@@ -1,10 +1,17 @@
 # Building
 
-CFLAGS_COMMON	= -Wall
+# Float representation -- IEEE double by default (16-byte instances);
+# define OVM_FLOAT_LONG_DOUBLE for x87 long double (32-byte instances)
+
+CFLAGS_FLOAT	=
+#CFLAGS_FLOAT	= -DOVM_FLOAT_LONG_DOUBLE
+
+CFLAGS_COMMON	= -Wall $(CFLAGS_FLOAT)
 
 CFLAGS_DEBUG	= $(CFLAGS_COMMON) -g
 
-CFLAGS_CPP_OPT	= -DNDEBUG
+CFLAGS_CPP_DEBUG = $(CFLAGS_FLOAT)
+CFLAGS_CPP_OPT	= -DNDEBUG $(CFLAGS_FLOAT)
 CFLAGS_OPT	= $(CFLAGS_COMMON) -O3
 
 CFLAGS_PROFILE	= $(CFLAGS_OPT) -pg
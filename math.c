@@ -3,12 +3,20 @@
  * math module
  * 
  * - Add methods for math functions and constants to Float class
+ * - Functions follow the Float representation, i.e. sqrt() for double,
+ *   sqrtl() for long double (OVM_FLOAT_LONG_DOUBLE)
+ * - Add the same functions to Int64array and Float64array, applied to
+ *   every element, giving a new Float64array; large arrays are split
+ *   among threads
  *
  ***************************************************************************/
 
 #include "oovm.h"
+#include "oovm_vec.h"
 
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #define METHOD_MODULE  math
 #define METHOD_CLASS   Float
@@ -19,65 +27,280 @@
 
 CM_DECL(acos)
 {
-  MF(acosl);
+  MF(OVM_FLOATVAL_FUNC(acos));
 }
 
 CM_DECL(asin)
 {
-  MF(asinl);
+  MF(OVM_FLOATVAL_FUNC(asin));
 }
 
 CM_DECL(atan)
 {
-  MF(atanl);
+  MF(OVM_FLOATVAL_FUNC(atan));
 }
 
 CM_DECL(atan2)
 {
   ovm_method_argc_chk_exact(th, 2);
-  ovm_float_newc(dst, atan2l(ovm_inst_floatval(th, &argv[0]), ovm_inst_floatval(th, &argv[1])));
+  ovm_float_newc(dst, OVM_FLOATVAL_FUNC(atan2)(ovm_inst_floatval(th, &argv[0]), ovm_inst_floatval(th, &argv[1])));
 }
 
 CM_DECL(cos)
 {
-  MF(cosl);
+  MF(OVM_FLOATVAL_FUNC(cos));
 }
 
 CM_DECL(sin)
 {
-  MF(sinl);
+  MF(OVM_FLOATVAL_FUNC(sin));
 }
 
 CM_DECL(tan)
 {
-  MF(tanl);
+  MF(OVM_FLOATVAL_FUNC(tan));
 }
 
 CM_DECL(exp)
 {
-  MF(expl);
+  MF(OVM_FLOATVAL_FUNC(exp));
 }
 
 CM_DECL(exp10)
 {
-  MF(exp10l);
+  MF(OVM_FLOATVAL_FUNC(exp10));
 }
 
 CM_DECL(log)
 {
-  MF(logl);
+  MF(OVM_FLOATVAL_FUNC(log));
 }
 
 CM_DECL(log10)
 {
-  MF(log10l);
+  MF(OVM_FLOATVAL_FUNC(log10));
 }
 
 CM_DECL(sqrt)
 {
-  MF(sqrtl);
+  MF(OVM_FLOATVAL_FUNC(sqrt));
 }
 
+/***************************************************************************/
+
+/* Elementwise functions over Int64array and Float64array
+
+   The result is always a Float64array, computed in double whatever the
+   Float representation, since that is what the elements are.  An
+   Int64array is first converted into the result, which the function is
+   then applied to in place.  sqrt is a vectorized kernel; the rest are
+   libm calls in a native loop.  With more than VMATH_MIN_SIZE elements,
+   the work is split into chunks of at least VMATH_MIN_CHUNK, one per
+   thread, up to the number of CPUs online, or the optional argument.
+*/
+
+#define VMATH_MIN_SIZE     (1 << 16)
+#define VMATH_MIN_CHUNK    (1 << 14)
+#define VMATH_THREADS_MAX  64
+
+/* In math_vec.c, which, unlike this file, is compiled with -fno-math-errno */
+
+void math_vec_sqrt(unsigned n, double *r, const double *a);
+
+struct vmath_ctxt {
+  double   (*f)(double);        /* 0 => sqrt */
+  unsigned nthreads, n;
+  double   *data;
+};
+
+struct vmath_worker {
+  struct vmath_ctxt *ctxt;
+  unsigned          idx;
+  bool              startedf;
+  pthread_t         id;
+};
+
+static void vmath_chunk(struct vmath_ctxt *ctxt, unsigned idx)
+{
+  unsigned lo = (unsigned) ((unsigned long long) ctxt->n * idx / ctxt->nthreads);
+  unsigned hi = (unsigned) ((unsigned long long) ctxt->n * (idx + 1) / ctxt->nthreads);
+  double *p = &ctxt->data[lo];
+  unsigned n = hi - lo;
+  if (ctxt->f == 0) {
+    math_vec_sqrt(n, p, p);
+
+    return;
+  }
+  double (*f)(double) = ctxt->f;
+  for (; n > 0; --n, ++p)  *p = (*f)(*p);
+}
+
+static void *vmath_worker_entry(void *arg)
+{
+  struct vmath_worker *w = (struct vmath_worker *) arg;
+  vmath_chunk(w->ctxt, w->idx);
+
+  return (0);
+}
+
+/* Calling thread does chunk 0, and any chunk whose thread did not start */
+
+static void vmath_run(struct vmath_ctxt *ctxt)
+{
+  struct vmath_worker workers[VMATH_THREADS_MAX];
+  unsigned i;
+  for (i = 1; i < ctxt->nthreads; ++i) {
+    workers[i].ctxt = ctxt;
+    workers[i].idx  = i;
+    workers[i].startedf = pthread_create(&workers[i].id, 0, vmath_worker_entry, &workers[i]) == 0;
+  }
+  vmath_chunk(ctxt, 0);
+  for (i = 1; i < ctxt->nthreads; ++i) {
+    if (workers[i].startedf) {
+      pthread_join(workers[i].id, 0);
+    } else {
+      vmath_chunk(ctxt, i);
+    }
+  }
+}
+
+static void vmath(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, double (*f)(double))
+{
+  ovm_method_argc_chk_range(th, 1, 2);
+  ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+  unsigned n = a->size;
+
+  long nthreads;
+  if (argc > 1) {
+    ovm_intval_t k = ovm_inst_intval(th, &argv[1]);
+    if (k < 1)  ovm_except_inv_value(th, &argv[1]);
+    nthreads = k > VMATH_THREADS_MAX ? VMATH_THREADS_MAX : k;
+  } else {
+    nthreads = n < VMATH_MIN_SIZE ? 1 : sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > VMATH_THREADS_MAX)  nthreads = VMATH_THREADS_MAX;
+  }
+  if (nthreads > n / VMATH_MIN_CHUNK)  nthreads = n / VMATH_MIN_CHUNK;
+  if (nthreads < 1)  nthreads = 1;
+
+  ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+  ovm_inst_assign_obj(&work[-2], ovm_consts.Float64array);
+  ovm_int_newc(&work[-1], n);
+  ovm_method_callsch(th, &work[-2], OVM_STR_CONST_HASH(new), 2);
+  ovm_obj_numarray_t r = ovm_inst_numarrayval_nochk(&work[-2]);
+  if (ovm_obj_inst_of_raw(a->base) == OVM_CL_FLOAT64ARRAY) {
+    memcpy(r->f64, a->f64, n * sizeof(r->f64[0]));
+  } else {
+    ovm_vec_i64_to_f64(n, r->f64, a->i64);
+  }
+
+  struct vmath_ctxt ctxt[1];
+  ctxt->f        = f;
+  ctxt->nthreads = nthreads;
+  ctxt->n        = n;
+  ctxt->data     = r->f64;
+  vmath_run(ctxt);
+
+  ovm_inst_assign(dst, &work[-2]);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Float64array
+
+CM_DECL(acos)
+{
+  vmath(th, dst, argc, argv, acos);
+}
+
+CM_DECL(asin)
+{
+  vmath(th, dst, argc, argv, asin);
+}
+
+CM_DECL(atan)
+{
+  vmath(th, dst, argc, argv, atan);
+}
+
+CM_DECL(cos)
+{
+  vmath(th, dst, argc, argv, cos);
+}
+
+CM_DECL(sin)
+{
+  vmath(th, dst, argc, argv, sin);
+}
+
+CM_DECL(tan)
+{
+  vmath(th, dst, argc, argv, tan);
+}
+
+CM_DECL(exp)
+{
+  vmath(th, dst, argc, argv, exp);
+}
+
+CM_DECL(exp10)
+{
+  vmath(th, dst, argc, argv, exp10);
+}
+
+CM_DECL(log)
+{
+  vmath(th, dst, argc, argv, log);
+}
+
+CM_DECL(log10)
+{
+  vmath(th, dst, argc, argv, log10);
+}
+
+CM_DECL(sqrt)
+{
+  vmath(th, dst, argc, argv, 0);
+}
+
+/***************************************************************************/
+
+static void vmath_methods_add(ovm_thread_t th, ovm_obj_t cl)
+{
+  ovm_stack_push_obj(th, cl);
+
+  ovm_method_add(th, OVM_STR_CONST_HASH(acos),  METHOD_NAME(acos));
+  ovm_method_add(th, OVM_STR_CONST_HASH(asin),  METHOD_NAME(asin));
+  ovm_method_add(th, OVM_STR_CONST_HASH(atan),  METHOD_NAME(atan));
+  ovm_method_add(th, OVM_STR_CONST_HASH(cos),   METHOD_NAME(cos));
+  ovm_method_add(th, OVM_STR_CONST_HASH(sin),   METHOD_NAME(sin));
+  ovm_method_add(th, OVM_STR_CONST_HASH(tan),   METHOD_NAME(tan));
+  ovm_method_add(th, OVM_STR_CONST_HASH(exp),   METHOD_NAME(exp));
+  ovm_method_add(th, OVM_STR_CONST_HASH(exp10), METHOD_NAME(exp10));
+  ovm_method_add(th, OVM_STR_CONST_HASH(log),   METHOD_NAME(log));
+  ovm_method_add(th, OVM_STR_CONST_HASH(log10), METHOD_NAME(log10));
+  ovm_method_add(th, OVM_STR_CONST_HASH(sqrt),  METHOD_NAME(sqrt));
+
+  ovm_stack_free(th, 1);
+}
+
+static void vmath_methods_del(ovm_obj_class_t cl)
+{
+  ovm_method_del(cl, OVM_STR_CONST_HASH(acos));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(asin));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(atan));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(cos));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(sin));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(tan));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(exp));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(exp10));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(log));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(log10));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(sqrt));
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Float
+
 void __math_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv)
 {
   ovm_inst_t old = th->sp;
@@ -97,6 +320,9 @@ void __math_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t ar
   ovm_method_add(th, OVM_STR_CONST_HASH(log10), METHOD_NAME(log10));
   ovm_method_add(th, OVM_STR_CONST_HASH(sqrt),  METHOD_NAME(sqrt));
 
+  vmath_methods_add(th, ovm_consts.Int64array);
+  vmath_methods_add(th, ovm_consts.Float64array);
+
   ovm_stack_alloc(th, 2);
   ovm_inst_t w = th->sp;
 
@@ -125,4 +351,7 @@ void __math_fini__(void)
   ovm_method_del(OVM_CL_FLOAT, OVM_STR_CONST_HASH(log));
   ovm_method_del(OVM_CL_FLOAT, OVM_STR_CONST_HASH(log10));
   ovm_method_del(OVM_CL_FLOAT, OVM_STR_CONST_HASH(sqrt));
+
+  vmath_methods_del(OVM_CL_INT64ARRAY);
+  vmath_methods_del(OVM_CL_FLOAT64ARRAY);
 }
@@ -0,0 +1,25 @@
+/***************************************************************************
+ *
+ * math module -- vectorized kernels
+ *
+ * - Compiled apart from math.c, with -fno-math-errno, so that sqrt() can
+ *   be inlined and vectorized here without changing errno handling for
+ *   the libm calls in the rest of the module
+ *
+ ***************************************************************************/
+
+#include "oovm_vec.h"
+
+/* Negative elements give NaN */
+
+OVM_VEC_KERNEL void
+vmath_sqrt_kernel(unsigned n, double *r, const double *a)
+{
+  unsigned i;
+  for (i = 0; i < n; ++i)  r[i] = __builtin_sqrt(a[i]);
+}
+
+void math_vec_sqrt(unsigned n, double *r, const double *a)
+{
+  vmath_sqrt_kernel(n, r, a);
+}
@@ -17,11 +17,13 @@
 
 #include "oovm.h"
 #include "oovm_hash.h"
+#include "oovm_vec.h"
 
 #include <ctype.h>
 #include <dlfcn.h>
 #include <link.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 /***************************************************************************/
 
@@ -126,7 +128,8 @@ void ovm_thread_fatal(ovm_thread_t th, unsigned line, unsigned exit_code, const
     ++th->fatal_lvl;
     if (th->fatal_lvl == 1)  backtrace(th);
     
-    if (th == main_thread)  exit(exit_code);
+    /* A coroutine has no pthread of its own to exit */
+    if (th == main_thread || th->co != 0)  exit(exit_code);
     pthread_exit((void *)(intptr_t) exit_code);
 }
 
@@ -395,6 +398,16 @@ void ovm_mem_free(void *ptr, unsigned size)
     mem_unlock();
 }
 
+/* Usable size of the buffer ovm_mem_alloc() returns for a request of the given size */
+
+static inline unsigned mem_alloc_size(unsigned size)
+{
+    if (size > ovm_mem_max_buf_size)  return (bytes_page_align(size));
+    unsigned result;
+    for (result = OVM_MEM_MIN_BUF_SIZE; result < size; result <<= 1);
+    return (result);
+}
+
 static void mem_init(void)
 {
     mem_page_size      = sysconf(_SC_PAGE_SIZE);
@@ -420,6 +433,7 @@ static struct ovm_dllist _obj_list[2], *obj_list_white = &_obj_list[0], *obj_lis
 
 pthread_mutex_t ovm_objs_mutex[1];
 static pthread_mutexattr_t obj_mutex_attr[1];
+__thread unsigned _ovm_locks_held;
 
 static void objs_init(void)
 {
@@ -494,9 +508,35 @@ ovm_obj_t ovm_obj_alloc(ovm_inst_t dst, unsigned size, ovm_obj_class_t cl, int m
     return (result);
 }
 
+/* Test if the object in recvr is referenced only by recvr and dst, i.e. the
+   result is about to overwrite every reference to it.  Nothing else can see
+   such an object, so an operation can update it in place rather than build a
+   copy.
+*/
+
+static bool inst_unique_owner(ovm_inst_t dst, ovm_inst_t recvr)
+{
+    ovm_obj_t obj = recvr->objval;
+    unsigned n = 1;
+    if (dst != recvr) {
+        if (dst->type != OVM_INST_TYPE_OBJ || dst->objval != obj)  return (false);
+        n = 2;
+    }
+    
+    _ovm_objs_lock();
+
+    bool result = (obj->ref_cnt == n);
+
+    _ovm_objs_unlock();
+
+    return (result);
+}
+
 static inline int _obj_lock(ovm_obj_t obj)
 {
-    return (pthread_mutex_lock(obj->mutex));
+    int result = pthread_mutex_lock(obj->mutex);
+    if (result == 0)  ++_ovm_locks_held;
+    return (result);
 }
 
 static inline void obj_lock(ovm_obj_t obj)
@@ -523,10 +563,12 @@ static inline void obj_lock_loop_chk(ovm_thread_t th, ovm_obj_t obj)
 static inline void obj_unlock(ovm_obj_t obj)
 {
     pthread_mutex_unlock(obj->mutex);
+    --_ovm_locks_held;
 }
 
 struct ovm_consts ovm_consts;
 static ovm_obj_t ns_main;
+static ovm_obj_t str_chars[1 + 256]; /* Shared strings; [0] is "", [1 + c] is the 1-character string c */
 static struct ovm_dllist thread_list[1];
 
 static void collect(void)
@@ -551,6 +593,10 @@ static void collect(void)
             }
         }
         ovm_obj_mark(ns_main);
+        {
+            unsigned n;
+            for (n = 0; n < ARRAY_SIZE(str_chars); ++n)  ovm_obj_mark(str_chars[n]);
+        }
         for (p = ovm_dllist_first(thread_list); p != ovm_dllist_end(thread_list); p = ovm_dllist_next(p)) {
             ovm_thread_t th = FIELD_PTR_TO_STRUCT_PTR(p, struct ovm_thread, list_node);
             ovm_inst_t q;
@@ -576,11 +622,23 @@ static void collect(void)
 
 /* Frame management */
 
+/* The last bytes of a frame stack are kept for handling an overflow -- a
+   nesting too deep raises an exception, and catching it, or reporting it
+   uncaught, calls methods in turn; only running out of the reserve is fatal
+*/
+
+enum { FRAME_STACK_RESERVE = 512 };
+
+static void except_frame_stack_overflow(ovm_thread_t th);
+
 static struct ovm_frame *frame_push(ovm_thread_t th, unsigned type, unsigned size)
 {
     unsigned char *p = (unsigned char *) th->fp - size;
-    if (p < th->frame_stack) {
-        OVM_THREAD_FATAL(th, OVM_THREAD_FATAL_FRAME_STACK_OVERFLOW, 0);
+    if (p < th->frame_stack + FRAME_STACK_RESERVE) {
+        if (th->except_lvl == 0)  except_frame_stack_overflow(th);
+        if (p < th->frame_stack) {
+            OVM_THREAD_FATAL(th, OVM_THREAD_FATAL_FRAME_STACK_OVERFLOW, 0);
+        }
     }
     struct ovm_frame *fr = (struct ovm_frame *) p;
     fr->type = type;
@@ -664,12 +722,13 @@ static ovm_obj_class_t class_up(ovm_thread_t th, unsigned n)
 struct __jmp_buf_tag *ovm_frame_except_push(ovm_thread_t th, ovm_inst_t arg)
 {
     struct ovm_frame_except *fr = (struct ovm_frame_except *) frame_push(th, OVM_FRAME_TYPE_EXCEPTION, sizeof(*fr));
-    fr->arg       = arg;
-    fr->arg_valid = false;
-    fr->sp        = th->sp;
-    fr->pc        = th->pc;
-    fr->prev      = th->xfp;
-    th->xfp       = fr;
+    fr->arg        = arg;
+    fr->arg_valid  = false;
+    fr->sp         = th->sp;
+    fr->pc         = th->pc;
+    fr->locks_held = _ovm_locks_held;
+    fr->prev       = th->xfp;
+    th->xfp        = fr;
     return (fr->jb);
 }
 
@@ -768,27 +827,32 @@ static void method_run(ovm_thread_t th, ovm_inst_t dst, ovm_obj_ns_t ns, ovm_obj
 
 static pthread_key_t pthread_key_self;
 
+void ovm_thread_run(ovm_thread_t th, ovm_inst_t top)
+{
+    ovm_inst_t sp = th->sp, dst = &top[-3];
+    method_run(th, dst, ovm_inst_nsval_nochk(&top[-1]), 0, &top[-2], dst - sp, sp);
+}
+
 void *ovm_thread_entry(void *arg)
 {
     ovm_thread_t th = (ovm_thread_t) arg;
-    
+
+    th->id = pthread_self();    /* Creator may not have set it yet */
     pthread_setspecific(pthread_key_self, th);
 
-    ovm_inst_t sp = th->sp, top = th->stack_top, dst = &top[-3];
-    method_run(th, dst, ovm_inst_nsval_nochk(&top[-1]), 0, &top[-2], dst - sp, sp);
+    ovm_inst_t dst = &th->stack_top[-3];
+    ovm_thread_run(th, th->stack_top);
 
     pthread_exit((void *)(intptr_t)(dst->type == OVM_INST_TYPE_INT ? dst->intval : 0));
 }
 
-static void pthread_destructor(void *p)
+void ovm_thread_destroy(ovm_thread_t th)
 {
-    ovm_thread_t th = (ovm_thread_t) p;
-
     _ovm_objs_lock();
 
     ovm_dllist_erase(th->list_node);    
     ovm_inst_t q;
-    for (q = th->sp; q > th->stack_top; ++q)  ovm_inst_release(q);
+    for (q = th->sp; q < th->stack_top; ++q)  ovm_inst_release(q);
 
     _ovm_objs_unlock();
     
@@ -797,6 +861,33 @@ static void pthread_destructor(void *p)
     ovm_mem_free(th, sizeof(*th));
 }
 
+static void pthread_destructor(void *p)
+{
+    ovm_thread_destroy((ovm_thread_t) p);
+}
+
+void ovm_thread_self_set(ovm_thread_t th)
+{
+    pthread_setspecific(pthread_key_self, th);
+}
+
+int ovm_thread_io_wait(ovm_thread_t th, int fd, unsigned events)
+{
+    return (th->io_wait == 0 ? -1 : (*th->io_wait)(th, fd, events));
+}
+
+static void (*io_close_hook)(int fd);
+
+void ovm_thread_io_close_hook_set(void (*hook)(int fd))
+{
+    io_close_hook = hook;
+}
+
+void ovm_thread_io_close(int fd)
+{
+    if (io_close_hook != 0)  (*io_close_hook)(fd);
+}
+
 static ovm_thread_t threading_init(unsigned stack_size, unsigned frame_stack_size)
 {
     pthread_key_create(&pthread_key_self, pthread_destructor);
@@ -814,18 +905,49 @@ static ovm_thread_t threading_init(unsigned stack_size, unsigned frame_stack_siz
 
 /* Clists */
 
-struct clist_buf_hdr {
+/* A clist is a list of buffers, each sized double the previous one, up to
+   CLIST_BUF_SIZE_MAX, so that building a long string costs a logarithmic
+   number of allocations.
+*/
+
+struct clist_buf {
     struct ovm_dllist list_node[1];
-    unsigned        len;
+    unsigned          size;     /* Size of buffer, including this header */
+    unsigned          len;      /* Number of bytes of data used */
+    char              data[0];
 };
 
-#define MEM_MIN_BLK_SIZE  64
-
-struct clist_buf {
-    struct clist_buf_hdr hdr[1];
-    char                 data[MEM_MIN_BLK_SIZE - sizeof(struct clist_buf_hdr)];
+enum {
+    CLIST_BUF_SIZE_MAX = 64 * 1024
 };
 
+static inline struct clist_buf *clist_buf(struct ovm_dllist *p)
+{
+    return (FIELD_PTR_TO_STRUCT_PTR(p, struct clist_buf, list_node));
+}
+
+static struct clist_buf *clist_buf_new(struct ovm_clist *cl, unsigned n)
+{
+    unsigned size = OVM_MEM_MIN_BUF_SIZE;
+    struct ovm_dllist *p = ovm_dllist_last(cl->buf_list);
+    if (p != ovm_dllist_end(cl->buf_list)) {
+        size = clist_buf(p)->size << 1;
+        if (size > CLIST_BUF_SIZE_MAX)  size = CLIST_BUF_SIZE_MAX;
+    }
+    if (size < sizeof(struct clist_buf) + n) {
+        size = sizeof(struct clist_buf) + n;
+        if (size > CLIST_BUF_SIZE_MAX)  size = CLIST_BUF_SIZE_MAX;
+    }
+    size = mem_alloc_size(size);
+    
+    struct clist_buf *result = (struct clist_buf *) ovm_mem_alloc(size, OVM_MEM_ALLOC_NO_HINT, false);
+    result->size = size;
+    result->len  = 0;
+    ovm_dllist_insert(result->list_node, ovm_dllist_end(cl->buf_list));
+
+    return (result);
+}
+
 void ovm_clist_init(struct ovm_clist *cl)
 {
     ovm_dllist_init(cl->buf_list);
@@ -841,21 +963,20 @@ void ovm_clist_appendc(struct ovm_clist *cl, unsigned n, const char *s)
     struct clist_buf *q;
     struct ovm_dllist *p = ovm_dllist_last(cl->buf_list);
     if (p != ovm_dllist_end(cl->buf_list)) {
-        q = FIELD_PTR_TO_STRUCT_PTR(FIELD_PTR_TO_STRUCT_PTR(p, struct clist_buf_hdr, list_node), struct clist_buf, hdr);
-        k = sizeof(q->data) - q->hdr->len;
+        q = clist_buf(p);
+        k = q->size - sizeof(*q) - q->len;
         if (n < k)  k = n;
-        memcpy(q->data + q->hdr->len, s, k);
-        q->hdr->len += k;
+        memcpy(q->data + q->len, s, k);
+        q->len += k;
         n -= k;
         s += k;
     }
     while (n > 0) {
-        q = (struct clist_buf *) ovm_mem_alloc(OVM_MEM_MIN_BUF_SIZE, 0, false);
-        ovm_dllist_insert(q->hdr->list_node, ovm_dllist_end(cl->buf_list));
-        k = sizeof(q->data);
+        q = clist_buf_new(cl, n);
+        k = q->size - sizeof(*q);
         if (n < k)  k = n;
         memcpy(q->data, s, k);
-        q->hdr->len = k;
+        q->len = k;
         n -= k;
         s += k;
     }
@@ -882,8 +1003,8 @@ unsigned ovm_clist_to_barray(unsigned buf_size, unsigned char *buf, struct ovm_c
     struct ovm_dllist *p;
     unsigned rem = buf_size;
     for (p = ovm_dllist_first(cl->buf_list); rem > 0 && p != ovm_dllist_end(cl->buf_list); p = ovm_dllist_next(p)) {
-        struct clist_buf *q = FIELD_PTR_TO_STRUCT_PTR(FIELD_PTR_TO_STRUCT_PTR(p, struct clist_buf_hdr, list_node), struct clist_buf, hdr);
-        unsigned n = q->hdr->len;
+        struct clist_buf *q = clist_buf(p);
+        unsigned n = q->len;
         if (n > rem)  n = rem;
         memcpy(buf, q->data, n);
         buf += n;
@@ -898,8 +1019,8 @@ void ovm_clist_concat(struct ovm_clist *cl1, struct ovm_clist *cl2)
 {
     struct ovm_dllist *p;
     for (p = ovm_dllist_first(cl2->buf_list); p != ovm_dllist_end(cl2->buf_list); p = ovm_dllist_next(p)) {
-        struct clist_buf *q = FIELD_PTR_TO_STRUCT_PTR(FIELD_PTR_TO_STRUCT_PTR(p, struct clist_buf_hdr, list_node), struct clist_buf, hdr);
-        ovm_clist_appendc(cl1, q->hdr->len + 1, q->data);
+        struct clist_buf *q = clist_buf(p);
+        ovm_clist_appendc(cl1, q->len + 1, q->data);
     }
     
 }
@@ -909,7 +1030,8 @@ void ovm_clist_fini(struct ovm_clist *cl)
     while (!ovm_dllist_empty(cl->buf_list)) {
         struct ovm_dllist *p = ovm_dllist_first(cl->buf_list);
         ovm_dllist_erase(p);
-        ovm_mem_free(FIELD_PTR_TO_STRUCT_PTR(FIELD_PTR_TO_STRUCT_PTR(p, struct clist_buf_hdr, list_node), struct clist_buf, hdr), OVM_MEM_MIN_BUF_SIZE);
+        struct clist_buf *q = clist_buf(p);
+        ovm_mem_free(q, q->size);
     }
     cl->len = 0;
 }
@@ -1003,6 +1125,10 @@ static void except_longjmp(ovm_thread_t th, struct ovm_frame_except *xfr, ovm_in
     frame_unwind(th, xfr->base);
     ovm_stack_unwind(th, xfr->sp);
     th->pc = xfr->pc;
+    /* Locks taken since the try are not released by an exception -- don't
+       hold them against the handler
+    */
+    _ovm_locks_held = xfr->locks_held;
     th->exceptf = true;
     longjmp(xfr->jb, 1);
 }
@@ -1271,6 +1397,30 @@ void ovm_except_descent_loop(ovm_thread_t th)
     except_raise2(th, &work[-1]);
 }
 
+__attribute__((noreturn))
+void _ovm_except_stack_overflow(ovm_thread_t th)
+{
+    except_raise1(th);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    except_newc(th, &work[-1], _OVM_STR_CONST("system.stack-overflow"));
+
+    except_raise2(th, &work[-1]);
+}
+
+__attribute__((noreturn))
+static void except_frame_stack_overflow(ovm_thread_t th)
+{
+    except_raise1(th);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    except_newc(th, &work[-1], _OVM_STR_CONST("system.frame-stack-overflow"));
+
+    except_raise2(th, &work[-1]);
+}
+
 /***************************************************************************/
 
 /* Constructors, internal class functions, desctructors */
@@ -1308,9 +1458,19 @@ static void str_newv_obj_init(ovm_obj_t obj, va_list ap)
     *p = 0;
 }
 
+static inline ovm_obj_str_t str_newv_capacity(ovm_inst_t dst, unsigned capacity, unsigned size, unsigned n, struct ovm_str_newv_item *a) /* Safe */
+{
+    return (ovm_obj_str(ovm_obj_alloc(dst, sizeof(*ovm_obj_str(0)) + capacity * sizeof(ovm_obj_str(0)->data[0]), OVM_CL_STRING, OVM_MEM_ALLOC_NO_HINT, str_newv_obj_init, size, n, a)));
+}
+
 static inline ovm_obj_str_t str_newv_size(ovm_inst_t dst, unsigned size, unsigned n, struct ovm_str_newv_item *a) /* Safe */
 {
-    return (ovm_obj_str(ovm_obj_alloc(dst, sizeof(*ovm_obj_str(0)) + size * sizeof(ovm_obj_str(0)->data[0]), OVM_CL_STRING, OVM_MEM_ALLOC_NO_HINT, str_newv_obj_init, size, n, a)));
+    return (str_newv_capacity(dst, size, size, n, a));
+}
+
+static inline unsigned str_capacity(ovm_obj_str_t s)
+{
+    return (mem_alloc_size(s->base->size) - sizeof(*s));
 }
 
 static void str_newc_obj_init(ovm_obj_t obj, va_list ap)
@@ -1328,14 +1488,22 @@ static ovm_obj_str_t str_newc(ovm_inst_t dst, unsigned size, const char *data) /
 {
     DEBUG_ASSERT(size > 0);
 
+    if (size <= 2 && str_chars[0] != 0) {
+        /* Strings are immutable, so empty and 1-character strings are shared */
+
+        ovm_obj_t obj = str_chars[size == 1 ? 0 : 1 + (unsigned char) data[0]];
+        ovm_inst_assign_obj(dst, obj);
+        return (ovm_obj_str(obj));
+    }
+    
     return (ovm_obj_str(ovm_obj_alloc(dst, sizeof(*ovm_obj_str(0)) + size * sizeof(ovm_obj_str(0)->data[0]), OVM_CL_STRING, OVM_MEM_ALLOC_NO_HINT, str_newc_obj_init, size, data)));
 }
 
 static ovm_obj_str_t str_newch(ovm_inst_t dst, unsigned size, const char *data, unsigned hash) /* Safe */
 {
     ovm_obj_str_t result = str_newc(dst, size, data);
-    dst->hash = hash;
-    dst->hash_valid = true;
+    result->hash       = hash;
+    result->hash_valid = true;
 
     return (result);
 }
@@ -1353,6 +1521,13 @@ static void str_newcl_obj_init(ovm_obj_t obj, va_list ap)
 
 static ovm_obj_str_t str_new_clist(ovm_inst_t dst, struct ovm_clist *cl)
 {
+    if (cl->len <= 1) {
+        char buf[2];
+        ovm_clist_to_barray(cl->len, (unsigned char *) buf, cl);
+        buf[cl->len] = 0;
+        return (str_newc(dst, cl->len + 1, buf));
+    }
+    
     unsigned data_size = cl->len + 1;
     return (ovm_obj_str(ovm_obj_alloc(dst, sizeof(*ovm_obj_str(0)) + data_size * sizeof(ovm_obj_str(0)->data[0]), OVM_CL_STRING, OVM_MEM_ALLOC_NO_HINT, str_newcl_obj_init, data_size, cl)));
 }
@@ -1687,14 +1862,34 @@ static void array_mark(ovm_obj_t obj)
     array_walk(obj, ovm_inst_mark);
 }
 
+/* An Array's elements are stored in the object itself, until it is grown
+   past what the object's buffer holds; then they move to a separate buffer,
+   so that the Array object itself never moves.  Elements past size, up to
+   capacity, are always nil.
+*/
+
+static void array_cleanup(ovm_obj_t obj)
+{
+    ovm_obj_array_t a = ovm_obj_array(obj);
+    if (a->data != a->buf)  ovm_mem_free(a->data, a->capacity * sizeof(a->data[0]));
+}
+
 static void array_free(ovm_obj_t obj)
 {
     array_walk(obj, ovm_inst_release);
+    array_cleanup(obj);
+}
+
+static inline void array_buf_init(ovm_obj_array_t a)
+{
+    a->data     = a->buf;
+    a->capacity = (mem_alloc_size(a->base->size) - sizeof(*a)) / sizeof(a->buf[0]);
 }
 
 static void array_obj_init(ovm_obj_t obj, va_list ap)
 {
     ovm_obj_array_t a = ovm_obj_array(obj);
+    array_buf_init(a);
     a->size = va_arg(ap, unsigned);
     memset(a->data, 0, a->size * sizeof(a->data[0]));
 }
@@ -1719,20 +1914,36 @@ static inline ovm_obj_array_t array_copy(ovm_inst_t dst, ovm_obj_class_t cl, ovm
     return (array_slicec(dst, cl, a, 0, a->size));
 }
 
+/* Get element i, if the Array still has one -- for loops that call methods
+   on the elements, which may change the Array, moving its elements if it
+   grows, so the elements are re-read, and the size re-checked, each time
+*/
+
+static bool array_elem(ovm_inst_t dst, ovm_obj_array_t a, unsigned i)
+{
+    _ovm_objs_lock();
+
+    bool result = (i < a->size);
+    if (result)  _ovm_inst_assign_nolock(dst, &a->data[i]);
+
+    _ovm_objs_unlock();
+
+    return (result);
+}
+
 static ovm_obj_array_t array_copydeep_unsafe(ovm_thread_t th, ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_array_t a)
 {
     obj_lock_loop_chk(th, a->base);
     
     ovm_obj_array_t aa = array_newc(dst, cl, a->size, 0);
-    ovm_inst_t p, q;
-    unsigned n;
+    unsigned i;
     
     ovm_inst_t work = ovm_stack_alloc(th, 1);
     
-    for (p = a->data, q = aa->data, n = a->size; n > 0; --n, ++p, ++q) {
-        ovm_inst_assign(&work[-1], p);
-        ovm_method_callsch(th, q, OVM_STR_CONST_HASH(copydeep), 1);
+    for (i = 0; i < aa->size && array_elem(&work[-1], a, i); ++i) {
+        ovm_method_callsch(th, &aa->data[i], OVM_STR_CONST_HASH(copydeep), 1);
     }
+    aa->size = i;               /* In case a shrank; the rest are nil */
     
     ovm_stack_unwind(th, work);
 
@@ -1741,6 +1952,111 @@ static ovm_obj_array_t array_copydeep_unsafe(ovm_thread_t th, ovm_inst_t dst, ov
     return (aa);
 }
 
+/* Largest capacity, such that the size in bytes, even page-aligned, fits in
+   an unsigned
+*/
+
+#define ARRAY_CAPACITY_MAX  ((~0U >> 1) / sizeof(struct ovm_inst))
+
+/* Make room for at least the given number of elements, at least doubling
+   the capacity, so that growing an Array one element at a time is amortized
+   O(1); false if that is too many.  Callers check the size, and grow and
+   fill the Array, all under the lock, since other threads may be doing the
+   same.
+*/
+
+static bool _array_reserve_nolock(ovm_obj_array_t a, unsigned capacity) /* Lock already held */
+{
+    if (capacity <= a->capacity)  return (true);
+    if (capacity > ARRAY_CAPACITY_MAX)  return (false);
+    if (capacity < (a->capacity << 1))  capacity = a->capacity << 1;
+    if (capacity > ARRAY_CAPACITY_MAX)  capacity = ARRAY_CAPACITY_MAX;
+    unsigned size = mem_alloc_size(capacity * sizeof(a->data[0]));
+    ovm_inst_t p = (ovm_inst_t) ovm_mem_alloc(size, OVM_MEM_ALLOC_NO_HINT, true);
+    memcpy(p, a->data, a->size * sizeof(a->data[0]));
+    if (a->data != a->buf)  ovm_mem_free(a->data, a->capacity * sizeof(a->data[0]));
+    a->data     = p;
+    a->capacity = size / sizeof(a->data[0]);
+
+    return (true);
+}
+
+static void array_reserve(ovm_thread_t th, ovm_inst_t inst, unsigned capacity)
+{
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(inst);
+
+    _ovm_objs_lock();
+
+    bool f = _array_reserve_nolock(a, capacity);
+
+    _ovm_objs_unlock();
+
+    if (!f)  ovm_except_inv_value(th, inst);
+}
+
+static void array_concat_obj_init(ovm_obj_t obj, va_list ap) /* Lock already held */
+{
+    ovm_obj_array_t a = ovm_obj_array(obj);
+    array_buf_init(a);
+    unsigned n;
+    for (n = 2; n > 0; --n) {
+        ovm_obj_array_t aa = va_arg(ap, ovm_obj_array_t);
+        ovm_inst_t p, q;
+        unsigned k;
+        for (p = &a->data[a->size], q = aa->data, k = aa->size; k > 0; --k, ++p, ++q) {
+            _ovm_inst_assign_nolock_norelease(p, q);
+        }
+        a->size += aa->size;
+    }
+}
+
+static inline ovm_obj_array_t array_concat(ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_array_t a1, ovm_obj_array_t a2, unsigned capacity) /* Safe */
+{
+    return (ovm_obj_array(ovm_obj_alloc(dst, sizeof(*ovm_obj_array(0)) + capacity * sizeof(ovm_obj_array(0)->data[0]), cl, OVM_MEM_ALLOC_NO_HINT, array_concat_obj_init, a1, a2)));
+}
+
+/* Append in place */
+
+static void array_append(ovm_thread_t th, ovm_inst_t inst, ovm_obj_array_t aa)
+{
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(inst);
+
+    _ovm_objs_lock();
+
+    unsigned n = aa->size, k;   /* aa may be a */
+    if (!_array_reserve_nolock(a, a->size + n)) {
+        _ovm_objs_unlock();
+
+        ovm_except_inv_value(th, inst);
+    }
+    ovm_inst_t p, q;
+    for (p = &a->data[a->size], q = aa->data, k = n; k > 0; --k, ++p, ++q) {
+        _ovm_inst_assign_nolock_norelease(p, q);
+    }
+    a->size += n;
+    
+    _ovm_objs_unlock();
+}
+
+/* Append one element in place */
+
+static void array_push(ovm_thread_t th, ovm_inst_t inst, ovm_inst_t val)
+{
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(inst);
+
+    _ovm_objs_lock();
+
+    if (!_array_reserve_nolock(a, a->size + 1)) {
+        _ovm_objs_unlock();
+
+        ovm_except_inv_value(th, inst);
+    }
+    _ovm_inst_assign_nolock_norelease(&a->data[a->size], val);
+    ++a->size;
+
+    _ovm_objs_unlock();
+}
+
 static void barray_obj_init(ovm_obj_t obj, va_list ap)
 {
     ovm_obj_barray_t b = ovm_obj_barray(obj);
@@ -1759,6 +2075,11 @@ static inline ovm_obj_barray_t barray_newc(ovm_inst_t dst, ovm_obj_class_t cl, u
     return (ovm_obj_barray(ovm_obj_alloc(dst, sizeof(*ovm_obj_barray(0)) + data_size * sizeof(ovm_obj_barray(0)->data[0]), cl, OVM_MEM_ALLOC_NO_HINT, barray_obj_init, data_size, data)));
 }
 
+void ovm_bytearray_newc(ovm_inst_t dst, unsigned size, unsigned char *data)
+{
+    barray_newc(dst, OVM_CL_BYTEARRAY, size, data);
+}
+
 static void bytearr_cl_obj_init(ovm_obj_t obj, va_list ap)
 {
     ovm_obj_barray_t b = ovm_obj_barray(obj);
@@ -1782,98 +2103,555 @@ static inline ovm_obj_barray_t barray_copy(ovm_inst_t dst, ovm_obj_class_t cl, o
     return (barray_slicec(dst, cl, b, 0, b->size));
 }
 
-static void slice_mark(ovm_obj_t obj)
+static inline unsigned barray_capacity(ovm_obj_barray_t b)
 {
-    ovm_obj_mark(ovm_obj_slice(obj)->underlying);
+    return ((mem_alloc_size(b->base->size) - sizeof(*b)) / sizeof(b->data[0]));
 }
 
-static void slice_free(ovm_obj_t obj)
+static void barray_concat_obj_init(ovm_obj_t obj, va_list ap)
 {
-    ovm_obj_release(ovm_obj_slice(obj)->underlying);
+    ovm_obj_barray_t b = ovm_obj_barray(obj);
+    unsigned n;
+    for (n = 2; n > 0; --n) {
+        ovm_obj_barray_t bb = va_arg(ap, ovm_obj_barray_t);
+        memcpy(&b->data[b->size], bb->data, bb->size);
+        b->size += bb->size;
+    }
 }
 
-static void slice_obj_init(ovm_obj_t obj, va_list ap)
+static inline ovm_obj_barray_t barray_concat(ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_barray_t b1, ovm_obj_barray_t b2, unsigned capacity) /* Safe */
 {
-    _ovm_obj_assign_nolock_norelease(&ovm_obj_slice(obj)->underlying, va_arg(ap, ovm_obj_t));
+    return (ovm_obj_barray(ovm_obj_alloc(dst, sizeof(*ovm_obj_barray(0)) + capacity * sizeof(ovm_obj_barray(0)->data[0]), cl, OVM_MEM_ALLOC_NO_HINT, barray_concat_obj_init, b1, b2)));
 }
 
-static ovm_obj_slice_t slice_new(ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_t underlying, unsigned ofs, unsigned size)
-{
-    ovm_obj_slice_t result = ovm_obj_slice(ovm_obj_alloc(dst, sizeof(*ovm_obj_slice(0)), cl, 1, slice_obj_init, underlying));
-    result->ofs  = ofs;
-    result->size = size;
+/* Sorting
+   
+   Stable, adaptive merge sort, after timsort: the input is split into
+   natural runs (strictly descending runs are reversed), short runs are
+   extended to a minimum length with binary insertion sort, and runs are
+   merged so that pending run lengths keep the timsort invariants.
 
-    return (result);
-}
+   Sorting works on a private copy of the instances, which holds no
+   references, and the result is assigned back at the end, so a comparison
+   that raises an exception leaves the Array as it was.  A comparison may
+   also change the Array; the result is then still assigned back, to the
+   Array's current storage, unless its size has changed, in which case
+   system.invalid-value is raised.  Arrays of all Integers, all Floats or
+   all Strings are compared inline; otherwise each comparison calls either
+   the given comparator, as comparator.call(a, b), or a.cmp(b), which must
+   return an Integer.
+*/
 
-static void set_walk(ovm_obj_set_t s, void (*func)(ovm_obj_t))
+struct sort_ctxt {
+    ovm_thread_t th;
+    void         (*sort)(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n);
+    ovm_inst_t   cmp_method;    /* Comparator, or 0 */
+    ovm_inst_t   work;          /* Scratch, for calling methods */
+    ovm_inst_t   tmp;           /* Merge buffer */
+};
+
+typedef int (*sort_cmp_t)(struct sort_ctxt *ctxt, ovm_inst_t a, ovm_inst_t b);
+
+static int sort_cmp_int(struct sort_ctxt *ctxt, ovm_inst_t a, ovm_inst_t b)
 {
-    ovm_obj_t *p;
-    unsigned  n;
-    for (p = s->data, n = s->size; n > 0; --n, ++p)  (*func)(*p);
+    return ((a->intval > b->intval) - (a->intval < b->intval));
 }
 
-static void set_mark(ovm_obj_t s)
+static int sort_cmp_float(struct sort_ctxt *ctxt, ovm_inst_t a, ovm_inst_t b)
 {
-    set_walk(ovm_obj_set(s), ovm_obj_mark);
+    return ((a->floatval > b->floatval) - (a->floatval < b->floatval));
 }
 
-static void set_free(ovm_obj_t s)
+static int sort_cmp_str(struct sort_ctxt *ctxt, ovm_inst_t a, ovm_inst_t b)
 {
-    set_walk(ovm_obj_set(s), ovm_obj_release);
+    return (strcmp(ovm_inst_strval_nochk(a)->data, ovm_inst_strval_nochk(b)->data));
 }
 
-static void set_obj_init(ovm_obj_t obj, va_list ap)
+static int sort_cmp_method(struct sort_ctxt *ctxt, ovm_inst_t a, ovm_inst_t b)
 {
-    static pthread_mutexattr_t mutex_attr[1];
-    static bool initf = false;
-    if (!initf) {
-        pthread_mutexattr_init(mutex_attr);
-        pthread_mutexattr_settype(mutex_attr, PTHREAD_MUTEX_ERRORCHECK);
-        initf = true;
+    ovm_thread_t th = ctxt->th;
+    ovm_inst_t work = ctxt->work;
+    ovm_intval_t result;
+    if (ctxt->cmp_method != 0) {
+        ovm_inst_assign(&work[0], ctxt->cmp_method);
+        ovm_inst_assign(&work[1], a);
+        ovm_inst_assign(&work[2], b);
+        ovm_method_callsch(th, &work[3], OVM_STR_CONST_HASH(call), 3);
+    } else {
+        ovm_inst_assign(&work[0], a);
+        ovm_inst_assign(&work[1], b);
+        ovm_method_callsch(th, &work[3], OVM_STR_CONST_HASH(cmp), 2);
     }
+    result = ovm_inst_intval(th, &work[3]);
 
-    ovm_obj_set_t s = ovm_obj_set(obj);
-    unsigned size = va_arg(ap, unsigned);
-    s->size = size;
-    memset(s->data, 0, size * sizeof(s->data[0]));
+    return ((result > 0) - (result < 0));
 }
 
-static ovm_obj_set_t set_newc(ovm_inst_t dst, ovm_obj_class_t cl, unsigned size)
+static void sort_reverse(ovm_inst_t lo, ovm_inst_t hi)
 {
-    size = round_up_to_power_of_2(size);
-    return (ovm_obj_set(ovm_obj_alloc(dst, sizeof(*ovm_obj_set(0)) + size * sizeof(ovm_obj_set(0)->data[0]), cl, OVM_MEM_ALLOC_NO_HINT, set_obj_init, size)));
+    struct ovm_inst t[1];
+    for (--hi; lo < hi; ++lo, --hi) {
+        memcpy(t, lo, sizeof(*t));
+        memcpy(lo, hi, sizeof(*lo));
+        memcpy(hi, t, sizeof(*hi));
+    }
 }
 
-static bool class_ats(ovm_inst_t dst, ovm_obj_class_t cl, unsigned size, const char *data, unsigned hash);
+/* Sort v[0, n) by binary insertion, given v[0, k) is already sorted */
 
-static unsigned class_default_size(ovm_thread_t th, ovm_obj_class_t cl, unsigned default_size)
+__attribute__((always_inline))
+static inline void sort_insertion(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned k, unsigned n, sort_cmp_t cmp)
 {
-    unsigned result = default_size;
-
-    ovm_inst_t work = ovm_stack_alloc(th, 1);
-    
-    if (class_ats(&work[-1], cl, _OVM_STR_CONST_HASH("default-size"))) {
-        if (work[-1].type == OVM_INST_TYPE_INT) {
-            unsigned n = work[-1].intval;
-            if (n > 0)  result = n;
+    struct ovm_inst x[1];
+    for (; k < n; ++k) {
+        memcpy(x, &v[k], sizeof(*x));
+        unsigned a = 0, b = k;
+        while (a < b) {
+            unsigned i = (a + b) >> 1;
+            if ((*cmp)(ctxt, x, &v[i]) < 0) {
+                b = i;
+            } else {
+                a = i + 1;
+            }
         }
+        memmove(&v[a + 1], &v[a], (k - a) * sizeof(*v));
+        memcpy(&v[a], x, sizeof(*x));
     }
+}
 
-    ovm_stack_unwind(th, work);
+/* Return the length of the run starting at v[0], making it ascending */
+
+__attribute__((always_inline))
+static inline unsigned sort_run(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n, sort_cmp_t cmp)
+{
+    if (n < 2)  return (n);
+    unsigned result = 2;
+    if ((*cmp)(ctxt, &v[1], &v[0]) < 0) {
+        for (; result < n && (*cmp)(ctxt, &v[result], &v[result - 1]) < 0; ++result);
+        sort_reverse(v, &v[result]);
+    } else {
+        for (; result < n && (*cmp)(ctxt, &v[result], &v[result - 1]) >= 0; ++result);
+    }
 
     return (result);
 }
 
-static ovm_obj_set_t set_copy_unsafe(ovm_thread_t th, ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_set_t s) /* Shallow copy */
+static unsigned sort_min_run(unsigned n)
 {
-    obj_lock_loop_chk(th, s->base);
+    unsigned r = 0;
+    for (; n >= 64; n >>= 1)  r |= n & 1;
+    return (n + r);
+}
 
-    ovm_obj_set_t ss = set_newc(dst, cl, s->size);
+/* Merge adjacent sorted runs v[0, k) and v[k, n), buffering the shorter one */
 
-    ovm_inst_t work = ovm_stack_alloc(th, 1);
-    
-    ovm_obj_t *p, *q;
+__attribute__((always_inline))
+static inline void sort_merge(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned k, unsigned n, sort_cmp_t cmp)
+{
+    if ((*cmp)(ctxt, &v[k], &v[k - 1]) >= 0)  return; /* Already in order */
+
+    /* Elements of the left run not greater than v[k] are already in place */
+    unsigned a = 0, b = k - 1;
+    while (a < b) {
+        unsigned i = (a + b) >> 1;
+        if ((*cmp)(ctxt, &v[k], &v[i]) < 0) {
+            b = i;
+        } else {
+            a = i + 1;
+        }
+    }
+    v += a;
+    k -= a;
+    n -= a;
+
+    ovm_inst_t tmp = ctxt->tmp;
+    if (k <= n - k) {
+        memcpy(tmp, v, k * sizeof(*v));
+        unsigned i = 0, j = k, d = 0;
+        while (i < k && j < n) {
+            if ((*cmp)(ctxt, &v[j], &tmp[i]) < 0) {
+                memcpy(&v[d++], &v[j++], sizeof(*v));
+            } else {
+                memcpy(&v[d++], &tmp[i++], sizeof(*v));
+            }
+        }
+        memcpy(&v[d], &tmp[i], (k - i) * sizeof(*v));
+
+        return;
+    }
+
+    unsigned i = k, j = n - k, d = n;
+    memcpy(tmp, &v[k], j * sizeof(*v));
+    while (i > 0 && j > 0) {
+        if ((*cmp)(ctxt, &tmp[j - 1], &v[i - 1]) < 0) {
+            memcpy(&v[--d], &v[--i], sizeof(*v));
+        } else {
+            memcpy(&v[--d], &tmp[--j], sizeof(*v));
+        }
+    }
+    memcpy(v, tmp, j * sizeof(*v));
+}
+
+__attribute__((always_inline))
+static inline void sort_insts(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n, sort_cmp_t cmp)
+{
+    enum { RUNS_MAX = 85 };
+    struct {
+        unsigned ofs, len;
+    } runs[RUNS_MAX];
+    unsigned nruns = 0, ofs, min_run = sort_min_run(n);
+    
+    for (ofs = 0; ofs < n; ) {
+        unsigned rem = n - ofs, len = sort_run(ctxt, &v[ofs], rem, cmp);
+        if (len < min_run) {
+            unsigned k = min_run < rem ? min_run : rem;
+            sort_insertion(ctxt, &v[ofs], len, k, cmp);
+            len = k;
+        }
+        runs[nruns].ofs = ofs;
+        runs[nruns].len = len;
+        ++nruns;
+        ofs += len;
+
+        /* Merge pending runs, to keep their lengths decreasing faster than the Fibonacci numbers */
+        while (nruns > 1) {
+            unsigned i = nruns - 2;
+            if ((i > 0 && runs[i - 1].len <= runs[i].len + runs[i + 1].len)
+                || (i > 1 && runs[i - 2].len <= runs[i - 1].len + runs[i].len)
+                ) {
+                if (runs[i - 1].len < runs[i + 1].len)  --i;
+            } else if (runs[i].len > runs[i + 1].len && ofs < n) {
+                break;
+            }
+            sort_merge(ctxt, &v[runs[i].ofs], runs[i].len, runs[i].len + runs[i + 1].len, cmp);
+            runs[i].len += runs[i + 1].len;
+            if (i + 2 < nruns)  runs[i + 1] = runs[i + 2];
+            --nruns;
+        }
+    }
+}
+
+/* Instances of the sort, with comparisons inlined */
+
+static void sort_insts_int(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n)
+{
+    sort_insts(ctxt, v, n, sort_cmp_int);
+}
+
+static void sort_insts_float(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n)
+{
+    sort_insts(ctxt, v, n, sort_cmp_float);
+}
+
+static void sort_insts_str(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n)
+{
+    sort_insts(ctxt, v, n, sort_cmp_str);
+}
+
+static void sort_insts_method(struct sort_ctxt *ctxt, ovm_inst_t v, unsigned n)
+{
+    sort_insts(ctxt, v, n, sort_cmp_method);
+}
+
+static void sort_ctxt_init(struct sort_ctxt *ctxt, ovm_thread_t th, unsigned n, ovm_inst_t data, ovm_inst_t cmp_method)
+{
+    ctxt->th         = th;
+    ctxt->cmp_method = cmp_method;
+    ctxt->sort       = sort_insts_method;
+    if (cmp_method == 0 && n > 0) {
+        ovm_obj_class_t cl = ovm_inst_of_raw(data);
+        if (cl == OVM_CL_INTEGER) {
+            ctxt->sort = sort_insts_int;
+        } else if (cl == OVM_CL_FLOAT) {
+            ctxt->sort = sort_insts_float;
+        } else if (cl == OVM_CL_STRING) {
+            ctxt->sort = sort_insts_str;
+        }
+        for (++data, --n; ctxt->sort != sort_insts_method && n > 0; --n, ++data) {
+            if (ovm_inst_of_raw(data) != cl)  ctxt->sort = sort_insts_method;
+        }
+    }
+}
+
+/* Sort an Array in place */
+
+static void sort(ovm_thread_t th, ovm_inst_t inst, ovm_inst_t cmp_method)
+{
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(inst);
+    unsigned n = a->size;
+    if (n < 2)  return;
+
+    ovm_inst_t work = ovm_stack_alloc(th, 7);
+
+    /* Other threads may change the Array meanwhile, so sort from a copy,
+       taken under the lock; the copy also keeps the elements alive, while
+       comparisons run arbitrary code
+    */
+    ovm_obj_array_t c = array_newc(&work[-3], OVM_CL_ARRAY, n, 0);
+
+    _ovm_objs_lock();
+
+    if (a->size < n)  c->size = n = a->size;
+    unsigned k;
+    for (k = 0; k < n; ++k)  _ovm_inst_assign_nolock(&c->data[k], &a->data[k]);
+
+    _ovm_objs_unlock();
+
+    ovm_inst_t data = c->data;
+
+    struct sort_ctxt ctxt[1];
+    sort_ctxt_init(ctxt, th, n, data, cmp_method);
+
+    /* work[-7 .. -4] are for calling comparison methods */
+    ovm_obj_barray_t v = barray_newc(&work[-1], OVM_CL_BYTEARRAY, n * sizeof(*data), (unsigned char *) data);
+    ctxt->tmp  = (ovm_inst_t) barray_newc(&work[-2], OVM_CL_BYTEARRAY, (n >> 1) * sizeof(*data), 0)->data;
+    ctxt->work = &work[-7];
+    (*ctxt->sort)(ctxt, (ovm_inst_t) v->data, n);
+
+    _ovm_objs_lock();
+
+    if (a->size != n) {
+        /* Resized by a comparison */
+
+        _ovm_objs_unlock();
+
+        ovm_except_inv_value(th, inst);
+    }
+    data = a->data;             /* May have been moved by a comparison */
+
+    /* v holds no references, and an old element may be held only by the
+       slot about to be overwritten -- so retain all of the sorted elements
+       before releasing any of the old ones
+    */
+
+    ovm_inst_t p;
+    for (p = (ovm_inst_t) v->data, k = n; k > 0; --k, ++p)  ovm_inst_retain(p);
+    for (p = data, k = n; k > 0; --k, ++p)  ovm_inst_release(p);
+    memcpy(data, v->data, n * sizeof(*data));
+    
+    _ovm_objs_unlock();
+
+    ovm_stack_unwind(th, work);
+}
+
+static void slice_mark(ovm_obj_t obj)
+{
+    ovm_obj_mark(ovm_obj_slice(obj)->underlying);
+}
+
+static void slice_free(ovm_obj_t obj)
+{
+    ovm_obj_release(ovm_obj_slice(obj)->underlying);
+}
+
+static void slice_obj_init(ovm_obj_t obj, va_list ap)
+{
+    _ovm_obj_assign_nolock_norelease(&ovm_obj_slice(obj)->underlying, va_arg(ap, ovm_obj_t));
+}
+
+static ovm_obj_slice_t slice_new(ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_t underlying, unsigned ofs, unsigned size)
+{
+    ovm_obj_slice_t result = ovm_obj_slice(ovm_obj_alloc(dst, sizeof(*ovm_obj_slice(0)), cl, 1, slice_obj_init, underlying));
+    result->ofs  = ofs;
+    result->size = size;
+
+    return (result);
+}
+
+/* Byteslices are views of the bytes of a String, Bytearray or Cbytearray,
+   sharing its buffer rather than copying it.  A view of a view is made a
+   view of the original, so that views never chain.
+*/
+
+static inline bool byteslice_is(ovm_obj_class_t cl)
+{
+    return (cl == OVM_CL_BYTESLICE || cl == OVM_CL_CBYTESLICE);
+}
+
+static ovm_obj_slice_t byteslice_new(ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_t underlying, unsigned ofs, unsigned size)
+{
+    if (byteslice_is(ovm_obj_inst_of_raw(underlying))) {
+        ovm_obj_slice_t sl = ovm_obj_slice(underlying);
+        ofs += sl->ofs;
+        underlying = sl->underlying;
+    }
+
+    return (slice_new(dst, cl, underlying, ofs, size));
+}
+
+void ovm_byteslice_newc(ovm_inst_t dst, ovm_obj_t underlying, unsigned ofs, unsigned size)
+{
+    byteslice_new(dst, OVM_CL_BYTESLICE, underlying, ofs, size);
+}
+
+/* Make a view of the receiver's bytes, given no arguments or an offset and length */
+
+static void byteslice_new_args(ovm_thread_t th, ovm_inst_t dst, ovm_obj_class_t cl, unsigned argc, ovm_inst_t argv, unsigned size)
+{
+    ovm_intval_t ofs = 0, len = size;
+    switch (argc) {
+    case 1:
+        break;
+    case 3:
+        ofs = ovm_inst_intval(th, &argv[1]);
+        len = ovm_inst_intval(th, &argv[2]);
+        if (!slice(&ofs, &len, size))  ovm_except_idx_range2(th, &argv[0], &argv[1], &argv[2]);
+        break;
+    default:
+        ovm_except_num_args_range(th, 1, 3);
+    }
+    byteslice_new(dst, cl, argv[0].objval, ofs, len);
+}
+
+/* Get the bytes of a String, Bytearray, Cbytearray, Byteslice or Cbyteslice */
+
+bool ovm_inst_bytes(ovm_inst_t inst, unsigned *size, const unsigned char **data)
+{
+    if (inst->type != OVM_INST_TYPE_OBJ || inst->objval == 0)  return (false);
+    ovm_obj_t obj = inst->objval;
+    ovm_obj_class_t cl = ovm_obj_inst_of_raw(obj);
+    if (cl == OVM_CL_STRING) {
+        *size = ovm_obj_str(obj)->size - 1;
+        *data = (const unsigned char *) ovm_obj_str(obj)->data;
+    } else if (cl == OVM_CL_BYTEARRAY || cl == OVM_CL_CBYTEARRAY) {
+        *size = ovm_obj_barray(obj)->size;
+        *data = ovm_obj_barray(obj)->data;
+    } else if (byteslice_is(cl)) {
+        *size = ovm_obj_slice(obj)->size;
+        *data = ovm_byteslice_data(ovm_obj_slice(obj));
+    } else {
+        return (false);
+    }
+
+    return (true);
+}
+
+/* Byte string to search for -- bytes, or an Integer for a single byte */
+
+static void inst_needle(ovm_thread_t th, ovm_inst_t inst, unsigned char *buf, unsigned *size, const unsigned char **data)
+{
+    if (inst->type == OVM_INST_TYPE_INT) {
+        if (inst->intval < 0 || inst->intval > 255)  ovm_except_inv_value(th, inst);
+        *buf  = inst->intval;
+        *size = 1;
+        *data = buf;
+
+        return;
+    }
+    if (!ovm_inst_bytes(inst, size, data))  ovm_except_inv_value(th, inst);
+}
+
+/* Get the bytes of a Bytearray, or a Byteslice (of a Bytearray), to write */
+
+static void inst_bytes_mutable(ovm_thread_t th, ovm_inst_t inst, unsigned *size, unsigned char **data)
+{
+    ovm_obj_class_t cl = ovm_inst_of_raw(inst);
+    if (cl == OVM_CL_BYTEARRAY) {
+        *size = ovm_inst_barrayval_nochk(inst)->size;
+        *data = ovm_inst_barrayval_nochk(inst)->data;
+    } else if (cl == OVM_CL_BYTESLICE) {
+        *size = ovm_inst_sliceval_nochk(inst)->size;
+        *data = ovm_byteslice_data(ovm_inst_sliceval_nochk(inst));
+    } else {
+        ovm_except_inv_value(th, inst);
+    }
+}
+
+/* Index of first occurrence of b in a, at or after ofs, or -1 */
+
+static ovm_intval_t mem_index(unsigned a_size, const unsigned char *a, unsigned b_size, const unsigned char *b, unsigned ofs)
+{
+    if (ofs > a_size)  return (-1);
+    const unsigned char *p = b_size == 1
+        ? (const unsigned char *) memchr(a + ofs, b[0], a_size - ofs)
+        : (const unsigned char *) memmem(a + ofs, a_size - ofs, b, b_size);
+
+    return (p == 0 ? -1 : p - a);
+}
+
+/* Index of last occurrence of b in a, starting at or before ofs, or -1 */
+
+static ovm_intval_t mem_rindex(unsigned a_size, const unsigned char *a, unsigned b_size, const unsigned char *b, unsigned ofs)
+{
+    if (b_size > a_size)  return (-1);
+    if (ofs > a_size - b_size)  ofs = a_size - b_size;
+    if (b_size == 0)  return (ofs);
+    const unsigned char *p;
+    for (p = a + ofs + 1; (p = (const unsigned char *) memrchr(a, b[0], p - a)) != 0; ) {
+        if (memcmp(p, b, b_size) == 0)  return (p - a);
+    }
+
+    return (-1);
+}
+
+static void set_walk(ovm_obj_set_t s, void (*func)(ovm_obj_t))
+{
+    ovm_obj_t *p;
+    unsigned  n;
+    for (p = s->data, n = s->size; n > 0; --n, ++p)  (*func)(*p);
+}
+
+static void set_mark(ovm_obj_t s)
+{
+    set_walk(ovm_obj_set(s), ovm_obj_mark);
+}
+
+static void set_free(ovm_obj_t s)
+{
+    set_walk(ovm_obj_set(s), ovm_obj_release);
+}
+
+static void set_obj_init(ovm_obj_t obj, va_list ap)
+{
+    static pthread_mutexattr_t mutex_attr[1];
+    static bool initf = false;
+    if (!initf) {
+        pthread_mutexattr_init(mutex_attr);
+        pthread_mutexattr_settype(mutex_attr, PTHREAD_MUTEX_ERRORCHECK);
+        initf = true;
+    }
+
+    ovm_obj_set_t s = ovm_obj_set(obj);
+    unsigned size = va_arg(ap, unsigned);
+    s->size = size;
+    memset(s->data, 0, size * sizeof(s->data[0]));
+}
+
+static ovm_obj_set_t set_newc(ovm_inst_t dst, ovm_obj_class_t cl, unsigned size)
+{
+    size = round_up_to_power_of_2(size);
+    return (ovm_obj_set(ovm_obj_alloc(dst, sizeof(*ovm_obj_set(0)) + size * sizeof(ovm_obj_set(0)->data[0]), cl, OVM_MEM_ALLOC_NO_HINT, set_obj_init, size)));
+}
+
+static bool class_ats(ovm_inst_t dst, ovm_obj_class_t cl, unsigned size, const char *data, unsigned hash);
+
+static unsigned class_default_size(ovm_thread_t th, ovm_obj_class_t cl, unsigned default_size)
+{
+    unsigned result = default_size;
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+    
+    if (class_ats(&work[-1], cl, _OVM_STR_CONST_HASH("default-size"))) {
+        if (work[-1].type == OVM_INST_TYPE_INT) {
+            unsigned n = work[-1].intval;
+            if (n > 0)  result = n;
+        }
+    }
+
+    ovm_stack_unwind(th, work);
+
+    return (result);
+}
+
+static ovm_obj_set_t set_copy_unsafe(ovm_thread_t th, ovm_inst_t dst, ovm_obj_class_t cl, ovm_obj_set_t s) /* Shallow copy */
+{
+    obj_lock_loop_chk(th, s->base);
+
+    ovm_obj_set_t ss = set_newc(dst, cl, s->size);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+    
+    ovm_obj_t *p, *q;
     unsigned n;
     for (q = ss->data, p = s->data, n = s->size; n > 0; --n, ++p, ++q) {
         list_copy_unsafe(th, &work[-1], ovm_obj_list(*p));
@@ -1926,7 +2704,9 @@ static void file_mark(ovm_obj_t obj)
 static void file_cleanup(ovm_obj_t obj)
 {
     FILE *fp = ovm_obj_file(obj)->fp;
-    if (fp != 0)  fclose(fp);
+    if (fp == 0)  return;
+    ovm_thread_io_close(fileno(fp));
+    fclose(fp);
 }
 
 static void file_free(ovm_obj_t obj)
@@ -1948,6 +2728,38 @@ static ovm_obj_file_t file_new(ovm_inst_t dst, ovm_obj_str_t path, ovm_obj_str_t
     return (ovm_obj_file(ovm_obj_alloc(dst, sizeof(*ovm_obj_file(0)), OVM_CL_FILE, 1, file_obj_init, path, mode, fp)));
 }
 
+/* Read a line, of at most n characters (0 => no limit), including the
+   newline, as a String; an empty String means end of file.  Returns false
+   on error.
+*/
+
+static bool file_readln(ovm_inst_t dst, ovm_obj_file_t f, unsigned n)
+{
+    FILE *fp = f->fp;
+    bool result = true;
+    struct ovm_clist cl[1];
+    ovm_clist_init(cl);
+
+    flockfile(fp);
+
+    for (;;) {
+        int c = getc_unlocked(fp);
+        if (c == EOF) {
+            result = !ferror(fp);
+            break;
+        }
+        ovm_clist_append_char(cl, c);
+        if (c == '\n' || (n > 0 && --n == 0))  break;
+    }
+
+    funlockfile(fp);
+
+    if (result)  str_new_clist(dst, cl);
+    ovm_clist_fini(cl);
+
+    return (result);
+}
+
 void ovm_file_newc(ovm_thread_t th, ovm_inst_t dst, unsigned name_size, const char *name, unsigned mode_size, const char *mode, FILE *fp)
 {
     ovm_inst_t work = ovm_stack_alloc(th, 2);
@@ -1959,6 +2771,16 @@ void ovm_file_newc(ovm_thread_t th, ovm_inst_t dst, unsigned name_size, const ch
     ovm_stack_unwind(th, work);
 }
 
+/* A File's stream; raises an invalid value exception if the File is closed */
+
+static FILE *file_fp(ovm_thread_t th, ovm_inst_t inst)
+{
+    FILE *result = ovm_inst_fileval(th, inst)->fp;
+    if (result == 0)  ovm_except_inv_value(th, inst);
+
+    return (result);
+}
+
 static ovm_obj_file_t file_copy(ovm_inst_t dst, ovm_obj_file_t obj)
 {
     int fd = dup(fileno(obj->fp));
@@ -1969,14 +2791,77 @@ static ovm_obj_file_t file_copy(ovm_inst_t dst, ovm_obj_file_t obj)
     return (file_new(dst, ovm_obj_str(obj->filename), ovm_obj_str(obj->mode), fp));
 }
 
-static void ns_walk(ovm_obj_ns_t ns, void (*func)(ovm_obj_t))
+static void strbuilder_cleanup(ovm_obj_t obj)
 {
-    (*func)(ns->name);
-    (*func)(ns->parent);
-    (*func)(ns->dict);
+    ovm_clist_fini(ovm_obj_strbuilder(obj)->clist);
 }
 
-static void ns_mark(ovm_obj_t obj)
+static void strbuilder_obj_init(ovm_obj_t obj, va_list ap)
+{
+    ovm_clist_init(ovm_obj_strbuilder(obj)->clist);
+}
+
+static inline ovm_obj_strbuilder_t strbuilder_new(ovm_inst_t dst)
+{
+    return (ovm_obj_strbuilder(ovm_obj_alloc(dst, sizeof(*ovm_obj_strbuilder(0)), OVM_CL_STRINGBUILDER, OVM_MEM_ALLOC_NO_HINT, strbuilder_obj_init)));
+}
+
+static void range_obj_init(ovm_obj_t obj, va_list ap)
+{
+    ovm_obj_range_t r = ovm_obj_range(obj);
+    r->start = va_arg(ap, ovm_intval_t);
+    r->stop  = va_arg(ap, ovm_intval_t);
+    r->step  = va_arg(ap, ovm_intval_t);
+}
+
+static inline ovm_obj_range_t range_new(ovm_inst_t dst, ovm_intval_t start, ovm_intval_t stop, ovm_intval_t step)
+{
+    return (ovm_obj_range(ovm_obj_alloc(dst, sizeof(*ovm_obj_range(0)), OVM_CL_RANGE, OVM_MEM_ALLOC_NO_HINT, range_obj_init, start, stop, step)));
+}
+
+static ovm_intval_t range_size(ovm_obj_range_t r)
+{
+    if (r->step > 0) {
+        return (r->stop > r->start ? (ovm_intval_t) (((unsigned long long) r->stop - r->start - 1) / r->step + 1) : 0);
+    }
+
+    return (r->stop < r->start ? (ovm_intval_t) (((unsigned long long) r->start - r->stop - 1) / -(unsigned long long) r->step + 1) : 0);
+}
+
+/* Append the given item; anything other than a String or Bytearray is converted with its String method */
+
+static void strbuilder_append(ovm_thread_t th, ovm_obj_strbuilder_t sb, ovm_inst_t item)
+{
+    ovm_obj_class_t cl = ovm_inst_of_raw(item);
+    if (ovm_is_subclass_of(cl, OVM_CL_BYTEARRAY)) {
+        ovm_obj_barray_t b = ovm_inst_barrayval_nochk(item);
+        obj_lock(sb->base);
+        ovm_clist_appendc(sb->clist, b->size + 1, (const char *) b->data);
+        obj_unlock(sb->base);
+
+        return;
+    }
+    
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_inst_assign(&work[-1], item);
+    if (cl != OVM_CL_STRING)  ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(String), 1);
+    ovm_obj_str_t s = ovm_inst_strval(th, &work[-1]);
+    obj_lock(sb->base);
+    ovm_clist_append_str(th, sb->clist, s);
+    obj_unlock(sb->base);
+
+    ovm_stack_unwind(th, work);
+}
+
+static void ns_walk(ovm_obj_ns_t ns, void (*func)(ovm_obj_t))
+{
+    (*func)(ns->name);
+    (*func)(ns->parent);
+    (*func)(ns->dict);
+}
+
+static void ns_mark(ovm_obj_t obj)
 {
     ns_walk(ovm_obj_ns(obj), ovm_obj_mark);
 }
@@ -2186,17 +3071,19 @@ static ovm_intval_t str_hashc(unsigned size, const char *data)
 
 static inline ovm_intval_t str_hash(ovm_obj_str_t s)
 {
-    return (str_hashc(s->size, s->data));
+    /* Strings are immutable once constructed, so the hash is cached in the object */
+    
+    if (!s->hash_valid) {
+        s->hash = str_hashc(s->size, s->data);
+        s->hash_valid = true;
+    }
+
+    return (s->hash);
 }
 
 static ovm_intval_t str_inst_hash(ovm_inst_t inst)
 {
-    if (!inst->hash_valid) {
-        inst->hash = str_hash(ovm_inst_strval_nochk(inst));
-        inst->hash_valid = true;
-    }
-    
-    return (inst->hash);
+    return (str_hash(ovm_inst_strval_nochk(inst)));
 }
  
 static inline bool str_equalc(ovm_obj_str_t s, unsigned size, const char *data)
@@ -2255,20 +3142,33 @@ static inline bool array_at_put(ovm_obj_array_t a, ovm_intval_t idx, ovm_inst_t
     return (true);
 }
 
-static unsigned array_hash(ovm_thread_t th, ovm_obj_t obj, unsigned size, ovm_inst_t data)
+static unsigned array_hash(ovm_thread_t th, ovm_obj_array_t a)
 {
-    obj_lock_loop_chk(th, obj);
+    obj_lock_loop_chk(th, a->base);
         
     ovm_inst_t work = ovm_stack_alloc(th, 1);
 
-    unsigned result = 0;
-    for (; size > 0; --size, ++data) {
-        ovm_inst_assign(&work[-1], data);
+    unsigned result = 0, i;
+    for (i = 0; array_elem(&work[-1], a, i); ++i) {
         ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(hash), 1);
         result += ovm_inst_intval(th, &work[-1]);
     }
     
-    obj_unlock(obj);
+    ovm_stack_unwind(th, work);
+
+    obj_unlock(a->base);
+
+    return (result);
+}
+
+static unsigned inst_hash(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (ovm_inst_of_raw(inst) == OVM_CL_STRING)  return (str_hash(ovm_inst_strval_nochk(inst)));
+
+    ovm_stack_push(th, inst);
+    ovm_method_callsch(th, th->sp, OVM_STR_CONST_HASH(hash), 1);
+    unsigned result = ovm_inst_intval(th, th->sp);
+    ovm_stack_free(th, 1);
 
     return (result);
 }
@@ -2277,14 +3177,7 @@ static ovm_obj_t *set_find(ovm_thread_t th, ovm_obj_set_t s, ovm_inst_t key, ovm
 {
     ovm_obj_t *result = 0;
 
-    if (!key->hash_valid) {
-        ovm_stack_push(th, key);
-        ovm_method_callsch(th, th->sp, OVM_STR_CONST_HASH(hash), 1);
-        key->hash = ovm_inst_intval(th, th->sp);
-        key->hash_valid = true;
-        ovm_stack_free(th, 1);
-    }
-    ovm_obj_t *p = &s->data[key->hash & (s->size - 1)];
+    ovm_obj_t *p = &s->data[inst_hash(th, key) & (s->size - 1)];
     if (bucket) *bucket = p;
     ovm_obj_list_t li;
 
@@ -2434,14 +3327,7 @@ static ovm_obj_t *dict_find(ovm_thread_t th, ovm_obj_set_t s, ovm_inst_t key, ov
 {
     ovm_obj_t *result = 0;
 
-    if (!key->hash_valid) {
-        ovm_stack_push(th, key);
-        ovm_method_callsch(th, th->sp, OVM_STR_CONST_HASH(hash), 1);
-        key->hash = ovm_inst_intval(th, th->sp);
-        key->hash_valid = true;
-        ovm_stack_free(th, 1);
-    }
-    ovm_obj_t *p = &s->data[key->hash & (s->size - 1)];
+    ovm_obj_t *p = &s->data[inst_hash(th, key) & (s->size - 1)];
     if (bucket) *bucket = p;
     ovm_obj_list_t li;
 
@@ -2698,9 +3584,10 @@ static ovm_floatval_t interp_floatval(ovm_thread_t th)
     unsigned size;
     const char *data;
     interp_strval(th, &size, &data);
-    long double result;
-    sscanf(data, "%La", &result);
-    return (result);
+
+    /* Literal is a NUL-terminated hex-float (see ovmc5_vm.py), so it converts exactly */
+
+    return (OVM_FLOATVAL_STRTO(data, 0));
 }
 
 static unsigned symbol_lkup(unsigned bufsize, char *buf, void *addr)
@@ -2971,6 +3858,26 @@ static void interp(ovm_thread_t th, ovm_method_t m, bool tracef)
 	    }
             break;
 
+	case 0x36:		/* iter_next */
+	    {
+		ovm_inst_t dst = interp_base_ofs(th);
+		ovm_inst_t it = interp_base_ofs(th);
+		long long ofs = interp_intval(th);
+		interp_trace(th);
+		if (!ovm_iter_next(th, dst, it))  th->pc += ofs;
+	    }
+            break;
+
+	case 0x37:		/* range_next */
+	    {
+		ovm_inst_t dst = interp_base_ofs(th);
+		ovm_inst_t it = interp_base_ofs(th);
+		long long ofs = interp_intval(th);
+		interp_trace(th);
+		if (!ovm_range_next(dst, it))  th->pc += ofs;
+	    }
+            break;
+
         case 0x40:		/* environ_at */
             {
                 ovm_inst_t dst = interp_base_ofs(th);
@@ -3117,6 +4024,22 @@ static void interp(ovm_thread_t th, ovm_method_t m, bool tracef)
             }
             break;
 
+	case 0x60:		/* iter_init */
+	    {
+		ovm_inst_t it = interp_base_ofs(th);
+		interp_trace(th);
+		ovm_iter_init(th, it);
+	    }
+            break;
+
+	case 0x61:		/* range_init */
+	    {
+		ovm_inst_t it = interp_base_ofs(th);
+		interp_trace(th);
+		ovm_range_init(th, it);
+	    }
+            break;
+
 	case 0x70:		/* argc_chk */
 	    {
 		unsigned expected = interp_uintval(th);
@@ -3200,6 +4123,156 @@ bool ovm_bool_if(ovm_thread_t th)
 
 /***************************************************************************/
 
+/* Iteration, for 'for' loops
+
+   A cursor is 3 instances: it[0] is the container, and it[1] and it[2] are
+   the position -- index and end for Strings, Arrays and Bytearrays, next
+   value for Ranges, bucket index and list node for Sets and Dictionaries,
+   and list node for Lists.  The end is the size when the loop starts, so
+   that a loop that appends to what it is iterating over still ends; it is
+   also checked against the current size, in case the container shrank.  Stepping a cursor
+   allocates nothing, except for Strings, whose elements are 1-character
+   Strings, and Files, whose elements are lines, read one at a time, until
+   end of file or error.  Anything else is iterated over via its List
+   method.
+
+   A 'for' over #Range.new(...) is compiled to a counting loop instead, with
+   a cursor of start (advanced in place), stop and step -- see
+   ovm_range_init() and ovm_range_next().
+*/
+
+static inline bool iter_is_indexed(ovm_obj_class_t cl)
+{
+    return (cl == OVM_CL_STRING
+            || cl == OVM_CL_ARRAY || cl == OVM_CL_CARRAY
+            || cl == OVM_CL_BYTEARRAY || cl == OVM_CL_CBYTEARRAY
+            );
+}
+
+static inline ovm_intval_t iter_indexed_size(ovm_obj_class_t cl, ovm_obj_t obj)
+{
+    if (cl == OVM_CL_STRING)  return (ovm_obj_str(obj)->size - 1);
+    if (cl == OVM_CL_ARRAY || cl == OVM_CL_CARRAY)  return (ovm_obj_array(obj)->size);
+    return (ovm_obj_barray(obj)->size);
+}
+
+static inline bool iter_is_set(ovm_obj_class_t cl)
+{
+    return (cl == OVM_CL_SET || cl == OVM_CL_CSET
+            || cl == OVM_CL_DICTIONARY || cl == OVM_CL_CDICTIONARY
+            );
+}
+
+void ovm_iter_init(ovm_thread_t th, ovm_inst_t it)
+{
+    ovm_inst_t c = &it[0];
+    ovm_obj_class_t cl = ovm_inst_of_raw(c);
+    if (iter_is_indexed(cl)) {
+        ovm_int_newc(&it[1], 0);
+        ovm_int_newc(&it[2], iter_indexed_size(cl, c->objval));
+
+        return;
+    }
+    if (cl == OVM_CL_SLICE || cl == OVM_CL_CSLICE) {
+        ovm_obj_slice_t sl = ovm_inst_sliceval_nochk(c);
+        if (iter_is_indexed(ovm_obj_inst_of_raw(sl->underlying))) {
+            ovm_int_newc(&it[1], sl->ofs);
+            ovm_int_newc(&it[2], sl->ofs + sl->size);
+            ovm_inst_assign_obj(c, sl->underlying);
+
+            return;
+        }
+    } else if (iter_is_set(cl)) {
+        ovm_int_newc(&it[1], 0);
+        ovm_inst_assign_obj(&it[2], 0);
+
+        return;
+    } else if (cl == OVM_CL_RANGE) {
+        ovm_int_newc(&it[1], ovm_inst_rangeval_nochk(c)->start);
+        ovm_inst_assign_obj(&it[2], 0);
+
+        return;
+    } else if (cl == OVM_CL_FILE) {
+        ovm_inst_assign_obj(&it[1], 0);
+        ovm_inst_assign_obj(&it[2], 0);
+
+        return;
+    }
+    if (!(cl == OVM_CL_LIST || ovm_inst_is_nil(c))) {
+        ovm_stack_push(th, c);
+        ovm_method_callsch(th, c, OVM_STR_CONST_HASH(List), 1);
+        ovm_stack_free(th, 1);
+        if (!(ovm_inst_of_raw(c) == OVM_CL_LIST || ovm_inst_is_nil(c)))  ovm_except_inv_value(th, c);
+    }
+    ovm_inst_assign_obj(&it[1], 0);
+    ovm_inst_assign(&it[2], c);
+}
+
+bool ovm_iter_next(ovm_thread_t th, ovm_inst_t dst, ovm_inst_t it)
+{
+    ovm_inst_t c = &it[0];
+    ovm_obj_class_t cl = ovm_inst_of_raw(c);
+    if (iter_is_indexed(cl)) {
+        ovm_intval_t i = it[1].intval;
+        ovm_obj_t obj = c->objval;
+        if (i >= it[2].intval || i >= iter_indexed_size(cl, obj))  return (false);
+
+        if (cl == OVM_CL_STRING) {
+            str_slicec(dst, ovm_obj_str(obj), i, 1);
+        } else if (cl == OVM_CL_ARRAY || cl == OVM_CL_CARRAY) {
+            ovm_inst_assign(dst, &ovm_obj_array(obj)->data[i]);
+        } else {
+            ovm_int_newc(dst, ovm_obj_barray(obj)->data[i]);
+        }
+        it[1].intval = i + 1;   /* Still an Integer, no need to reassign */
+
+        return (true);
+    }
+    if (cl == OVM_CL_RANGE) {
+        ovm_obj_range_t r = ovm_inst_rangeval_nochk(c);
+        ovm_intval_t i = it[1].intval;
+        if (r->step > 0 ? i >= r->stop : i <= r->stop)  return (false);
+
+        ovm_int_newc(dst, i);
+        if (__builtin_add_overflow(i, r->step, &i))  i = r->stop;
+        it[1].intval = i;
+
+        return (true);
+    }
+    if (cl == OVM_CL_FILE) {
+        file_fp(th, c);
+
+        return (file_readln(dst, ovm_inst_fileval_nochk(c), 0)
+                && ovm_inst_strval_nochk(dst)->size > 1
+                );
+    }
+
+    ovm_obj_list_t li = ovm_inst_listval_nochk(&it[2]);
+    if (li == 0 && iter_is_set(cl)) {
+        ovm_obj_set_t s = ovm_inst_setval_nochk(c);
+        ovm_intval_t i;
+        for (i = it[1].intval; i < s->size; ++i) {
+            if ((li = ovm_obj_list(s->data[i])) != 0)  break;
+        }
+        it[1].intval = i < s->size ? i + 1 : i;
+    }
+    if (li == 0)  return (false);
+
+    ovm_inst_assign(dst, li->item);
+    ovm_inst_assign_obj(&it[2], li->next);
+
+    return (true);
+}
+
+void ovm_range_init(ovm_thread_t th, ovm_inst_t it)
+{
+    ovm_inst_intval(th, &it[0]);
+    ovm_inst_intval(th, &it[1]);
+    if (ovm_inst_intval(th, &it[2]) == 0)  ovm_except_inv_value(th, &it[2]);
+}
+
+/***************************************************************************/
+
 /* Parsing strings into instances */
 
 static bool parse(ovm_thread_t th, ovm_inst_t dst, unsigned size, const char *data);
@@ -3378,9 +4451,7 @@ static bool parse_float(ovm_inst_t dst, unsigned size, const char *data)
     char buf[size + 1];
     memcpy(buf, data, size);
     buf[size] = 0;
-    ovm_floatval_t val;
-    assert(sscanf(buf, "%Lg", &val) == 1);
-    ovm_float_newc(dst, val);
+    ovm_float_newc(dst, OVM_FLOATVAL_STRTO(buf, 0));
 
     return (true);
 }
@@ -3790,8 +4861,7 @@ static bool _obj_at(ovm_thread_t th, ovm_inst_t dst, ovm_inst_t inst, ovm_inst_t
 
     ovm_inst_of(&work[-1], inst);
     if (!(s->size > 2 && s->data[0] == '_' && s->data[1] != '_') || class_up(th, 1) == ovm_inst_classval_nochk(&work[-1])) {
-        str_inst_hash(key);
-        result = dict_ats(dst, ovm_inst_setval_nochk(inst), s->size, s->data, key->hash);
+        result = dict_ats(dst, ovm_inst_setval_nochk(inst), s->size, s->data, str_hash(s));
     }
 
     ovm_stack_unwind(th, work);
@@ -3838,9 +4908,8 @@ CM_DECL(atput)
     if (ovm_inst_of_raw(recvr) != OVM_CL_USER)  ovm_except_inv_value(th, recvr);
     ovm_inst_t key = &argv[1];
     ovm_obj_str_t s = ovm_inst_strval(th, key);
-    str_inst_hash(key);
     ovm_inst_t val = &argv[2];
-    dict_ats_put(th, ovm_inst_setval_nochk(recvr), s->size, s->data, key->hash, val);
+    dict_ats_put(th, ovm_inst_setval_nochk(recvr), s->size, s->data, str_hash(s), val);
     ovm_inst_assign(dst, val);
 }
 
@@ -3898,12 +4967,11 @@ CM_DECL(method)
     CM_ARGC_CHK(2);
     ovm_inst_t recvr = &argv[0], arg = &argv[1];
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
 
     ovm_inst_of(&work[-1], recvr);
-    if (!method_findc1_unsafe(th, dst, ovm_inst_classval_nochk(&work[-1]), CL_OFS_INST_METHODS_DICT, s->size, s->data, arg->hash, 0)) {
+    if (!method_findc1_unsafe(th, dst, ovm_inst_classval_nochk(&work[-1]), CL_OFS_INST_METHODS_DICT, s->size, s->data, str_inst_hash(arg), 0)) {
         ovm_inst_assign_obj(dst, 0);
     }
 }
@@ -4282,12 +5350,8 @@ CM_DECL(gt)
 CM_DECL(hash)
 {
     CM_ARGC_CHK(1);
-    ovm_inst_t recvr = &argv[0];
-    if (!recvr->hash_valid) {
-        recvr->hash = mem_hash(sizeof(recvr->intval), &recvr->intval);
-        recvr->hash_valid = true;
-    }
-    ovm_int_newc(dst, recvr->hash);
+    ovm_intval_t val = ovm_inst_intval(th, &argv[0]);
+    ovm_int_newc(dst, mem_hash(sizeof(val), &val));
 }
 
 CM_DECL(le)
@@ -4423,7 +5487,7 @@ CM_DECL(div)
 CM_DECL(write)
 {
     char buf[64];
-    snprintf(buf, sizeof(buf), "%Lg", ovm_inst_floatval(th, &argv[0]));
+    snprintf(buf, sizeof(buf), "%" OVM_FLOATVAL_LEN_MOD "g", ovm_inst_floatval(th, &argv[0]));
     str_newc1(dst, buf);
 }
 
@@ -4649,6 +5713,12 @@ CM_DECL(Slice)
 
 /* Method 'Cslice' is alias for 'Slice' */
 
+CM_DECL(Cbyteslice)
+{
+    ovm_obj_str_t str = ovm_inst_strval(th, &argv[0]);
+    byteslice_new_args(th, dst, OVM_CL_CBYTESLICE, argc, argv, str->size - 1);
+}
+
 CM_DECL(new)
 {
     CM_ARGC_CHK(2);
@@ -4683,7 +5753,7 @@ CM_DECL(call)
     ovm_obj_list_t li = ovm_inst_listval(th, &argv[1]);
     unsigned _argc = list_size(li);
     if (_argc < 1)  ovm_except_inv_value(th, &argv[1]);
-    str_inst_hash(recvr);
+    unsigned hash = str_hash(s);
 
     ovm_stack_alloc(th, _argc);
 
@@ -4691,7 +5761,7 @@ CM_DECL(call)
     for (p = th->sp; li != 0; li = ovm_list_next(li), ++p) {
         ovm_inst_assign(p, li->item);
     }
-    ovm_method_callsch(th, dst, s->size, s->data, recvr->hash, _argc);
+    ovm_method_callsch(th, dst, s->size, s->data, hash, _argc);
 }
 
 CM_DECL(cmp)
@@ -4702,16 +5772,34 @@ CM_DECL(cmp)
     ovm_int_newc(dst, strcmp(s1->data, s2->data));
 }
 
+/* Strings are immutable, except that when the result is about to replace
+   the only reference to the receiver, as in "s = s + t" or "s += t", nobody
+   can tell if the receiver is extended in place.  Strings built this way are
+   allocated with room to spare, so that a loop of appends is linear rather
+   than quadratic.
+*/
+
 CM_DECL(concat)
 {
     CM_ARGC_CHK(2);
-    ovm_obj_str_t s1 = ovm_inst_strval(th, &argv[0]);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_str_t s1 = ovm_inst_strval(th, recvr);
     ovm_obj_str_t s2 = ovm_inst_strval(th, &argv[1]);
+    unsigned size = s1->size + s2->size - 1;
+    bool uniquef = ovm_obj_inst_of_raw(s1->base) == OVM_CL_STRING && inst_unique_owner(dst, recvr);
+    if (uniquef && size <= str_capacity(s1)) {
+        memcpy(&s1->data[s1->size - 1], s2->data, s2->size);
+        s1->size = size;
+        s1->hash_valid = false;
+        
+        return;
+    }
+    
     struct ovm_str_newv_item a[2] = {
         { s1->size, s1->data },
         { s2->size, s2->data }
     };
-    str_newv_size(dst, s1->size + s2->size - 1, ARRAY_SIZE(a), a);
+    str_newv_capacity(dst, uniquef ? size << 1 : size, size, ARRAY_SIZE(a), a);
 }
 
 CM_DECL(equal)
@@ -4722,12 +5810,17 @@ CM_DECL(equal)
     ovm_bool_newc(dst, ovm_inst_of_raw(arg) == OVM_CL_STRING && str_equal(s, ovm_inst_strval_nochk(arg)));
 }
 
+/* Arguments are converted first, since a clist cannot be unwound by an
+   exception; literal text is then copied straight from the receiver,
+   rather than through a String per segment.
+*/
+
 CM_DECL(format)
 {
     ovm_obj_array_t a = ovm_method_array_arg_push(th, 1);
     ovm_inst_t recvr = &argv[0];
     ovm_obj_str_t s = ovm_inst_strval(th, recvr);
-    unsigned n = s->size - 1, ofs = 0, size = 1;
+    unsigned n = s->size - 1, ofs = 0;
 
     ovm_inst_t work = ovm_stack_alloc(th, 2);
     struct list_newlc_ctxt lc[1];
@@ -4737,38 +5830,38 @@ CM_DECL(format)
         int i = str_indexc(s, "[", ofs);
         if (i < 0) {
             if (str_indexc(s, "]", ofs) >= 0)  ovm_except_inv_value(th, recvr);
-            unsigned k = n - ofs;
-            str_slicec(&work[-2], s, ofs, k);
-            list_newlc_concat(lc, list_new(&work[-2], &work[-2], 0));
-            size += k;
             break;
         }
         int j = str_indexc(s, "]", i);
         if (j <= (i + 1))  ovm_except_inv_value(th, recvr);
-        if (i > ofs) {
-            unsigned k = i - ofs;
-            str_slicec(&work[-2], s, ofs, k);
-            list_newlc_concat(lc, list_new(&work[-2], &work[-2], 0));
-            size += k;
-        }
         ++i;
         if (!parse_int(&work[-2], j - i, s->data + i))  ovm_except_inv_value(th, recvr);
         if (!array_at(&work[-2], a, work[-2].intval))  ovm_except_idx_range(th, &work[0], &work[-2]);
         ovm_method_callsch(th, &work[-2], OVM_STR_CONST_HASH(String), 1);
-        size += ovm_inst_strval(th, &work[-2])->size - 1;
+        ovm_inst_strval(th, &work[-2]);
         list_newlc_concat(lc, list_new(&work[-2], &work[-2], 0));
         ofs = j + 1;
     }
 
-    str_joinc_size(dst, size, 0, 0, 0, 0, 0, 0, ovm_inst_listval_nochk(&work[-1]));
+    struct ovm_clist cl[1];
+    ovm_clist_init(cl);
+    ovm_obj_list_t li = ovm_inst_listval_nochk(&work[-1]);
+    for (ofs = 0; ofs < n; li = ovm_obj_list(li->next)) {
+        int i = str_indexc(s, "[", ofs);
+        unsigned k = (i < 0 ? n : (unsigned) i) - ofs;
+        ovm_clist_appendc(cl, k + 1, s->data + ofs);
+        if (i < 0)  break;
+        ovm_clist_append_str(th, cl, ovm_obj_str(li->item->objval));
+        ofs = str_indexc(s, "]", i) + 1;
+    }
+    str_new_clist(dst, cl);
+    ovm_clist_fini(cl);
 }
 
 CM_DECL(hash)
 {
     CM_ARGC_CHK(1);
-    ovm_inst_t recvr = &argv[0];
-    str_inst_hash(recvr);
-    ovm_int_newc(dst, recvr->hash);
+    ovm_int_newc(dst, str_hash(ovm_inst_strval(th, &argv[0])));
 }
 
 CM_DECL(index)
@@ -5023,22 +6116,18 @@ CM_DECL(first)
 CM_DECL(hash)
 {
     CM_ARGC_CHK(1);
-    ovm_inst_t recvr = &argv[0];
-    if (!recvr->hash_valid) {
-        ovm_obj_pair_t pr = ovm_inst_pairval(th, recvr);
+    ovm_obj_pair_t pr = ovm_inst_pairval(th, &argv[0]);
 
-        ovm_inst_t work = ovm_stack_alloc(th, 1);
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
         
-        ovm_inst_assign(th->sp, pr->first);
-        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(hash), 1);
-        recvr->hash = ovm_inst_intval(th, &work[-1]);
-        ovm_inst_assign(th->sp, pr->second);
-        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(hash), 1);
-        recvr->hash += ovm_inst_intval(th, &work[-1]);
-        recvr->hash_valid = true;
-    }
+    ovm_inst_assign(th->sp, pr->first);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(hash), 1);
+    unsigned result = ovm_inst_intval(th, &work[-1]);
+    ovm_inst_assign(th->sp, pr->second);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(hash), 1);
+    result += ovm_inst_intval(th, &work[-1]);
 
-    ovm_int_newc(dst, recvr->hash);
+    ovm_int_newc(dst, result);
 }
  
 CM_DECL(second)
@@ -5282,13 +6371,7 @@ CM_DECL(equal)
 CM_DECL(hash)
 {
     CM_ARGC_CHK(1);
-    ovm_inst_t recvr = &argv[0];
-    if (!recvr->hash_valid) {
-        recvr->hash = list_hash(th, ovm_inst_listval(th, recvr));
-        recvr->hash_valid = true;
-    }
-
-    ovm_int_newc(dst, recvr->hash);
+    ovm_int_newc(dst, list_hash(th, ovm_inst_listval(th, &argv[0])));
 }
 
 CM_DECL(map1)
@@ -5395,6 +6478,28 @@ CM_DECL(slice)
     ovm_inst_assign(dst, &work[-1]);
 }
 
+/* Lists are immutable, so sorting returns a new list */
+
+CM_DECL(sort)
+{
+    CM_ARGC_RANGE_CHK(1, 2);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    list_to_array_unsafe(th, &work[-1], OVM_CL_ARRAY, &argv[0]);
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(&work[-1]);
+    sort(th, &work[-1], argc > 1 ? &argv[1] : 0);
+    ovm_inst_assign_obj(&work[-2], 0);
+    unsigned n;
+    for (n = a->size; n > 0; ) {
+        --n;
+        list_new(&work[-2], &a->data[n], ovm_inst_listval_nochk(&work[-2]));
+    }
+    ovm_inst_assign(dst, &work[-2]);
+}
+
+/* Method 'sorted' is alias for 'sort' */
+
 CM_DECL(write)
 {
     CM_ARGC_CHK(1);
@@ -5525,6 +6630,15 @@ CM_DECL(copydeep)
     ovm_inst_assign(dst, &work[-1]);
 }
 
+CM_DECL(append)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    array_push(th, recvr, &argv[1]);
+    ovm_inst_assign(dst, recvr);
+}
+
 CM_DECL(at)
 {
     CM_ARGC_CHK(2);
@@ -5545,6 +6659,29 @@ CM_DECL(atput)
     ovm_inst_assign(dst, val);
 }
 
+CM_DECL(capacity)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_arrayval(th, &argv[0])->capacity);
+}
+
+/* See String.concat for when the receiver is extended in place */
+
+CM_DECL(concat)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_array_t a1 = ovm_inst_arrayval(th, recvr);
+    ovm_obj_array_t a2 = ovm_inst_arrayval(th, &argv[1]);
+    if (a1->size + a2->size > ARRAY_CAPACITY_MAX)  ovm_except_inv_value(th, &argv[1]);
+    if (!inst_unique_owner(dst, recvr)) {
+        array_concat(dst, ovm_obj_inst_of_raw(a1->base), a1, a2, a1->size + a2->size);
+
+        return;
+    }
+    array_append(th, recvr, a2);
+}
+
 CM_DECL(equal)
 {
     CM_ARGC_CHK(2);
@@ -5556,54 +6693,148 @@ CM_DECL(equal)
         if (a2->size == a->size) {
             ovm_inst_t work = ovm_stack_alloc(th, 2);
 
-            ovm_inst_t p, q;
-            unsigned n;
-            for (p = a->data, q = a2->data, n = a->size; n > 0; --n, ++p, ++q) {
-                ovm_inst_assign(th->sp, p);
-                ovm_inst_assign(&th->sp[1], q);
+            unsigned i;
+            for (i = 0; ; ++i) {
+                bool f1 = array_elem(&work[-2], a, i), f2 = array_elem(&work[-1], a2, i);
+                if (!(f1 && f2)) {
+                    result = !(f1 || f2);
+                    break;
+                }
                 ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(equal), 2);
                 if (!ovm_inst_boolval(th, &work[-1]))  break;
             }
-            result = (n == 0);
         }
     }
     ovm_bool_newc(dst, result);
 }
 
-CM_DECL(size)
+CM_DECL(extend)
 {
-    CM_ARGC_CHK(1);
-    ovm_int_newc(dst, ovm_inst_arrayval(th, &argv[0])->size);
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    if (ovm_is_subclass_of(ovm_inst_of_raw(arg), OVM_CL_ARRAY)) {
+        array_append(th, recvr, ovm_inst_arrayval_nochk(arg));
+    } else {
+        ovm_inst_t work = ovm_stack_alloc(th, 4);
+
+        ovm_inst_assign(&work[-4], arg);
+        ovm_iter_init(th, &work[-4]);
+        while (ovm_iter_next(th, &work[-1], &work[-4]))  array_push(th, recvr, &work[-1]);
+    }
+    ovm_inst_assign(dst, recvr);
 }
 
-CM_DECL(slice)
+CM_DECL(insert)
 {
     CM_ARGC_CHK(3);
-    ovm_inst_t recvr = &argv[0];
-    ovm_obj_array_t a = ovm_inst_arrayval(th, recvr);
-    ovm_inst_t ofs = &argv[1], len = &argv[2];
-    ovm_intval_t _ofs = ovm_inst_intval(th, ofs);
-    ovm_intval_t _len = ovm_inst_intval(th, len);
-    if (!slice(&_ofs, &_len, a->size))  ovm_except_idx_range2(th, recvr, ofs, len);
-    array_slicec(dst, ovm_obj_inst_of_raw(a->base), a, _ofs, _len);
-}
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg);
 
-static void array_write_unsafe(ovm_thread_t th, ovm_inst_t dst, ovm_obj_t obj, unsigned data_size, ovm_inst_t data, unsigned ldr_size, const char *ldr, unsigned trlr_size, const char *trlr)
-{
-    obj_lock_loop_chk(th, obj);
+    _ovm_objs_lock();
 
-    ovm_inst_t work = ovm_stack_alloc(th, 1);
+    if (idx < 0)  idx += a->size;
+    if (idx < 0 || idx > a->size) {
+        _ovm_objs_unlock();
 
-    ovm_inst_assign_obj(dst, 0);
-    struct list_newlc_ctxt lc[1];
-    list_newlc_init(lc, dst);
-    static const char sep[] = ", ";
-    unsigned size = ldr_size + trlr_size - 1;
-    bool f = false;
-    for (; data_size > 0; --data_size, ++data, f = true) {
-        if (f)  size += sizeof(sep) - 1;
-        ovm_inst_assign(th->sp, data);
-        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(write), 1);
+        ovm_except_idx_range(th, recvr, arg);
+    }
+    if (!_array_reserve_nolock(a, a->size + 1)) {
+        _ovm_objs_unlock();
+
+        ovm_except_inv_value(th, recvr);
+    }
+    memmove(&a->data[idx + 1], &a->data[idx], (a->size - idx) * sizeof(a->data[0]));
+    _ovm_inst_assign_nolock_norelease(&a->data[idx], &argv[2]);
+    ++a->size;
+
+    _ovm_objs_unlock();
+
+    ovm_inst_assign(dst, recvr);
+}
+
+/* Remove and return the element at the given index, default last */
+
+CM_DECL(pop)
+{
+    CM_ARGC_RANGE_CHK(1, 2);
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(recvr);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    if (argc > 1) {
+        ovm_inst_assign(&work[-2], &argv[1]);
+    } else {
+        ovm_int_newc(&work[-2], -1);
+    }
+    ovm_intval_t idx = ovm_inst_intval(th, &work[-2]);
+
+    _ovm_objs_lock();
+
+    if (!slice1(&idx, a->size)) {
+        _ovm_objs_unlock();
+
+        ovm_except_idx_range(th, recvr, &work[-2]);
+    }
+    _ovm_inst_assign_nolock(&work[-1], &a->data[idx]);
+    ovm_inst_release(&a->data[idx]);
+    memmove(&a->data[idx], &a->data[idx + 1], (a->size - idx - 1) * sizeof(a->data[0]));
+    --a->size;
+    memset(&a->data[a->size], 0, sizeof(a->data[0]));
+
+    _ovm_objs_unlock();
+
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+CM_DECL(reserve)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_intval_t n = ovm_inst_intval(th, arg);
+    if (n < 0 || n > ARRAY_CAPACITY_MAX)  ovm_except_inv_value(th, arg);
+    array_reserve(th, recvr, n);
+    ovm_inst_assign(dst, recvr);
+}
+
+CM_DECL(size)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_arrayval(th, &argv[0])->size);
+}
+
+CM_DECL(slice)
+{
+    CM_ARGC_CHK(3);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_array_t a = ovm_inst_arrayval(th, recvr);
+    ovm_inst_t ofs = &argv[1], len = &argv[2];
+    ovm_intval_t _ofs = ovm_inst_intval(th, ofs);
+    ovm_intval_t _len = ovm_inst_intval(th, len);
+    if (!slice(&_ofs, &_len, a->size))  ovm_except_idx_range2(th, recvr, ofs, len);
+    array_slicec(dst, ovm_obj_inst_of_raw(a->base), a, _ofs, _len);
+}
+
+static void array_write_unsafe(ovm_thread_t th, ovm_inst_t dst, ovm_obj_array_t a, unsigned ldr_size, const char *ldr, unsigned trlr_size, const char *trlr)
+{
+    obj_lock_loop_chk(th, a->base);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_inst_assign_obj(dst, 0);
+    struct list_newlc_ctxt lc[1];
+    list_newlc_init(lc, dst);
+    static const char sep[] = ", ";
+    unsigned size = ldr_size + trlr_size - 1;
+    unsigned i;
+    for (i = 0; array_elem(&work[-1], a, i); ++i) {
+        if (i > 0)  size += sizeof(sep) - 1;
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(write), 1);
         size += ovm_inst_strval(th, &work[-1])->size - 1;
         list_newlc_concat(lc, list_new(&work[-1], &work[-1], 0));
     }
@@ -5612,7 +6843,28 @@ static void array_write_unsafe(ovm_thread_t th, ovm_inst_t dst, ovm_obj_t obj, u
 
     ovm_stack_unwind(th, work);
 
-    obj_unlock(obj);
+    obj_unlock(a->base);
+}
+
+CM_DECL(sort)
+{
+    CM_ARGC_RANGE_CHK(1, 2);
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    sort(th, recvr, argc > 1 ? &argv[1] : 0);
+    ovm_inst_assign(dst, recvr);
+}
+
+CM_DECL(sorted)
+{
+    CM_ARGC_RANGE_CHK(1, 2);
+    ovm_obj_array_t a = ovm_inst_arrayval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    array_copy(&work[-1], ovm_obj_inst_of_raw(a->base), a);
+    sort(th, &work[-1], argc > 1 ? &argv[1] : 0);
+    ovm_inst_assign(dst, &work[-1]);
 }
 
 CM_DECL(write)
@@ -5624,7 +6876,7 @@ CM_DECL(write)
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
 
-    array_write_unsafe(th, &work[-1], a->base, a->size, a->data, _OVM_STR_CONST("["), _OVM_STR_CONST("]"));
+    array_write_unsafe(th, &work[-1], a, _OVM_STR_CONST("["), _OVM_STR_CONST("]"));
     ovm_inst_assign(dst, &work[-1]);
 }
 
@@ -5679,14 +6931,10 @@ CM_DECL(hash)
 {    
     CM_ARGC_CHK(1);
     ovm_inst_t recvr = &argv[0];
-    if (!recvr->hash_valid) {
-        if (ovm_inst_of_raw(recvr) != OVM_CL_CARRAY) ovm_except_inv_value(th, recvr);
-        ovm_obj_array_t a = ovm_inst_arrayval_nochk(recvr);
-        recvr->hash = array_hash(th, a->base, a->size, a->data);
-        recvr->hash_valid = true;
-    }
+    if (ovm_inst_of_raw(recvr) != OVM_CL_CARRAY) ovm_except_inv_value(th, recvr);
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(recvr);
 
-    ovm_int_newc(dst, recvr->hash);
+    ovm_int_newc(dst, array_hash(th, a));
 }
 
 /* Method 'size' inherited */
@@ -5702,7 +6950,7 @@ CM_DECL(write)
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
 
-    array_write_unsafe(th, &work[-1], a->base, a->size, a->data, _OVM_STR_CONST("#Carray.new(["), _OVM_STR_CONST("])"));
+    array_write_unsafe(th, &work[-1], a, _OVM_STR_CONST("#Carray.new(["), _OVM_STR_CONST("])"));
     ovm_inst_assign(dst, &work[-1]);
 }
  
@@ -5816,6 +7064,19 @@ CM_DECL(Cslice)
     slice_new(dst, OVM_CL_CSLICE, b->base, idx, len);
 }
 
+CM_DECL(Byteslice)
+{
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTEARRAY)  ovm_except_inv_value(th, recvr);
+    byteslice_new_args(th, dst, OVM_CL_BYTESLICE, argc, argv, ovm_inst_barrayval_nochk(recvr)->size);
+}
+
+CM_DECL(Cbyteslice)
+{
+    ovm_obj_barray_t b = ovm_inst_barrayval(th, &argv[0]);
+    byteslice_new_args(th, dst, OVM_CL_CBYTESLICE, argc, argv, b->size);
+}
+
 CM_DECL(new)
 {
     CM_ARGC_CHK(2);
@@ -5852,132 +7113,1168 @@ CM_DECL(at)
     ovm_int_newc(dst, b->data[idx]);
 }
 
-CM_DECL(atput)
+CM_DECL(atput)
+{
+    CM_ARGC_CHK(3);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1], val = &argv[2];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTEARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg);
+    ovm_intval_t byte = ovm_inst_intval(th, val);
+    if (!slice1(&idx, b->size))  ovm_except_idx_range(th, recvr, arg);
+    if (byte < 0 || byte > 255)  ovm_except_inv_value(th, val);
+    b->data[idx] = byte;
+    ovm_inst_assign(dst, val);
+}
+
+/* See String.concat for when the receiver is extended in place */
+
+CM_DECL(concat)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_barray_t b1 = ovm_inst_barrayval(th, recvr);
+    ovm_obj_barray_t b2 = ovm_inst_barrayval(th, &argv[1]);
+    unsigned size = b1->size + b2->size;
+    if (!inst_unique_owner(dst, recvr)) {
+        barray_concat(dst, ovm_obj_inst_of_raw(b1->base), b1, b2, size);
+
+        return;
+    }
+    if (size <= barray_capacity(b1)) {
+        memcpy(&b1->data[b1->size], b2->data, b2->size);
+        b1->size = size;
+
+        return;
+    }
+    barray_concat(dst, ovm_obj_inst_of_raw(b1->base), b1, b2, size << 1);
+}
+
+CM_DECL(equal)
+{
+    CM_ARGC_CHK(2);
+    ovm_obj_barray_t b = ovm_inst_barrayval(th, &argv[0]);
+    ovm_inst_t arg = &argv[1];
+    bool result = false;
+    if (ovm_is_subclass_of(ovm_inst_of_raw(arg), OVM_CL_BYTEARRAY)) {
+        ovm_obj_barray_t b2 = ovm_inst_barrayval_nochk(arg);
+        result = (b->size == b2->size && memcmp(b->data, b2->data, b->size) == 0);
+    }
+    ovm_bool_newc(dst, result);
+}
+
+CM_DECL(size)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_barrayval(th, &argv[0])->size);
+}
+
+CM_DECL(slice)
+{
+    CM_ARGC_CHK(3);
+    ovm_inst_t recvr = &argv[0], arg1 = &argv[1], arg2 = &argv[2];
+    ovm_obj_barray_t b = ovm_inst_barrayval(th, recvr);
+    ovm_intval_t ofs = ovm_inst_intval(th, arg1);
+    ovm_intval_t len = ovm_inst_intval(th, arg2);
+    if (!slice(&ofs, &len, b->size))  ovm_except_idx_range2(th, recvr, arg1, arg2);
+    barray_slicec(dst, ovm_obj_inst_of_raw(b->base), b, ofs, len);
+}
+
+CM_DECL(write)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTEARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(recvr);
+    struct ovm_clist cl[1];
+    ovm_clist_init(cl);
+    ovm_clist_appendc(cl, _OVM_STR_CONST("#Bytearray(\""));
+    barray_write(cl, b->size, b->data);
+    ovm_clist_appendc(cl, _OVM_STR_CONST("\")"));
+    str_new_clist(dst, cl);
+    ovm_clist_fini(cl);
+}
+
+/* Bulk byte operations -- these work on any bytes, so Byteslice shares
+   them (see ovm_inst_bytes())
+*/
+
+static void bytes_recvr(ovm_thread_t th, ovm_inst_t recvr, unsigned *size, const unsigned char **data)
+{
+    if (!ovm_inst_bytes(recvr, size, data))  ovm_except_inv_value(th, recvr);
+}
+
+/* Optional offset argument, in [0, size] */
+
+static unsigned bytes_ofs_arg(ovm_thread_t th, unsigned argc, ovm_inst_t argv, unsigned i, unsigned size, unsigned dflt)
+{
+    if (argc <= i)  return (dflt);
+    ovm_intval_t ofs = ovm_inst_intval(th, &argv[i]);
+    if (ofs < 0)  ofs += size;
+    if (ofs < 0 || ofs > size)  ovm_except_idx_range(th, &argv[0], &argv[i]);
+
+    return (ofs);
+}
+
+static void bytes_index_newc(ovm_inst_t dst, ovm_intval_t i)
+{
+    if (i < 0) {
+        ovm_inst_assign_obj(dst, 0);
+
+        return;
+    }
+    ovm_int_newc(dst, i);
+}
+
+/* Index of first occurrence at or after offset (default 0), or nil */
+
+CM_DECL(find)
+{
+    CM_ARGC_RANGE_CHK(2, 3);
+    unsigned size, sub_size;
+    const unsigned char *data, *sub_data;
+    unsigned char buf[1];
+    bytes_recvr(th, &argv[0], &size, &data);
+    inst_needle(th, &argv[1], buf, &sub_size, &sub_data);
+    bytes_index_newc(dst, mem_index(size, data, sub_size, sub_data, bytes_ofs_arg(th, argc, argv, 2, size, 0)));
+}
+
+/* Index of last occurrence starting at or before offset (default end), or nil */
+
+CM_DECL(rfind)
+{
+    CM_ARGC_RANGE_CHK(2, 3);
+    unsigned size, sub_size;
+    const unsigned char *data, *sub_data;
+    unsigned char buf[1];
+    bytes_recvr(th, &argv[0], &size, &data);
+    inst_needle(th, &argv[1], buf, &sub_size, &sub_data);
+    bytes_index_newc(dst, mem_rindex(size, data, sub_size, sub_data, bytes_ofs_arg(th, argc, argv, 2, size, size)));
+}
+
+/* Number of non-overlapping occurrences */
+
+CM_DECL(count)
+{
+    CM_ARGC_CHK(2);
+    unsigned size, sub_size;
+    const unsigned char *data, *sub_data;
+    unsigned char buf[1];
+    bytes_recvr(th, &argv[0], &size, &data);
+    inst_needle(th, &argv[1], buf, &sub_size, &sub_data);
+    if (sub_size == 0)  ovm_except_inv_value(th, &argv[1]);
+    unsigned n = 0;
+    if (sub_size == 1) {
+        n = ovm_vec_u8_count(size, data, sub_data[0]);
+    } else {
+        ovm_intval_t i;
+        unsigned ofs;
+        for (ofs = 0; (i = mem_index(size, data, sub_size, sub_data, ofs)) >= 0; ++n)  ofs = i + sub_size;
+    }
+    ovm_int_newc(dst, n);
+}
+
+/* Lexicographic comparison with any bytes: -1, 0 or 1 */
+
+CM_DECL(cmp)
+{
+    CM_ARGC_CHK(2);
+    unsigned size1, size2;
+    const unsigned char *data1, *data2;
+    bytes_recvr(th, &argv[0], &size1, &data1);
+    if (!ovm_inst_bytes(&argv[1], &size2, &data2))  ovm_except_inv_value(th, &argv[1]);
+    int result = memcmp(data1, data2, size1 < size2 ? size1 : size2);
+    if (result == 0)  result = (size1 > size2) - (size1 < size2);
+    ovm_int_newc(dst, (result > 0) - (result < 0));
+}
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static void hex_encode(char *out, unsigned size, const unsigned char *data)
+{
+    for (; size > 0; --size, ++data) {
+        *out++ = hex_digits[*data >> 4];
+        *out++ = hex_digits[*data & 0xf];
+    }
+}
+
+static const char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void base64_encode(char *out, unsigned size, const unsigned char *data)
+{
+    for (; size >= 3; size -= 3, data += 3) {
+        unsigned v = (data[0] << 16) | (data[1] << 8) | data[2];
+        *out++ = base64_digits[v >> 18];
+        *out++ = base64_digits[(v >> 12) & 0x3f];
+        *out++ = base64_digits[(v >> 6) & 0x3f];
+        *out++ = base64_digits[v & 0x3f];
+    }
+    if (size > 0) {
+        unsigned v = (data[0] << 16) | (size > 1 ? data[1] << 8 : 0);
+        *out++ = base64_digits[v >> 18];
+        *out++ = base64_digits[(v >> 12) & 0x3f];
+        *out++ = size > 1 ? base64_digits[(v >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+}
+
+static void str_encode_obj_init(ovm_obj_t obj, va_list ap)
+{
+    ovm_obj_str_t s = ovm_obj_str(obj);
+    s->size = va_arg(ap, unsigned);
+    void (*encode)(char *, unsigned, const unsigned char *) = va_arg(ap, void (*)(char *, unsigned, const unsigned char *));
+    unsigned size = va_arg(ap, unsigned);
+    (*encode)(s->data, size, va_arg(ap, const unsigned char *));
+    s->data[s->size - 1] = 0;
+}
+
+/* Make a String of the given length, by encoding bytes directly into it */
+
+static void str_new_encode(ovm_thread_t th, ovm_inst_t dst, unsigned long long len, void (*encode)(char *, unsigned, const unsigned char *), unsigned size, const unsigned char *data)
+{
+    if (len == 0) {
+        str_newc(dst, 1, "");
+
+        return;
+    }
+    if (len >= ~0U - sizeof(*ovm_obj_str(0)))  ovm_except_inv_value(th, dst);
+    ovm_obj_alloc(dst, sizeof(*ovm_obj_str(0)) + len + 1, OVM_CL_STRING, OVM_MEM_ALLOC_NO_HINT, str_encode_obj_init, (unsigned) len + 1, encode, size, data);
+}
+
+CM_DECL(hex)
+{
+    CM_ARGC_CHK(1);
+    unsigned size;
+    const unsigned char *data;
+    bytes_recvr(th, &argv[0], &size, &data);
+    str_new_encode(th, dst, 2ULL * size, hex_encode, size, data);
+}
+
+CM_DECL(base64)
+{
+    CM_ARGC_CHK(1);
+    unsigned size;
+    const unsigned char *data;
+    bytes_recvr(th, &argv[0], &size, &data);
+    str_new_encode(th, dst, (size + 2ULL) / 3 * 4, base64_encode, size, data);
+}
+
+static int hex_digit_val(unsigned char c)
+{
+    if (c >= '0' && c <= '9')  return (c - '0');
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')  return (c - 'a' + 10);
+
+    return (-1);
+}
+
+/* Bytearray from hex digits, in any case */
+
+CM_DECL(unhex)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t arg = &argv[1];
+    unsigned size, i;
+    const unsigned char *data;
+    if (!ovm_inst_bytes(arg, &size, &data) || (size & 1) != 0)  ovm_except_inv_value(th, arg);
+    for (i = 0; i < size; ++i) {
+        if (hex_digit_val(data[i]) < 0)  ovm_except_inv_value(th, arg);
+    }
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_obj_barray_t b = barray_newc(&work[-1], OVM_CL_BYTEARRAY, size >> 1, 0);
+    for (i = 0; i < b->size; ++i)  b->data[i] = (hex_digit_val(data[2 * i]) << 4) | hex_digit_val(data[2 * i + 1]);
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+static int base64_digit_val(unsigned char c)
+{
+    if (c >= 'A' && c <= 'Z')  return (c - 'A');
+    if (c >= 'a' && c <= 'z')  return (c - 'a' + 26);
+    if (c >= '0' && c <= '9')  return (c - '0' + 52);
+    if (c == '+')  return (62);
+    if (c == '/')  return (63);
+
+    return (-1);
+}
+
+/* Bytearray from base64, padded or not */
+
+CM_DECL(unbase64)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t arg = &argv[1];
+    unsigned size, i;
+    const unsigned char *data;
+    if (!ovm_inst_bytes(arg, &size, &data))  ovm_except_inv_value(th, arg);
+    if ((size & 3) == 0 && size > 0 && data[size - 1] == '=')  size -= data[size - 2] == '=' ? 2 : 1;
+    if ((size & 3) == 1)  ovm_except_inv_value(th, arg);
+    for (i = 0; i < size; ++i) {
+        if (base64_digit_val(data[i]) < 0)  ovm_except_inv_value(th, arg);
+    }
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_obj_barray_t b = barray_newc(&work[-1], OVM_CL_BYTEARRAY, size / 4 * 3 + ((size & 3) == 0 ? 0 : (size & 3) - 1), 0);
+    unsigned char *p = b->data;
+    unsigned v = 0, k = 0;
+    for (i = 0; i < size; ++i) {
+        v = (v << 6) | base64_digit_val(data[i]);
+        if ((k += 6) >= 8) {
+            k -= 8;
+            *p++ = v >> k;
+        }
+    }
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+/* Fixed-width integers at an offset -- width 1, 2, 4 or 8 bytes, in little-
+   or big-endian order; unpacked as unsigned unless asked for signed (so an
+   unsigned 8-byte value above the Integer range wraps)
+*/
+
+static unsigned bytes_int_width(ovm_thread_t th, ovm_inst_t inst)
+{
+    ovm_intval_t w = ovm_inst_intval(th, inst);
+    if (!(w == 1 || w == 2 || w == 4 || w == 8))  ovm_except_inv_value(th, inst);
+
+    return (w);
+}
+
+static void bytes_unpack(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, bool bigf)
+{
+    CM_ARGC_RANGE_CHK(3, 4);
+    unsigned size, w = bytes_int_width(th, &argv[2]), i;
+    const unsigned char *data;
+    bytes_recvr(th, &argv[0], &size, &data);
+    ovm_intval_t ofs = ovm_inst_intval(th, &argv[1]), len = w;
+    if (!slice(&ofs, &len, size) || len != w)  ovm_except_idx_range2(th, &argv[0], &argv[1], &argv[2]);
+    bool signedf = argc > 3 && ovm_inst_boolval(th, &argv[3]);
+    data += ofs;
+    unsigned long long v = 0;
+    for (i = 0; i < w; ++i)  v = (v << 8) | data[bigf ? i : w - 1 - i];
+    if (signedf && w < 8 && (v >> (8 * w - 1)) != 0)  v |= ~0ULL << (8 * w);
+    ovm_int_newc(dst, (ovm_intval_t) v);
+}
+
+static void bytes_pack(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, bool bigf)
+{
+    CM_ARGC_CHK(4);
+    unsigned size, w = bytes_int_width(th, &argv[2]), i;
+    unsigned char *data;
+    inst_bytes_mutable(th, &argv[0], &size, &data);
+    ovm_intval_t ofs = ovm_inst_intval(th, &argv[1]), len = w;
+    if (!slice(&ofs, &len, size) || len != w)  ovm_except_idx_range2(th, &argv[0], &argv[1], &argv[2]);
+    ovm_intval_t val = ovm_inst_intval(th, &argv[3]);
+    if (w < 8 && (val < -(1LL << (8 * w - 1)) || val >= (1LL << (8 * w))))  ovm_except_inv_value(th, &argv[3]);
+    data += ofs;
+    unsigned long long v = val;
+    for (i = 0; i < w; ++i, v >>= 8)  data[bigf ? w - 1 - i : i] = v;
+    ovm_inst_assign(dst, &argv[0]);
+}
+
+CM_DECL(pack_be)
+{
+    bytes_pack(th, dst, argc, argv, true);
+}
+
+CM_DECL(pack_le)
+{
+    bytes_pack(th, dst, argc, argv, false);
+}
+
+CM_DECL(unpack_be)
+{
+    bytes_unpack(th, dst, argc, argv, true);
+}
+
+CM_DECL(unpack_le)
+{
+    bytes_unpack(th, dst, argc, argv, false);
+}
+
+/***************************************************************************/
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Cbytearray
+
+/* Method 'Boolean' inherited */
+
+/* Method 'Integer' inherited */
+
+/* Method 'String' is alias for 'write */
+
+/* Method 'List inherited */
+
+/* Method 'Array' inheritied */
+
+/* Method 'Carray' inherited */
+
+CM_DECL(new)
+{
+    CM_ARGC_CHK(1);
+    method_redirect(th, dst, OVM_STR_CONST_HASH(Cbytearray), 1, &argv[1]);
+}
+
+CM_DECL(copy)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_assign(dst, &argv[0]);
+}
+
+/* Method 'copydeep' is alias for 'copy' */
+
+/* Method 'at' inherited */
+
+/* Method 'atput' inherited */
+
+/* Method 'equal' inherited */
+
+/* Method 'size' inherited */
+
+/* Method 'slice' inherited */
+
+CM_DECL(write)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_CBYTEARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(recvr);
+    struct ovm_clist cl[1];
+    ovm_clist_init(cl);
+    ovm_clist_appendc(cl, _OVM_STR_CONST("#Cbytearray("));
+    barray_write(cl, b->size, b->data);
+    ovm_clist_append_char(cl, ')');
+    str_new_clist(dst, cl);
+    ovm_clist_fini(cl);
+}
+
+/***************************************************************************/
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Stringbuilder
+
+/* Accumulates text in a clist, so that building a string piece by piece
+   costs one copy of each piece, plus one copy when the result is taken.
+*/
+
+CM_DECL(String)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_strbuilder_t sb = ovm_inst_strbuilderval(th, &argv[0]);
+    obj_lock(sb->base);
+    str_new_clist(dst, sb->clist);
+    obj_unlock(sb->base);
+}
+
+CM_DECL(Bytearray)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_strbuilder_t sb = ovm_inst_strbuilderval(th, &argv[0]);
+    obj_lock(sb->base);
+    barray_new_clist(dst, OVM_CL_BYTEARRAY, sb->clist);
+    obj_unlock(sb->base);
+}
+
+CM_DECL(new)
+{
+    CM_ARGC_CHK(1);
+    strbuilder_new(dst);
+}
+
+CM_DECL(append)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0];
+    strbuilder_append(th, ovm_inst_strbuilderval(th, recvr), &argv[1]);
+    ovm_inst_assign(dst, recvr);
+}
+
+CM_DECL(append_all)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    ovm_obj_strbuilder_t sb = ovm_inst_strbuilderval(th, recvr);
+    if (ovm_is_subclass_of(ovm_inst_of_raw(arg), OVM_CL_ARRAY)) {
+        ovm_obj_array_t a = ovm_inst_arrayval_nochk(arg);
+        unsigned i;
+        for (i = 0; i < a->size; ++i)  strbuilder_append(th, sb, &a->data[i]);
+    } else {
+        ovm_obj_list_t li;
+        for (li = ovm_inst_listval(th, arg); li != 0; li = ovm_list_next(li))  strbuilder_append(th, sb, li->item);
+    }
+    ovm_inst_assign(dst, recvr);
+}
+
+CM_DECL(clear)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_strbuilder_t sb = ovm_inst_strbuilderval(th, recvr);
+    obj_lock(sb->base);
+    ovm_clist_fini(sb->clist);
+    obj_unlock(sb->base);
+    ovm_inst_assign(dst, recvr);
+}
+
+CM_DECL(size)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_strbuilderval(th, &argv[0])->clist->len);
+}
+
+/***************************************************************************/
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Range
+
+/* An arithmetic sequence of Integers, start inclusive, stop exclusive; a 'for'
+   over a Range counts in place, without making a List.
+*/
+
+CM_DECL(Array)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_range_t r = ovm_inst_rangeval(th, &argv[0]);
+    ovm_intval_t n = range_size(r), i;
+    if ((unsigned) n != n)  ovm_except_inv_value(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_obj_array_t a = array_newc(&work[-1], OVM_CL_ARRAY, n, 0);
+    for (i = 0; i < n; ++i)  ovm_int_newc(&a->data[i], r->start + i * r->step);
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+CM_DECL(List)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_range_t r = ovm_inst_rangeval(th, &argv[0]);
+    ovm_intval_t i;
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    for (i = range_size(r); i > 0; ) {
+        --i;
+        ovm_int_newc(&work[-1], r->start + i * r->step);
+        list_new(&work[-2], &work[-1], ovm_inst_listval_nochk(&work[-2]));
+    }
+    ovm_inst_assign(dst, &work[-2]);
+}
+
+/* Method 'String' is alias for 'write' */
+
+CM_DECL(new)
+{
+    CM_ARGC_RANGE_CHK(2, 4);
+    ovm_intval_t start = 0, stop, step = 1;
+    if (argc == 2) {
+        stop = ovm_inst_intval(th, &argv[1]);
+    } else {
+        start = ovm_inst_intval(th, &argv[1]);
+        stop  = ovm_inst_intval(th, &argv[2]);
+        if (argc == 4 && (step = ovm_inst_intval(th, &argv[3])) == 0)  ovm_except_inv_value(th, &argv[3]);
+    }
+    range_new(dst, start, stop, step);
+}
+
+CM_DECL(at)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    ovm_obj_range_t r = ovm_inst_rangeval(th, recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg), n = range_size(r);
+    if (idx < 0)  idx += n;
+    if (idx < 0 || idx >= n)  ovm_except_idx_range(th, recvr, arg);
+    ovm_int_newc(dst, r->start + idx * r->step);
+}
+
+/* Ranges are equal if they have the same elements */
+
+CM_DECL(equal)
+{
+    CM_ARGC_CHK(2);
+    bool result = false;
+    ovm_obj_range_t r = ovm_inst_rangeval(th, &argv[0]);
+    ovm_inst_t arg = &argv[1];
+    if (ovm_inst_of_raw(arg) == OVM_CL_RANGE) {
+        ovm_obj_range_t r2 = ovm_inst_rangeval_nochk(arg);
+        ovm_intval_t n = range_size(r);
+        result = (range_size(r2) == n
+                  && (n == 0 || (r->start == r2->start && (n == 1 || r->step == r2->step)))
+                  );
+    }
+    ovm_bool_newc(dst, result);
+}
+
+CM_DECL(hash)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_range_t r = ovm_inst_rangeval(th, &argv[0]);
+    ovm_intval_t n = range_size(r);
+    ovm_intval_t val[3] = { n > 0 ? r->start : 0, n, n > 1 ? r->step : 0 };
+    ovm_int_newc(dst, mem_hash(sizeof(val), val));
+}
+
+CM_DECL(size)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, range_size(ovm_inst_rangeval(th, &argv[0])));
+}
+
+CM_DECL(start)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_rangeval(th, &argv[0])->start);
+}
+
+CM_DECL(step)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_rangeval(th, &argv[0])->step);
+}
+
+CM_DECL(stop)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_rangeval(th, &argv[0])->stop);
+}
+
+CM_DECL(write)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_range_t r = ovm_inst_rangeval(th, &argv[0]);
+    char buf[3 * 8 * sizeof(r->start) + 16];
+    snprintf(buf, sizeof(buf), "Range(%lld, %lld, %lld)", r->start, r->stop, r->step);
+    str_newc1(dst, buf);
+}
+
+/***************************************************************************/
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Int64array
+
+/* Int64array and Float64array hold unboxed 64-bit elements, contiguously;
+   bulk operations run the kernels in oovm_vec.h.  The two classes share
+   these methods, which look at the receiver's class.
+*/
+
+static void numarray_obj_init(ovm_obj_t obj, va_list ap)
+{
+    ovm_obj_numarray_t a = ovm_obj_numarray(obj);
+    a->size = va_arg(ap, unsigned);
+    memset(a->i64, 0, a->size * sizeof(a->i64[0]));
+}
+
+static ovm_obj_numarray_t numarray_new(ovm_thread_t th, ovm_inst_t dst, ovm_obj_class_t cl, ovm_intval_t size, ovm_inst_t arg)
+{
+    if (size < 0 || size > (~0U - sizeof(*ovm_obj_numarray(0))) / sizeof(ovm_obj_numarray(0)->i64[0]))  ovm_except_inv_value(th, arg);
+
+    return (ovm_obj_numarray(ovm_obj_alloc(dst, sizeof(*ovm_obj_numarray(0)) + size * sizeof(ovm_obj_numarray(0)->i64[0]), cl, OVM_MEM_ALLOC_NO_HINT, numarray_obj_init, (unsigned) size)));
+}
+
+static inline bool numarray_is_float(ovm_obj_numarray_t a)
+{
+    return (ovm_obj_inst_of_raw(a->base) == OVM_CL_FLOAT64ARRAY);
+}
+
+static void numarray_at(ovm_inst_t dst, ovm_obj_numarray_t a, unsigned idx)
+{
+    if (numarray_is_float(a)) {
+        ovm_float_newc(dst, a->f64[idx]);
+    } else {
+        ovm_int_newc(dst, a->i64[idx]);
+    }
+}
+
+/* Scalar operand -- an Integer for an Int64array; an Integer or Float for a
+   Float64array
+*/
+
+static void numarray_scalar(ovm_thread_t th, ovm_obj_numarray_t a, ovm_inst_t val, int64_t *i64, double *f64)
+{
+    switch (val->type) {
+    case OVM_INST_TYPE_INT:
+        *i64 = val->intval;
+        *f64 = (double) val->intval;
+        return;
+    case OVM_INST_TYPE_FLOAT:
+        if (!numarray_is_float(a))  break;
+        *f64 = (double) val->floatval;
+        return;
+    default: ;
+    }
+
+    ovm_except_inv_value(th, val);
+}
+
+static void numarray_atput(ovm_thread_t th, ovm_obj_numarray_t a, unsigned idx, ovm_inst_t val)
+{
+    int64_t   i64;
+    double    f64;
+    numarray_scalar(th, a, val, &i64, &f64);
+    if (numarray_is_float(a)) {
+        a->f64[idx] = f64;
+    } else {
+        a->i64[idx] = i64;
+    }
+}
+
+/* Other operand of an elementwise operation -- an array of the same class
+   and size, else 0 for a scalar
+*/
+
+static ovm_obj_numarray_t numarray_operand(ovm_thread_t th, ovm_obj_numarray_t a, ovm_inst_t arg)
+{
+    if (arg->type != OVM_INST_TYPE_OBJ)  return (0);
+    if (arg->objval == 0 || ovm_obj_inst_of_raw(arg->objval) != ovm_obj_inst_of_raw(a->base))  ovm_except_inv_value(th, arg);
+    ovm_obj_numarray_t b = ovm_inst_numarrayval_nochk(arg);
+    if (b->size != a->size)  ovm_except_inv_value(th, arg);
+
+    return (b);
+}
+
+enum {
+    NUMARRAY_OP_ADD,
+    NUMARRAY_OP_SUB,
+    NUMARRAY_OP_MUL,
+    NUMARRAY_OP_DIV
+};
+
+/* r = a op b, r being a, b or a new array; a divisor of 0 is an error for
+   an Int64array
+*/
+
+static void numarray_binop(ovm_thread_t th, ovm_obj_numarray_t r, ovm_obj_numarray_t a, ovm_inst_t arg, unsigned op)
+{
+    static void (* const i64_ops[])(unsigned, int64_t *, const int64_t *, const int64_t *) = {
+        ovm_vec_i64_add, ovm_vec_i64_sub, ovm_vec_i64_mul, ovm_vec_i64_div
+    };
+    static void (* const i64_opks[])(unsigned, int64_t *, const int64_t *, int64_t) = {
+        ovm_vec_i64_addk, ovm_vec_i64_subk, ovm_vec_i64_mulk, ovm_vec_i64_divk
+    };
+    static void (* const f64_ops[])(unsigned, double *, const double *, const double *) = {
+        ovm_vec_f64_add, ovm_vec_f64_sub, ovm_vec_f64_mul, ovm_vec_f64_div
+    };
+    static void (* const f64_opks[])(unsigned, double *, const double *, double) = {
+        ovm_vec_f64_addk, ovm_vec_f64_subk, ovm_vec_f64_mulk, ovm_vec_f64_divk
+    };
+
+    ovm_obj_numarray_t b = numarray_operand(th, a, arg);
+    if (b != 0) {
+        if (numarray_is_float(a)) {
+            (*f64_ops[op])(a->size, r->f64, a->f64, b->f64);
+
+            return;
+        }
+        if (op == NUMARRAY_OP_DIV) {
+            unsigned i;
+            for (i = 0; i < b->size; ++i) {
+                if (b->i64[i] == 0)  ovm_except_inv_value(th, arg);
+            }
+        }
+        (*i64_ops[op])(a->size, r->i64, a->i64, b->i64);
+
+        return;
+    }
+
+    int64_t   i64;
+    double    f64;
+    numarray_scalar(th, a, arg, &i64, &f64);
+    if (numarray_is_float(a)) {
+        (*f64_opks[op])(a->size, r->f64, a->f64, f64);
+
+        return;
+    }
+    if (op == NUMARRAY_OP_DIV && i64 == 0)  ovm_except_inv_value(th, arg);
+    (*i64_opks[op])(a->size, r->i64, a->i64, i64);
+}
+
+static void numarray_binop_new(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, unsigned op)
+{
+    CM_ARGC_CHK(2);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_obj_numarray_t r = numarray_new(th, &work[-1], ovm_obj_inst_of_raw(a->base), a->size, &argv[0]);
+    numarray_binop(th, r, a, &argv[1], op);
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+/* Mask of the comparison, as a Bytearray of 0s and 1s */
+
+static void numarray_cmp_mask(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, unsigned op)
+{
+    static void (* const i64_ops[])(unsigned, unsigned char *, const int64_t *, const int64_t *) = {
+        ovm_vec_i64_lt, ovm_vec_i64_le, ovm_vec_i64_gt, ovm_vec_i64_ge, ovm_vec_i64_eq, ovm_vec_i64_ne
+    };
+    static void (* const i64_opks[])(unsigned, unsigned char *, const int64_t *, int64_t) = {
+        ovm_vec_i64_ltk, ovm_vec_i64_lek, ovm_vec_i64_gtk, ovm_vec_i64_gek, ovm_vec_i64_eqk, ovm_vec_i64_nek
+    };
+    static void (* const f64_ops[])(unsigned, unsigned char *, const double *, const double *) = {
+        ovm_vec_f64_lt, ovm_vec_f64_le, ovm_vec_f64_gt, ovm_vec_f64_ge, ovm_vec_f64_eq, ovm_vec_f64_ne
+    };
+    static void (* const f64_opks[])(unsigned, unsigned char *, const double *, double) = {
+        ovm_vec_f64_ltk, ovm_vec_f64_lek, ovm_vec_f64_gtk, ovm_vec_f64_gek, ovm_vec_f64_eqk, ovm_vec_f64_nek
+    };
+
+    CM_ARGC_CHK(2);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    ovm_obj_numarray_t b = numarray_operand(th, a, &argv[1]);
+    int64_t   i64 = 0;
+    double    f64 = 0;
+    if (b == 0)  numarray_scalar(th, a, &argv[1], &i64, &f64);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    unsigned char *m = barray_newc(&work[-1], OVM_CL_BYTEARRAY, a->size, 0)->data;
+    if (numarray_is_float(a)) {
+        if (b != 0) {
+            (*f64_ops[op])(a->size, m, a->f64, b->f64);
+        } else {
+            (*f64_opks[op])(a->size, m, a->f64, f64);
+        }
+    } else {
+        if (b != 0) {
+            (*i64_ops[op])(a->size, m, a->i64, b->i64);
+        } else {
+            (*i64_opks[op])(a->size, m, a->i64, i64);
+        }
+    }
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+/* Convert the elements of a in place, from Array elements */
+
+static void numarray_from_array(ovm_thread_t th, ovm_obj_numarray_t r, ovm_obj_array_t a)
+{
+    unsigned i;
+    for (i = 0; i < r->size; ++i)  numarray_atput(th, r, i, &a->data[i]);
+}
+
+/* New array of class cl, given a size, or any iterable of numbers */
+
+static void numarray_cl_new(ovm_thread_t th, ovm_inst_t dst, ovm_obj_class_t cl, ovm_inst_t arg)
+{
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    if (arg->type == OVM_INST_TYPE_INT) {
+        numarray_new(th, dst, cl, arg->intval, arg);
+
+        return;
+    }
+    ovm_obj_class_t arg_cl = ovm_inst_of_raw(arg);
+    if (arg_cl == OVM_CL_INT64ARRAY || arg_cl == OVM_CL_FLOAT64ARRAY) {
+        ovm_obj_numarray_t a = ovm_inst_numarrayval_nochk(arg);
+        ovm_obj_numarray_t r = numarray_new(th, &work[-1], cl, a->size, arg);
+        unsigned i;
+        if (arg_cl == cl) {
+            memcpy(r->i64, a->i64, a->size * sizeof(a->i64[0]));
+        } else if (cl == OVM_CL_FLOAT64ARRAY) {
+            for (i = 0; i < a->size; ++i)  r->f64[i] = (double) a->i64[i];
+        } else {
+            for (i = 0; i < a->size; ++i) {
+                double f = a->f64[i];
+                if (!(f >= -9223372036854775808.0 && f < 9223372036854775808.0))  ovm_except_inv_value(th, arg);
+                r->i64[i] = (int64_t) f;
+            }
+        }
+        ovm_inst_assign(dst, &work[-1]);
+
+        return;
+    }
+    if (ovm_is_subclass_of(arg_cl, OVM_CL_ARRAY)) {
+        ovm_inst_assign(&work[-2], arg);
+    } else {
+        method_redirect(th, &work[-2], OVM_STR_CONST_HASH(Array), 1, arg);
+    }
+    ovm_obj_array_t a = ovm_inst_arrayval(th, &work[-2]);
+    numarray_from_array(th, numarray_new(th, &work[-1], cl, a->size, arg), a);
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+CM_DECL(Array)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_obj_array_t r = array_newc(&work[-1], OVM_CL_ARRAY, a->size, 0);
+    unsigned i;
+    for (i = 0; i < a->size; ++i)  numarray_at(&r->data[i], a, i);
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+CM_DECL(List)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    unsigned i;
+    for (i = a->size; i > 0; ) {
+        --i;
+        numarray_at(&work[-1], a, i);
+        list_new(&work[-2], &work[-1], ovm_inst_listval_nochk(&work[-2]));
+    }
+    ovm_inst_assign(dst, &work[-2]);
+}
+
+CM_DECL(Float64array)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_numarrayval(th, &argv[0]);
+    numarray_cl_new(th, dst, OVM_CL_FLOAT64ARRAY, &argv[0]);
+}
+
+CM_DECL(Int64array)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_numarrayval(th, &argv[0]);
+    numarray_cl_new(th, dst, OVM_CL_INT64ARRAY, &argv[0]);
+}
+
+CM_DECL(add)
+{
+    numarray_binop_new(th, dst, argc, argv, NUMARRAY_OP_ADD);
+}
+
+CM_DECL(at)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg);
+    if (!slice1(&idx, a->size))  ovm_except_idx_range(th, recvr, arg);
+    numarray_at(dst, a, idx);
+}
+
+CM_DECL(atput)
+{
+    CM_ARGC_CHK(3);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg);
+    if (!slice1(&idx, a->size))  ovm_except_idx_range(th, recvr, arg);
+    numarray_atput(th, a, idx, &argv[2]);
+    ovm_inst_assign(dst, &argv[2]);
+}
+
+CM_DECL(copy)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    numarray_cl_new(th, dst, ovm_obj_inst_of_raw(a->base), &argv[0]);
+}
+
+/* Method 'copydeep' is alias for 'copy' */
+
+CM_DECL(div)
 {
-    CM_ARGC_CHK(3);
-    ovm_inst_t recvr = &argv[0], arg = &argv[1], val = &argv[2];
-    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTEARRAY)  ovm_except_inv_value(th, recvr);
-    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(recvr);
-    ovm_intval_t idx = ovm_inst_intval(th, arg);
-    ovm_intval_t byte = ovm_inst_intval(th, val);
-    if (!slice1(&idx, b->size))  ovm_except_idx_range(th, recvr, arg);
-    if (byte < 0 || byte > 255)  ovm_except_inv_value(th, val);
-    b->data[idx] = byte;
-    ovm_inst_assign(dst, val);
+    numarray_binop_new(th, dst, argc, argv, NUMARRAY_OP_DIV);
 }
 
-CM_DECL(cmp)
+CM_DECL(dot)
 {
     CM_ARGC_CHK(2);
-    ovm_obj_barray_t b1 = ovm_inst_barrayval(th, &argv[0]);
-    ovm_obj_barray_t b2 = ovm_inst_barrayval(th, &argv[1]);
-    unsigned size1 = b1->size, size2 = b2->size;
-    unsigned n = size1;
-    if (size2 < n)  n = size2;
-    int result = memcmp(b1->data, b2->data, n);
-    if (result == 0) {
-        result = (size1 < size2) ? -1 : ((size1 > size2) ? 1 : 0);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    ovm_obj_numarray_t b = numarray_operand(th, a, &argv[1]);
+    if (b == 0)  ovm_except_inv_value(th, &argv[1]);
+    if (numarray_is_float(a)) {
+        ovm_float_newc(dst, ovm_vec_f64_dot(a->size, a->f64, b->f64));
+    } else {
+        ovm_int_newc(dst, ovm_vec_i64_dot(a->size, a->i64, b->i64));
     }
-    ovm_int_newc(dst, result);
 }
 
 CM_DECL(equal)
 {
     CM_ARGC_CHK(2);
-    ovm_obj_barray_t b = ovm_inst_barrayval(th, &argv[0]);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
     ovm_inst_t arg = &argv[1];
     bool result = false;
-    if (ovm_is_subclass_of(ovm_inst_of_raw(arg), OVM_CL_BYTEARRAY)) {
-        ovm_obj_barray_t b2 = ovm_inst_barrayval_nochk(arg);
-        result = (b->size == b2->size && memcmp(b->data, b2->data, b->size) == 0);
+    if (ovm_inst_of_raw(arg) == ovm_obj_inst_of_raw(a->base)) {
+        ovm_obj_numarray_t b = ovm_inst_numarrayval_nochk(arg);
+        if (b->size == a->size) {
+            unsigned i;
+            if (numarray_is_float(a)) {
+                for (i = 0; i < a->size && a->f64[i] == b->f64[i]; ++i);
+                result = (i == a->size);
+            } else {
+                result = (memcmp(a->i64, b->i64, a->size * sizeof(a->i64[0])) == 0);
+            }
+        }
     }
     ovm_bool_newc(dst, result);
 }
 
-CM_DECL(size)
+CM_DECL(fill)
 {
-    CM_ARGC_CHK(1);
-    ovm_int_newc(dst, ovm_inst_barrayval(th, &argv[0])->size);
+    CM_ARGC_CHK(2);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    int64_t   i64;
+    double    f64;
+    numarray_scalar(th, a, &argv[1], &i64, &f64);
+    if (numarray_is_float(a)) {
+        ovm_vec_f64_fill(a->size, a->f64, f64);
+    } else {
+        ovm_vec_i64_fill(a->size, a->i64, i64);
+    }
+    ovm_inst_assign(dst, &argv[0]);
 }
 
-CM_DECL(slice)
+CM_DECL(mask_eq)
 {
-    CM_ARGC_CHK(3);
-    ovm_inst_t recvr = &argv[0], arg1 = &argv[1], arg2 = &argv[2];
-    ovm_obj_barray_t b = ovm_inst_barrayval(th, recvr);
-    ovm_intval_t ofs = ovm_inst_intval(th, arg1);
-    ovm_intval_t len = ovm_inst_intval(th, arg2);
-    if (!slice(&ofs, &len, b->size))  ovm_except_idx_range2(th, recvr, arg1, arg2);
-    barray_slicec(dst, ovm_obj_inst_of_raw(b->base), b, ofs, len);
+    numarray_cmp_mask(th, dst, argc, argv, OVM_VEC_CMP_EQ);
 }
 
-CM_DECL(write)
+CM_DECL(mask_ge)
 {
-    CM_ARGC_CHK(1);
-    ovm_inst_t recvr = &argv[0];
-    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTEARRAY)  ovm_except_inv_value(th, recvr);
-    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(recvr);
-    struct ovm_clist cl[1];
-    ovm_clist_init(cl);
-    ovm_clist_appendc(cl, _OVM_STR_CONST("#Bytearray(\""));
-    barray_write(cl, b->size, b->data);
-    ovm_clist_appendc(cl, _OVM_STR_CONST("\")"));
-    str_new_clist(dst, cl);
-    ovm_clist_fini(cl);
+    numarray_cmp_mask(th, dst, argc, argv, OVM_VEC_CMP_GE);
 }
 
-/***************************************************************************/
+CM_DECL(mask_gt)
+{
+    numarray_cmp_mask(th, dst, argc, argv, OVM_VEC_CMP_GT);
+}
 
-#undef  METHOD_CLASS
-#define METHOD_CLASS  Cbytearray
+CM_DECL(mask_le)
+{
+    numarray_cmp_mask(th, dst, argc, argv, OVM_VEC_CMP_LE);
+}
 
-/* Method 'Boolean' inherited */
+CM_DECL(mask_lt)
+{
+    numarray_cmp_mask(th, dst, argc, argv, OVM_VEC_CMP_LT);
+}
 
-/* Method 'Integer' inherited */
+CM_DECL(mask_ne)
+{
+    numarray_cmp_mask(th, dst, argc, argv, OVM_VEC_CMP_NE);
+}
 
-/* Method 'String' is alias for 'write */
+/* Largest element, or nil if empty */
 
-/* Method 'List inherited */
+CM_DECL(max)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    if (a->size == 0) {
+        ovm_inst_assign_obj(dst, 0);
+    } else if (numarray_is_float(a)) {
+        ovm_float_newc(dst, ovm_vec_f64_max(a->size, a->f64));
+    } else {
+        ovm_int_newc(dst, ovm_vec_i64_max(a->size, a->i64));
+    }
+}
 
-/* Method 'Array' inheritied */
+/* Smallest element, or nil if empty */
 
-/* Method 'Carray' inherited */
+CM_DECL(min)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    if (a->size == 0) {
+        ovm_inst_assign_obj(dst, 0);
+    } else if (numarray_is_float(a)) {
+        ovm_float_newc(dst, ovm_vec_f64_min(a->size, a->f64));
+    } else {
+        ovm_int_newc(dst, ovm_vec_i64_min(a->size, a->i64));
+    }
+}
+
+CM_DECL(mul)
+{
+    numarray_binop_new(th, dst, argc, argv, NUMARRAY_OP_MUL);
+}
 
 CM_DECL(new)
 {
-    CM_ARGC_CHK(1);
-    method_redirect(th, dst, OVM_STR_CONST_HASH(Cbytearray), 1, &argv[1]);
+    CM_ARGC_CHK(2);
+    numarray_cl_new(th, dst,
+                    ovm_is_subclass_of(ovm_inst_classval(th, &argv[0]), OVM_CL_FLOAT64ARRAY) ? OVM_CL_FLOAT64ARRAY : OVM_CL_INT64ARRAY,
+                    &argv[1]
+                    );
 }
 
-CM_DECL(copy)
+/* Multiply by a scalar, in place */
+
+CM_DECL(scale)
 {
-    CM_ARGC_CHK(1);
+    CM_ARGC_CHK(2);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    if (argv[1].type == OVM_INST_TYPE_OBJ)  ovm_except_inv_value(th, &argv[1]);
+    numarray_binop(th, a, a, &argv[1], NUMARRAY_OP_MUL);
     ovm_inst_assign(dst, &argv[0]);
 }
 
-/* Method 'copydeep' is alias for 'copy' */
+/* Elements where the mask -- a Bytearray of the same size -- is not 0 */
 
-/* Method 'at' inherited */
+CM_DECL(select)
+{
+    CM_ARGC_CHK(2);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    ovm_obj_barray_t m = ovm_inst_barrayval(th, &argv[1]);
+    if (m->size != a->size)  ovm_except_inv_value(th, &argv[1]);
+    unsigned i, n;
+    for (n = i = 0; i < m->size; ++i)  n += (m->data[i] != 0);
 
-/* Method 'atput' inherited */
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
 
-/* Method 'equal' inherited */
+    ovm_obj_numarray_t r = numarray_new(th, &work[-1], ovm_obj_inst_of_raw(a->base), n, &argv[0]);
+    for (n = i = 0; i < m->size; ++i) {
+        if (m->data[i] != 0)  r->i64[n++] = a->i64[i];
+    }
+    ovm_inst_assign(dst, &work[-1]);
+}
 
-/* Method 'size' inherited */
+CM_DECL(size)
+{
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, ovm_inst_numarrayval(th, &argv[0])->size);
+}
 
-/* Method 'slice' inherited */
+CM_DECL(sub)
+{
+    numarray_binop_new(th, dst, argc, argv, NUMARRAY_OP_SUB);
+}
+
+CM_DECL(sum)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+    if (numarray_is_float(a)) {
+        ovm_float_newc(dst, ovm_vec_f64_sum(a->size, a->f64));
+    } else {
+        ovm_int_newc(dst, ovm_vec_i64_sum(a->size, a->i64));
+    }
+}
+
+/* Method 'String' is alias for 'write' */
 
 CM_DECL(write)
 {
     CM_ARGC_CHK(1);
-    ovm_inst_t recvr = &argv[0];
-    if (ovm_inst_of_raw(recvr) != OVM_CL_CBYTEARRAY)  ovm_except_inv_value(th, recvr);
-    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(recvr);
+    ovm_obj_numarray_t a = ovm_inst_numarrayval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_inst_assign(&work[-1], &argv[0]);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(Array), 1);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(write), 1);
     struct ovm_clist cl[1];
     ovm_clist_init(cl);
-    ovm_clist_appendc(cl, _OVM_STR_CONST("#Cbytearray("));
-    barray_write(cl, b->size, b->data);
-    ovm_clist_append_char(cl, ')');
+    if (numarray_is_float(a)) {
+        ovm_clist_appendc(cl, _OVM_STR_CONST("#Float64array("));
+    } else {
+        ovm_clist_appendc(cl, _OVM_STR_CONST("#Int64array("));
+    }
+    ovm_clist_append_str(th, cl, ovm_inst_strval(th, &work[-1]));
+    ovm_clist_appendc(cl, _OVM_STR_CONST(")"));
     str_new_clist(dst, cl);
     ovm_clist_fini(cl);
 }
@@ -6150,54 +8447,272 @@ CM_DECL(write)
 #undef  METHOD_CLASS
 #define METHOD_CLASS  Cslice
 
-CM_DECL(Array)
+CM_DECL(Array)
+{
+}
+
+CM_DECL(List)
+{
+}
+
+CM_DECL(Cslice)
+{
+    CM_ARGC_CHK(3);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_slice_t sl = ovm_inst_sliceval(th, recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, &argv[1]), len = ovm_inst_intval(th, &argv[2]);
+    if (!slice(&idx, &len, sl->size))  ovm_except_idx_range2(th, recvr, &argv[1], &argv[2]);
+    slice_new(dst, OVM_CL_CSLICE, sl->base, idx, len);
+}
+
+CM_DECL(new)
+{
+    CM_ARGC_CHK(4);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 3);
+
+    ovm_inst_assign(&work[-3], &argv[1]);
+    ovm_inst_assign(&work[-2], &argv[2]);
+    ovm_inst_assign(&work[-1], &argv[3]);
+    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(Cslice), 3);
+}
+
+/* Method 'at' inherited */
+
+/* Method 'atput' inherited */
+
+/* Method 'size' inherited */
+
+/* Method 'hash' inherited */
+
+CM_DECL(write)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_slice_t sl = ovm_inst_sliceval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    slice_write_unsafe(th, &work[-1], sl, _OVM_STR_CONST("#Cslice(["), _OVM_STR_CONST("])"));
+
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+/***************************************************************************/
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Byteslice
+
+/* Substrings, split fields and regexp matches taken as Byteslices cost one
+   small object each, however long they are; copy one with String,
+   Bytearray or Cbytearray to keep it without keeping the whole buffer.
+   A Byteslice, which can only be of a Bytearray, writes through to it.
+*/
+
+static ovm_obj_slice_t inst_byteslice_val(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (inst->type == OVM_INST_TYPE_OBJ && inst->objval != 0 && byteslice_is(ovm_obj_inst_of_raw(inst->objval))) {
+        return (ovm_obj_slice(inst->objval));
+    }
+
+    ovm_except_inv_value(th, inst);
+}
+
+CM_DECL(Boolean)
+{
+    CM_ARGC_CHK(1);
+    ovm_bool_newc(dst, inst_byteslice_val(th, &argv[0])->size > 0);
+}
+
+CM_DECL(String)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    str_newc(dst, sl->size + 1, (const char *) ovm_byteslice_data(sl));
+}
+
+CM_DECL(List)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    unsigned n;
+    for (n = sl->size; n > 0; ) {
+        --n;
+        ovm_int_newc(&work[-1], ovm_byteslice_data(sl)[n]);
+        list_new(&work[-2], &work[-1], ovm_inst_listval_nochk(&work[-2]));
+    }
+    ovm_inst_assign(dst, &work[-2]);
+}
+
+CM_DECL(Bytearray)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    barray_newc(dst, OVM_CL_BYTEARRAY, sl->size, ovm_byteslice_data(sl));
+}
+
+CM_DECL(Cbytearray)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    barray_newc(dst, OVM_CL_CBYTEARRAY, sl->size, ovm_byteslice_data(sl));
+}
+
+CM_DECL(Byteslice)
+{
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTESLICE)  ovm_except_inv_value(th, recvr);
+    byteslice_new_args(th, dst, OVM_CL_BYTESLICE, argc, argv, ovm_inst_sliceval_nochk(recvr)->size);
+}
+
+CM_DECL(Cbyteslice)
+{
+    byteslice_new_args(th, dst, OVM_CL_CBYTESLICE, argc, argv, inst_byteslice_val(th, &argv[0])->size);
+}
+
+CM_DECL(at)
+{
+    CM_ARGC_CHK(2);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1];
+    ovm_obj_slice_t sl = inst_byteslice_val(th, recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg);
+    if (!slice1(&idx, sl->size))  ovm_except_idx_range(th, recvr, arg);
+    ovm_int_newc(dst, ovm_byteslice_data(sl)[idx]);
+}
+
+CM_DECL(atput)
+{
+    CM_ARGC_CHK(3);
+    ovm_inst_t recvr = &argv[0], arg = &argv[1], val = &argv[2];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_BYTESLICE)  ovm_except_inv_value(th, recvr);
+    ovm_obj_slice_t sl = ovm_inst_sliceval_nochk(recvr);
+    ovm_intval_t idx = ovm_inst_intval(th, arg);
+    ovm_intval_t byte = ovm_inst_intval(th, val);
+    if (!slice1(&idx, sl->size))  ovm_except_idx_range(th, recvr, arg);
+    if (byte < 0 || byte > 255)  ovm_except_inv_value(th, val);
+    ovm_byteslice_data(sl)[idx] = byte;
+    ovm_inst_assign(dst, val);
+}
+
+/* Equal to any String, Bytearray or byte slice with the same bytes */
+
+CM_DECL(equal)
+{
+    CM_ARGC_CHK(2);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    unsigned size2;
+    const unsigned char *data2;
+    ovm_bool_newc(dst, ovm_inst_bytes(&argv[1], &size2, &data2)
+                  && size2 == sl->size
+                  && memcmp(ovm_byteslice_data(sl), data2, size2) == 0
+                  );
+}
+
+CM_DECL(index)
 {
+    CM_ARGC_RANGE_CHK(2, 3);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    unsigned size2;
+    const unsigned char *data2;
+    if (!ovm_inst_bytes(&argv[1], &size2, &data2))  ovm_except_inv_value(th, &argv[1]);
+    ovm_intval_t ofs = 0;
+    if (argc == 3) {
+        ofs = ovm_inst_intval(th, &argv[2]);
+        if (!slice1(&ofs, sl->size))  ovm_except_idx_range(th, &argv[0], &argv[2]);
+    }
+    ovm_intval_t i = mem_index(sl->size, ovm_byteslice_data(sl), size2, data2, ofs);
+    if (i < 0) {
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+    ovm_int_newc(dst, i);
 }
 
-CM_DECL(List)
+CM_DECL(size)
 {
+    CM_ARGC_CHK(1);
+    ovm_int_newc(dst, inst_byteslice_val(th, &argv[0])->size);
 }
 
-CM_DECL(Cslice)
+/* Byteslice.new(x [, ofs, len]) is x.Byteslice([ofs, len]) */
+
+static void byteslice_cl_new(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, unsigned sel_size, const char *sel, unsigned sel_hash)
 {
-    CM_ARGC_CHK(3);
-    ovm_inst_t recvr = &argv[0];
-    ovm_obj_slice_t sl = ovm_inst_sliceval(th, recvr);
-    ovm_intval_t idx = ovm_inst_intval(th, &argv[1]), len = ovm_inst_intval(th, &argv[2]);
-    if (!slice(&idx, &len, sl->size))  ovm_except_idx_range2(th, recvr, &argv[1], &argv[2]);
-    slice_new(dst, OVM_CL_CSLICE, sl->base, idx, len);
+    if (!(argc == 2 || argc == 4))  ovm_except_num_args_range(th, 2, 4);
+
+    ovm_inst_t work = ovm_stack_alloc(th, argc - 1);
+
+    unsigned i;
+    for (i = 1; i < argc; ++i)  ovm_inst_assign(&work[-(int) i], &argv[argc - i]);
+    ovm_method_callsch(th, dst, sel_size, sel, sel_hash, argc - 1);
 }
 
 CM_DECL(new)
 {
-    CM_ARGC_CHK(4);
-
-    ovm_inst_t work = ovm_stack_alloc(th, 3);
-
-    ovm_inst_assign(&work[-3], &argv[1]);
-    ovm_inst_assign(&work[-2], &argv[2]);
-    ovm_inst_assign(&work[-1], &argv[3]);
-    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(Cslice), 3);
+    byteslice_cl_new(th, dst, argc, argv, OVM_STR_CONST_HASH(Byteslice));
 }
 
-/* Method 'at' inherited */
+/* Split into a List of views of the receiver's class */
 
-/* Method 'atput' inherited */
+CM_DECL(split)
+{
+    CM_ARGC_CHK(2);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    ovm_obj_class_t cl = ovm_obj_inst_of_raw(sl->base);
+    unsigned size2;
+    const unsigned char *data2;
+    if (!ovm_inst_bytes(&argv[1], &size2, &data2) || size2 == 0)  ovm_except_inv_value(th, &argv[1]);
 
-/* Method 'size' inherited */
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
 
-/* Method 'hash' inherited */
+    struct list_newlc_ctxt lc[1];
+    list_newlc_init(lc, &work[-1]);
+    unsigned ofs = 0;
+    while (ofs < sl->size) {
+        ovm_intval_t i = mem_index(sl->size, ovm_byteslice_data(sl), size2, data2, ofs);
+        unsigned k = (i < 0 ? sl->size : i) - ofs;
+        byteslice_new(&work[-2], cl, sl->base, ofs, k);
+        list_newlc_concat(lc, list_new(&work[-2], &work[-2], 0));
+        if (i < 0)  break;
+        ofs += k + size2;
+    }
+    ovm_inst_assign(dst, &work[-1]);
+}
 
 CM_DECL(write)
 {
     CM_ARGC_CHK(1);
-    ovm_obj_slice_t sl = ovm_inst_sliceval(th, &argv[0]);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    struct ovm_clist cl[1];
+    ovm_clist_init(cl);
+    if (ovm_obj_inst_of_raw(sl->base) == OVM_CL_BYTESLICE) {
+        ovm_clist_appendc(cl, _OVM_STR_CONST("#Byteslice(\""));
+    } else {
+        ovm_clist_appendc(cl, _OVM_STR_CONST("#Cbyteslice(\""));
+    }
+    barray_write(cl, sl->size, ovm_byteslice_data(sl));
+    ovm_clist_appendc(cl, _OVM_STR_CONST("\")"));
+    str_new_clist(dst, cl);
+    ovm_clist_fini(cl);
+}
 
-    ovm_inst_t work = ovm_stack_alloc(th, 1);
+/***************************************************************************/
 
-    slice_write_unsafe(th, &work[-1], sl, _OVM_STR_CONST("#Cslice(["), _OVM_STR_CONST("])"));
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Cbyteslice
 
-    ovm_inst_assign(dst, &work[-1]);
+CM_DECL(hash)
+{
+    CM_ARGC_CHK(1);
+    ovm_obj_slice_t sl = inst_byteslice_val(th, &argv[0]);
+    ovm_int_newc(dst, mem_hash(sl->size, ovm_byteslice_data(sl)));
+}
+
+CM_DECL(new)
+{
+    byteslice_cl_new(th, dst, argc, argv, OVM_STR_CONST_HASH(Cbyteslice));
 }
 
 /***************************************************************************/
@@ -6865,12 +9380,11 @@ CM_DECL(new)
     CM_ARGC_CHK(3);
     ovm_inst_t arg = &argv[1];
     ovm_obj_str_t name = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
     ovm_obj_ns_t parent = ovm_inst_nsval(th, &argv[2]);
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
 
-    ns_new(th, dst, name, arg->hash, set_newc(&work[-1], OVM_CL_DICTIONARY, 32), parent);
+    ns_new(th, dst, name, str_inst_hash(arg), set_newc(&work[-1], OVM_CL_DICTIONARY, 32), parent);
 }
 
 CM_DECL(at)
@@ -6880,8 +9394,7 @@ CM_DECL(at)
     if (!ovm_is_subclass_of(ovm_inst_of_raw(recvr), OVM_CL_NAMESPACE))  ovm_except_inv_value(th, recvr);
     ovm_inst_t k = &argv[1];
     ovm_obj_str_t s = ovm_inst_strval(th, k);
-    str_inst_hash(k);
-    if (!ns_ats(dst, ovm_inst_nsval_nochk(recvr), s->size, s->data, k->hash)) {
+    if (!ns_ats(dst, ovm_inst_nsval_nochk(recvr), s->size, s->data, str_inst_hash(k))) {
         ovm_inst_assign_obj(dst, 0);
     }
 }
@@ -6893,8 +9406,7 @@ CM_DECL(ate)
     if (!ovm_is_subclass_of(ovm_inst_of_raw(recvr), OVM_CL_NAMESPACE))  ovm_except_inv_value(th, recvr);
     ovm_inst_t k = &argv[1];
     ovm_obj_str_t s = ovm_inst_strval(th, k);
-    str_inst_hash(k);
-    if (!ns_ats(dst, ovm_inst_nsval_nochk(recvr), s->size, s->data, k->hash)) {
+    if (!ns_ats(dst, ovm_inst_nsval_nochk(recvr), s->size, s->data, str_inst_hash(k))) {
         ovm_except_no_var(th, k);
     }
     ovm_inst_assign(dst, ovm_inst_pairval_nochk(dst)->second);
@@ -6907,8 +9419,7 @@ CM_DECL(atput)
     if (!ovm_is_subclass_of(ovm_inst_of_raw(recvr), OVM_CL_NAMESPACE))  ovm_except_inv_value(th, recvr);
     ovm_inst_t k = &argv[1], val = &argv[2];
     ovm_obj_str_t s = ovm_inst_strval(th, k);
-    str_inst_hash(k);
-    ns_ats_put(th, ovm_inst_nsval_nochk(recvr), s->size, s->data, k->hash, val);
+    ns_ats_put(th, ovm_inst_nsval_nochk(recvr), s->size, s->data, str_inst_hash(k), val);
     ovm_inst_assign(dst, val);
 }
 
@@ -7152,7 +9663,6 @@ CM_DECL(new)
     CM_ARGC_CHK(2);
     ovm_inst_t arg = &argv[1];
     ovm_obj_str_t name = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
     ovm_obj_ns_t parent = ns_up(th, 1);
 
     ovm_inst_t work = ovm_stack_alloc(th, 3);
@@ -7163,7 +9673,7 @@ CM_DECL(new)
 
     char mesg[132];
     
-    if (!module_load_unsafe(th, &work[-1], name, arg->hash, ovm_inst_strval_nochk(&work[-2]), ovm_inst_strval_nochk(&work[-3]), parent, sizeof(mesg), mesg)) {
+    if (!module_load_unsafe(th, &work[-1], name, str_inst_hash(arg), ovm_inst_strval_nochk(&work[-2]), ovm_inst_strval_nochk(&work[-3]), parent, sizeof(mesg), mesg)) {
         ovm_except_module_load(th, arg, strlen(mesg) + 1, mesg);
     }
 
@@ -7235,10 +9745,82 @@ CM_DECL(new)
     file_new(dst, filename, mode, fp);
 }
 
+/* Remove a file, by name; false on error */
+
+CM_DECL(remove)
+{
+    CM_ARGC_CHK(2);
+    bool f = unlink(ovm_inst_strval(th, &argv[1])->data) == 0;
+    if (!f)  ovm_thread_errno_set(th);
+    ovm_bool_newc(dst, f);
+}
+
+/* tmp([prefix]) -- create, and open for reading and writing, a new file in
+   /tmp, with a unique name starting with the given prefix
+*/
+
+CM_DECL(tmp)
+{
+    CM_ARGC_RANGE_CHK(1, 2);
+    static const char dir[] = "/tmp/", suffix[] = "XXXXXX";
+    ovm_obj_str_t prefix = argc > 1 ? ovm_inst_strval(th, &argv[1]) : 0;
+    unsigned n = prefix == 0 ? 0 : prefix->size - 1;
+    if (n > 0 && memchr(prefix->data, '/', n) != 0)  ovm_except_inv_value(th, &argv[1]);
+    char buf[sizeof(dir) - 1 + n + sizeof(suffix)];
+    memcpy(buf, dir, sizeof(dir) - 1);
+    if (n > 0)  memcpy(buf + sizeof(dir) - 1, prefix->data, n);
+    memcpy(buf + sizeof(dir) - 1 + n, suffix, sizeof(suffix));
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    /* The name is filled in, in its new String, before anything else can
+       see it
+    */
+
+    ovm_obj_str_t filename = str_newc(&work[-1], sizeof(buf), buf);
+    ovm_obj_str_t mode = str_newc(&work[-2], _OVM_STR_CONST("w+"));
+    int fd = mkstemp(filename->data);
+    FILE *fp = fd < 0 ? 0 : fdopen(fd, mode->data);
+    if (fp == 0) {
+        ovm_thread_errno_set(th);
+        if (fd >= 0) {
+            unlink(filename->data);
+            close(fd);
+        }
+        ovm_except_file_open(th, &work[-1], &work[-2]);
+    }
+    file_new(dst, filename, mode, fp);
+}
+
+/* Close the File; any further reading or writing raises an invalid value
+   exception.  Closing it again does nothing.
+*/
+
+CM_DECL(close)
+{
+    CM_ARGC_CHK(1);
+    ovm_inst_t recvr = &argv[0];
+    ovm_obj_file_t f = ovm_inst_fileval(th, recvr);
+
+    obj_lock(f->base);
+
+    FILE *fp = f->fp;
+    f->fp = 0;
+
+    obj_unlock(f->base);
+
+    if (fp != 0) {
+        ovm_thread_io_close(fileno(fp));
+        fclose(fp);
+    }
+    ovm_inst_assign(dst, recvr);
+}
+
 CM_DECL(copy)
 {
     CM_ARGC_CHK(1);
-    file_copy(dst, ovm_inst_fileval(th, &argv[0]));
+    file_fp(th, &argv[0]);
+    file_copy(dst, ovm_inst_fileval_nochk(&argv[0]));
 }
 
 /* Method 'copydeep' alias for 'copy */
@@ -7246,14 +9828,14 @@ CM_DECL(copy)
 CM_DECL(eof)
 {
     CM_ARGC_CHK(1);
-    ovm_bool_newc(dst, feof(ovm_inst_fileval(th, &argv[0])->fp) != 0);
+    ovm_bool_newc(dst, feof(file_fp(th, &argv[0])) != 0);
 }
 
 CM_DECL(flush)
 {
     CM_ARGC_CHK(1);
     ovm_inst_t recvr = &argv[0];
-    fflush(ovm_inst_fileval(th, recvr)->fp);
+    fflush(file_fp(th, recvr));
     ovm_inst_assign(dst, recvr);
 }
 
@@ -7272,7 +9854,8 @@ CM_DECL(mode)
 CM_DECL(read)
 {
     CM_ARGC_CHK(2);
-    ovm_obj_file_t f = ovm_inst_fileval(th, &argv[0]);
+    file_fp(th, &argv[0]);
+    ovm_obj_file_t f = ovm_inst_fileval_nochk(&argv[0]);
     unsigned n = ovm_inst_intval(th, &argv[1]);
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
@@ -7294,7 +9877,8 @@ CM_DECL(read)
 CM_DECL(readb)
 {
     CM_ARGC_CHK(2);
-    ovm_obj_file_t f = ovm_inst_fileval(th, &argv[0]);
+    file_fp(th, &argv[0]);
+    ovm_obj_file_t f = ovm_inst_fileval_nochk(&argv[0]);
     unsigned n = ovm_inst_intval(th, &argv[1]);
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
@@ -7317,44 +9901,46 @@ CM_DECL(readb)
 CM_DECL(readln)
 {   
     CM_ARGC_RANGE_CHK(1, 2);
-    ovm_obj_file_t f = ovm_inst_fileval(th, &argv[0]);
-    unsigned n = 0;
-    bool unlimitedf = false;
-    if (argc == 2) {
-        n = ovm_inst_intval(th, &argv[1]);
-        if (n == 0)  unlimitedf = true;
-    } else {
-        unlimitedf = true;
-    }
-    struct ovm_clist cl[1];
-    ovm_clist_init(cl);
-    while (unlimitedf || n > 0) {
-        int c = getc(f->fp);
-        if (c < 0) {
-            if (feof(f->fp))  break;
+    file_fp(th, &argv[0]);
+    ovm_obj_file_t f = ovm_inst_fileval_nochk(&argv[0]);
+    unsigned n = argc == 2 ? ovm_inst_intval(th, &argv[1]) : 0;
+    if (!file_readln(dst, f, n))  ovm_int_newc(dst, -1);
+}
+
+/* Read all remaining lines, as an Array of Strings; -1 on error */
+
+CM_DECL(readlines)
+{
+    CM_ARGC_CHK(1);
+    file_fp(th, &argv[0]);
+    ovm_obj_file_t f = ovm_inst_fileval_nochk(&argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    array_newc(&work[-2], OVM_CL_ARRAY, 0, 0);
+    for (;;) {
+        if (!file_readln(&work[-1], f, 0)) {
             ovm_int_newc(dst, -1);
-            goto done;
+            return;
         }
-        ovm_clist_append_char(cl, c);
-        if (c == '\n')  break;
-        if (n > 0)  --n;
+        if (ovm_inst_strval_nochk(&work[-1])->size <= 1)  break;
+        array_push(th, &work[-2], &work[-1]);
     }
-    str_new_clist(dst, cl);
 
- done:
-    ovm_clist_fini(cl);
+    ovm_inst_assign(dst, &work[-2]);
 }
 
 CM_DECL(tell)
 {
     CM_ARGC_CHK(1);
-    ovm_int_newc(dst, ftell(ovm_inst_fileval(th, &argv[0])->fp));
+    ovm_int_newc(dst, ftell(file_fp(th, &argv[0])));
 }
 
 CM_DECL(unread)
 {
     CM_ARGC_CHK(2);
-    ovm_obj_file_t f = ovm_inst_fileval(th, &argv[0]);
+    file_fp(th, &argv[0]);
+    ovm_obj_file_t f = ovm_inst_fileval_nochk(&argv[0]);
     ovm_obj_str_t s = ovm_inst_strval(th, &argv[1]);
     if (s->size != 2)  ovm_except_inv_value(th, &argv[1]);
     ungetc(s->data[0], f->fp);
@@ -7392,7 +9978,7 @@ CM_DECL(write)
         a[5].data = s3;
         size += sizeof(s3) - 1;
         char ofs_buf[32];
-        snprintf(ofs_buf, sizeof(ofs_buf), "%ld", ftell(f->fp));
+        snprintf(ofs_buf, sizeof(ofs_buf), "%ld", f->fp == 0 ? -1L : ftell(f->fp));
         unsigned n = strlen(ofs_buf);
         a[6].size = n + 1;
         a[6].data = ofs_buf;
@@ -7400,7 +9986,7 @@ CM_DECL(write)
         a[7].size = sizeof(s4);
         a[7].data = s4;
         size += sizeof(s4) - 1;
-        a[8].data = bool_to_str(feof(f->fp), &a[8].size);
+        a[8].data = bool_to_str(f->fp == 0 || feof(f->fp), &a[8].size);
         size += a[8].size - 1;
         a[9].size = sizeof(s5);
         a[9].data = s5;
@@ -7411,7 +9997,7 @@ CM_DECL(write)
         return;
     }
     if (argc == 2) {
-        ovm_obj_file_t f = ovm_inst_fileval(th, &argv[0]);
+        FILE *fp = file_fp(th, &argv[0]);
         ovm_inst_t arg = &argv[1];
         ovm_obj_class_t cl = ovm_inst_of_raw(arg);
         const char *p;
@@ -7427,7 +10013,7 @@ CM_DECL(write)
         } else {
             ovm_except_inv_value(th, arg);
         }
-        ovm_int_newc(dst, fwrite(p, 1, n, f->fp));
+        ovm_int_newc(dst, fwrite(p, 1, n, fp));
 
         return;
     }
@@ -7518,6 +10104,7 @@ CM_DECL(abort)
         && ovm_inst_of_raw(&work[-1]) == OVM_CL_FILE
         ) {
         fp = ovm_inst_fileval_nochk(&work[-1])->fp;
+        if (fp == 0)  fp = stderr;
     } else {
         fp = stderr;
     }
@@ -7595,13 +10182,13 @@ void ovm_environ_atcput(ovm_thread_t th, unsigned nm_size, const char *nm, unsig
 static bool environ_at(ovm_thread_t th, ovm_inst_t dst, ovm_inst_t nm)
 {
     ovm_obj_str_t s = ovm_inst_strval(th, nm);
-    str_inst_hash(nm);
+    unsigned hash = str_hash(s);
 
     ovm_obj_ns_t ns = ns_up(th, 1), module_ns = module_cur(ns)->base;
 
-    return (ns_ats(dst, ns, s->size, s->data, nm->hash)
-            || ((module_ns != ns) && ns_ats(dst, module_ns, s->size, s->data, nm->hash))
-            || ns_ats(dst, ovm_obj_ns(ns_main), s->size, s->data, nm->hash)
+    return (ns_ats(dst, ns, s->size, s->data, hash)
+            || ((module_ns != ns) && ns_ats(dst, module_ns, s->size, s->data, hash))
+            || ns_ats(dst, ovm_obj_ns(ns_main), s->size, s->data, hash)
             );
 }
 
@@ -7623,8 +10210,7 @@ CM_DECL(atput)
     CM_ARGC_CHK(3);
     ovm_inst_t arg = &argv[1], val = &argv[2];
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
-    ns_ats_put(th, ns_up(th, 1), s->size, s->data, arg->hash, val);
+    ns_ats_put(th, ns_up(th, 1), s->size, s->data, str_inst_hash(arg), val);
     ovm_inst_assign(dst, val);
 }
 
@@ -7641,11 +10227,10 @@ CM_DECL(new)
     ovm_obj_str_t nm = ovm_inst_strval(th, &argv[1]);
     ovm_obj_class_t parent = ovm_inst_classval(th, &argv[2]);
     ovm_obj_ns_t ns = (argc == 4) ? ovm_inst_nsval(th, &argv[3]) : ns_up(th, 1);
-    str_inst_hash(&argv[1]);
 
     ovm_inst_t work = ovm_stack_alloc(th, 2);
 
-    ovm_obj_class_t cl = class_new(th, &work[-1], ns, nm->size, nm->data, argv[1].hash, parent, set_mark, set_free, 0);
+    ovm_obj_class_t cl = class_new(th, &work[-1], ns, nm->size, nm->data, str_inst_hash(&argv[1]), parent, set_mark, set_free, 0);
     ovm_codemethod_newc(&work[-2], user_cl_alloc);
     dict_ats_put(th, ovm_obj_set(cl->cl_methods), _OVM_STR_CONST_HASH("__alloc__"), &work[-2]);
 
@@ -7657,8 +10242,7 @@ CM_DECL(at)
     ovm_inst_t recvr = &argv[0], arg = &argv[1];
     ovm_obj_class_t cl = ovm_inst_classval(th, recvr);
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
-    if (!dict_ats(dst, ovm_obj_set(cl->cl_vars), s->size, s->data, arg->hash)) {
+    if (!dict_ats(dst, ovm_obj_set(cl->cl_vars), s->size, s->data, str_inst_hash(arg))) {
         ovm_inst_assign_obj(dst, 0);
     }
 }
@@ -7669,8 +10253,7 @@ CM_DECL(ate)
     ovm_inst_t recvr = &argv[0], arg = &argv[1];
     ovm_obj_class_t cl = ovm_inst_classval(th, recvr);
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
-    if (!class_ats(dst, cl, s->size, s->data, arg->hash)) {
+    if (!class_ats(dst, cl, s->size, s->data, str_inst_hash(arg))) {
         ovm_except_no_attr(th, recvr, arg);
     }
 }
@@ -7681,8 +10264,7 @@ CM_DECL(atput)
     ovm_inst_t recvr = &argv[0], arg = &argv[1], val = &argv[2];
     ovm_obj_class_t cl = ovm_inst_classval(th, recvr);
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
-    class_ats_put(th, cl, s->size, s->data, arg->hash, val);
+    class_ats_put(th, cl, s->size, s->data, str_inst_hash(arg), val);
     ovm_inst_assign(dst, val);
 }
 
@@ -7704,11 +10286,10 @@ CM_DECL(classmethod)
     ovm_inst_t arg = &argv[1];
     ovm_obj_class_t cl = ovm_inst_classval(th, &argv[0]);
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
 
     ovm_inst_t work = ovm_stack_alloc(th, 1);
     
-    if (method_findc1_unsafe(th, &work[-1], cl, CL_OFS_CL_METHODS_DICT, s->size, s->data, arg->hash, 0)) {
+    if (method_findc1_unsafe(th, &work[-1], cl, CL_OFS_CL_METHODS_DICT, s->size, s->data, str_inst_hash(arg), 0)) {
         ovm_inst_assign(dst, &work[-1]);
     } else {
         ovm_inst_assign_obj(dst, 0);
@@ -7733,11 +10314,10 @@ CM_DECL(method)
     ovm_inst_t arg = &argv[1];
     ovm_obj_class_t cl = ovm_inst_classval(th, &argv[0]);
     ovm_obj_str_t s = ovm_inst_strval(th, arg);
-    str_inst_hash(arg);
     
     ovm_inst_t work = ovm_stack_alloc(th, 1);
     
-    if (method_findc1_unsafe(th, &work[-1], cl, CL_OFS_INST_METHODS_DICT, s->size, s->data, arg->hash, 0)) {
+    if (method_findc1_unsafe(th, &work[-1], cl, CL_OFS_INST_METHODS_DICT, s->size, s->data, str_inst_hash(arg), 0)) {
         ovm_inst_assign(dst, &work[-1]);
     } else {
         ovm_inst_assign_obj(dst, 0);
@@ -7882,13 +10462,15 @@ static struct {
       .name      = {{ _OVM_STR_CONST("#Array") }},
       .parent    = &ovm_consts.Object,
       .mark      = array_mark,
-      .free      = array_free
+      .free      = array_free,
+      .cleanup   = array_cleanup
     },
     { .dst       = &ovm_consts.Carray,
       .name      = {{ _OVM_STR_CONST("#Carray") }},
       .parent    = &ovm_consts.Array,
       .mark      = array_mark,
-      .free      = array_free
+      .free      = array_free,
+      .cleanup   = array_cleanup
     },
     { .dst       = &ovm_consts.Bytearray,
       .name      = {{ _OVM_STR_CONST("#Bytearray") }},
@@ -7910,6 +10492,18 @@ static struct {
       .mark      = slice_mark,
       .free      = slice_free
     },
+    { .dst       = &ovm_consts.Byteslice,
+      .name      = {{ _OVM_STR_CONST("#Byteslice") }},
+      .parent    = &ovm_consts.Slice,
+      .mark      = slice_mark,
+      .free      = slice_free
+    },
+    { .dst       = &ovm_consts.Cbyteslice,
+      .name      = {{ _OVM_STR_CONST("#Cbyteslice") }},
+      .parent    = &ovm_consts.Byteslice,
+      .mark      = slice_mark,
+      .free      = slice_free
+    },
     { .dst       = &ovm_consts.Set,
       .name      = {{ _OVM_STR_CONST("#Set") }},
       .parent    = &ovm_consts.Object,
@@ -7975,6 +10569,24 @@ static struct {
     { .dst       = &ovm_consts.Environment,
       .name      = {{ _OVM_STR_CONST("#Environment") }},
       .parent    = &ovm_consts.Object
+    },
+    { .dst       = &ovm_consts.Stringbuilder,
+      .name      = {{ _OVM_STR_CONST("#Stringbuilder") }},
+      .parent    = &ovm_consts.Object,
+      .free      = strbuilder_cleanup,
+      .cleanup   = strbuilder_cleanup
+    },
+    { .dst       = &ovm_consts.Range,
+      .name      = {{ _OVM_STR_CONST("#Range") }},
+      .parent    = &ovm_consts.Object
+    },
+    { .dst       = &ovm_consts.Int64array,
+      .name      = {{ _OVM_STR_CONST("#Int64array") }},
+      .parent    = &ovm_consts.Object
+    },
+    { .dst       = &ovm_consts.Float64array,
+      .name      = {{ _OVM_STR_CONST("#Float64array") }},
+      .parent    = &ovm_consts.Object
     }
 };
 
@@ -8175,6 +10787,7 @@ static struct {
     METHOD_INIT(Cbytearray),
     METHOD_INIT(Slice),
     METHOD_INITF(Cslice, Slice),
+    METHOD_INIT(Cbyteslice),
     METHOD_INIT(copy),
     METHOD_INITF(copydeep, copy),
     METHOD_INITF(add, concat),
@@ -8253,6 +10866,8 @@ static struct {
     METHOD_INIT(reverse),
     METHOD_INIT(size),
     METHOD_INIT(slice),
+    METHOD_INIT(sort),
+    METHOD_INITF(sorted, sort),
     METHOD_INIT(write),
 
 #undef  METHOD_CLASS
@@ -8276,11 +10891,21 @@ static struct {
     METHOD_INIT(Cslice),
     METHOD_INIT(copy),
     METHOD_INIT(copydeep),
+    METHOD_INITF(add, concat),
+    METHOD_INIT(append),
     METHOD_INIT(at),
     METHOD_INIT(atput),
+    METHOD_INIT(capacity),
+    METHOD_INIT(concat),
     METHOD_INIT(equal),
+    METHOD_INIT(extend),
+    METHOD_INIT(insert),
+    METHOD_INIT(pop),
+    METHOD_INIT(reserve),
     METHOD_INIT(size),
     METHOD_INIT(slice),
+    METHOD_INIT(sort),
+    METHOD_INIT(sorted),
     METHOD_INIT(write),
     
 #undef  METHOD_CLASS
@@ -8308,6 +10933,8 @@ static struct {
 #define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
 
     METHOD_INIT(new),
+    METHOD_INIT(unbase64),
+    METHOD_INIT(unhex),
 
 #undef  METHOD_INIT_DICT_OFS
 #define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
@@ -8320,14 +10947,27 @@ static struct {
     METHOD_INIT(Carray),
     METHOD_INIT(Slice),
     METHOD_INIT(Cslice),
+    METHOD_INIT(Byteslice),
+    METHOD_INIT(Cbyteslice),
     METHOD_INIT(copy),
     METHOD_INITF(copydeep, copy),
+    METHOD_INITF(add, concat),
     METHOD_INIT(at),
     METHOD_INIT(atput),
+    METHOD_INIT(base64),
     METHOD_INIT(cmp),
+    METHOD_INIT(concat),
+    METHOD_INIT(count),
     METHOD_INIT(equal),
+    METHOD_INIT(find),
+    METHOD_INIT(hex),
+    METHOD_INIT(pack_be),
+    METHOD_INIT(pack_le),
+    METHOD_INIT(rfind),
     METHOD_INIT(size),
     METHOD_INIT(slice),
+    METHOD_INIT(unpack_be),
+    METHOD_INIT(unpack_le),
     METHOD_INIT(write),
 
 #undef  METHOD_CLASS
@@ -8346,6 +10986,132 @@ static struct {
     METHOD_INITF(copydeep, copy),
     METHOD_INIT(write),
     
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Stringbuilder
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
+
+    METHOD_INIT(new),
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
+
+    METHOD_INITF(Integer, size),
+    METHOD_INIT(String),
+    METHOD_INIT(Bytearray),
+    METHOD_INIT(append),
+    METHOD_INIT(append_all),
+    METHOD_INIT(clear),
+    METHOD_INIT(size),
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Range
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
+
+    METHOD_INIT(new),
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
+
+    METHOD_INIT(Array),
+    METHOD_INIT(List),
+    METHOD_INITF(String, write),
+    METHOD_INIT(at),
+    METHOD_INIT(equal),
+    METHOD_INIT(hash),
+    METHOD_INIT(size),
+    METHOD_INIT(start),
+    METHOD_INIT(step),
+    METHOD_INIT(stop),
+    METHOD_INIT(write),
+    
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Int64array
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
+
+    METHOD_INIT(new),
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
+
+    METHOD_INIT(Array),
+    METHOD_INIT(Float64array),
+    METHOD_INIT(Int64array),
+    METHOD_INIT(List),
+    METHOD_INITF(String, write),
+    METHOD_INIT(add),
+    METHOD_INIT(at),
+    METHOD_INIT(atput),
+    METHOD_INIT(copy),
+    METHOD_INITF(copydeep, copy),
+    METHOD_INIT(div),
+    METHOD_INIT(dot),
+    METHOD_INIT(equal),
+    METHOD_INIT(fill),
+    METHOD_INIT(mask_eq),
+    METHOD_INIT(mask_ge),
+    METHOD_INIT(mask_gt),
+    METHOD_INIT(mask_le),
+    METHOD_INIT(mask_lt),
+    METHOD_INIT(mask_ne),
+    METHOD_INIT(max),
+    METHOD_INIT(min),
+    METHOD_INIT(mul),
+    METHOD_INIT(scale),
+    METHOD_INIT(select),
+    METHOD_INIT(size),
+    METHOD_INIT(sub),
+    METHOD_INIT(sum),
+    METHOD_INIT(write),
+
+/* Float64array shares the Int64array methods */
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Float64array
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
+
+    METHOD_INITF2(new, Int64array, new),
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
+
+    METHOD_INITF2(Array, Int64array, Array),
+    METHOD_INITF2(Float64array, Int64array, Float64array),
+    METHOD_INITF2(Int64array, Int64array, Int64array),
+    METHOD_INITF2(List, Int64array, List),
+    METHOD_INITF2(String, Int64array, write),
+    METHOD_INITF2(add, Int64array, add),
+    METHOD_INITF2(at, Int64array, at),
+    METHOD_INITF2(atput, Int64array, atput),
+    METHOD_INITF2(copy, Int64array, copy),
+    METHOD_INITF2(copydeep, Int64array, copy),
+    METHOD_INITF2(div, Int64array, div),
+    METHOD_INITF2(dot, Int64array, dot),
+    METHOD_INITF2(equal, Int64array, equal),
+    METHOD_INITF2(fill, Int64array, fill),
+    METHOD_INITF2(mask_eq, Int64array, mask_eq),
+    METHOD_INITF2(mask_ge, Int64array, mask_ge),
+    METHOD_INITF2(mask_gt, Int64array, mask_gt),
+    METHOD_INITF2(mask_le, Int64array, mask_le),
+    METHOD_INITF2(mask_lt, Int64array, mask_lt),
+    METHOD_INITF2(mask_ne, Int64array, mask_ne),
+    METHOD_INITF2(max, Int64array, max),
+    METHOD_INITF2(min, Int64array, min),
+    METHOD_INITF2(mul, Int64array, mul),
+    METHOD_INITF2(scale, Int64array, scale),
+    METHOD_INITF2(select, Int64array, select),
+    METHOD_INITF2(size, Int64array, size),
+    METHOD_INITF2(sub, Int64array, sub),
+    METHOD_INITF2(sum, Int64array, sum),
+    METHOD_INITF2(write, Int64array, write),
+
 #undef  METHOD_CLASS
 #define METHOD_CLASS  Slice
 
@@ -8383,6 +11149,55 @@ static struct {
     METHOD_INIT(Cslice),
     METHOD_INIT(write),
 
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Byteslice
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
+
+    METHOD_INIT(new),
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
+
+    METHOD_INIT(Boolean),
+    METHOD_INIT(Bytearray),
+    METHOD_INIT(Byteslice),
+    METHOD_INIT(Cbytearray),
+    METHOD_INIT(Cbyteslice),
+    METHOD_INIT(List),
+    METHOD_INIT(String),
+    METHOD_INIT(at),
+    METHOD_INIT(atput),
+    METHOD_INITF2(base64, Bytearray, base64),
+    METHOD_INITF2(cmp, Bytearray, cmp),
+    METHOD_INITF2(count, Bytearray, count),
+    METHOD_INIT(equal),
+    METHOD_INITF2(find, Bytearray, find),
+    METHOD_INITF2(hex, Bytearray, hex),
+    METHOD_INIT(index),
+    METHOD_INITF2(pack_be, Bytearray, pack_be),
+    METHOD_INITF2(pack_le, Bytearray, pack_le),
+    METHOD_INITF2(rfind, Bytearray, rfind),
+    METHOD_INIT(size),
+    METHOD_INIT(split),
+    METHOD_INITF2(unpack_be, Bytearray, unpack_be),
+    METHOD_INITF2(unpack_le, Bytearray, unpack_le),
+    METHOD_INIT(write),
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Cbyteslice
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
+
+    METHOD_INIT(new),
+
+#undef  METHOD_INIT_DICT_OFS
+#define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
+
+    METHOD_INIT(hash),
+
 #undef  METHOD_CLASS
 #define METHOD_CLASS  Set
 
@@ -8520,12 +11335,15 @@ static struct {
 #define METHOD_INIT_DICT_OFS  CL_OFS_CL_METHODS_DICT
   
     METHOD_INIT(new),
+    METHOD_INIT(remove),
+    METHOD_INIT(tmp),
 
 #undef  METHOD_INIT_DICT_OFS
 #define METHOD_INIT_DICT_OFS  CL_OFS_INST_METHODS_DICT
 
     METHOD_INITF(Boolean, eof),
     METHOD_INITF(Integer, tell),
+    METHOD_INIT(close),
     METHOD_INIT(copy),
     METHOD_INITF(copydeep, copy),
     METHOD_INIT(eof),
@@ -8535,6 +11353,7 @@ static struct {
     METHOD_INIT(read),
     METHOD_INIT(readb),
     METHOD_INIT(readln),
+    METHOD_INIT(readlines),
     METHOD_INIT(tell),
     METHOD_INIT(unread),
     METHOD_INIT(write),
@@ -8651,6 +11470,24 @@ static void classes_init(ovm_thread_t th)
     ovm_stack_unwind(th, work);
 }
 
+static void str_chars_init(ovm_thread_t th)
+{
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    /* Entry 0 ("") last, since it enables sharing in str_newc() */
+
+    unsigned i;
+    for (i = ARRAY_SIZE(str_chars) - 1; i > 0; --i) {
+        char c = i - 1;
+        str_newc(&work[-1], 2, &c);
+        _ovm_obj_assign_nolock_norelease(&str_chars[i], work[-1].objval);
+    }
+    str_newc(&work[-1], 1, "");
+    _ovm_obj_assign_nolock_norelease(&str_chars[0], work[-1].objval);
+
+    ovm_stack_unwind(th, work);
+}
+
 /***************************************************************************/
 
 ovm_thread_t ovm_init(unsigned stack_size, unsigned frame_stack_size)
@@ -8661,6 +11498,7 @@ ovm_thread_t ovm_init(unsigned stack_size, unsigned frame_stack_size)
     objs_init();
     th = threading_init(stack_size, frame_stack_size);
     classes_init(th);
+    str_chars_init(th);
 
     return (th);
 }
@@ -49,6 +49,10 @@ extern struct ovm_consts {
     ovm_obj_t System;           /**< #System */
     ovm_obj_t User;             /**< #User */
     ovm_obj_t Environment;      /**< #Environment */
+    ovm_obj_t Stringbuilder;    /**< #Stringbuilder */
+    ovm_obj_t Range;            /**< #Range */
+    ovm_obj_t Int64array;       /**< #Int64array */
+    ovm_obj_t Float64array;     /**< #Float64array */
 } ovm_consts;
 
 /** \brief Convenience macro for #Metaclass */
@@ -107,6 +111,14 @@ extern struct ovm_consts {
 #define OVM_CL_SYSTEM       (ovm_obj_class(ovm_consts.System))
 /** \brief Convenience macro for #Environment class */
 #define OVM_CL_ENVIRONMENT  (ovm_obj_class(ovm_consts.Environment))
+/** \brief Convenience macro for #Stringbuilder class */
+#define OVM_CL_STRINGBUILDER  (ovm_obj_class(ovm_consts.Stringbuilder))
+/** \brief Convenience macro for #Range class */
+#define OVM_CL_RANGE          (ovm_obj_class(ovm_consts.Range))
+/** \brief Convenience macro for #Int64array class */
+#define OVM_CL_INT64ARRAY     (ovm_obj_class(ovm_consts.Int64array))
+/** \brief Convenience macro for #Float64array class */
+#define OVM_CL_FLOAT64ARRAY   (ovm_obj_class(ovm_consts.Float64array))
 /** \brief Convenience macro for #User class */
 #define OVM_CL_USER         (ovm_obj_class(ovm_consts.User))
 
@@ -737,8 +749,9 @@ void ovm_except_descent_loop(ovm_thread_t th) __attribute__((noreturn));
  *
  * \return Stack pointer before allocation occured
  *
- * \note Exceeding the size of the thread's stack will cause the thread to exit,
- * with the exit code OOVM_THREAD_FATAL_STACK_OVERFLOW (see oovm_thread.h).
+ * \note Exceeding the size of the thread's stack raises a system.stack-overflow
+ * exception; exceeding it while handling an exception will cause the thread to
+ * exit, with the exit code OOVM_THREAD_FATAL_STACK_OVERFLOW (see oovm_thread.h).
  */
 static inline ovm_inst_t ovm_stack_alloc(ovm_thread_t th, unsigned n)
 {
@@ -757,8 +770,9 @@ static inline ovm_inst_t ovm_stack_alloc(ovm_thread_t th, unsigned n)
  *
  * \return Nothing
  *
- * \note Exceeding the size of the thread's stack will cause the thread to exit,
- * with the exit code OOVM_THREAD_FATAL_STACK_OVERFLOW (see oovm_thread.h).
+ * \note Exceeding the size of the thread's stack raises a system.stack-overflow
+ * exception; exceeding it while handling an exception will cause the thread to
+ * exit, with the exit code OOVM_THREAD_FATAL_STACK_OVERFLOW (see oovm_thread.h).
  */
 static inline void ovm_stack_push_obj(ovm_thread_t th, ovm_obj_t obj)
 {
@@ -779,9 +793,9 @@ static inline void ovm_stack_push_obj(ovm_thread_t th, ovm_obj_t obj)
  *
  * \return Nothing
  *
- * \note Exceeding the thread's maximum stack size will cause the thread to
- * exit, with the exit code OOVM_THREAD_FATAL_STACK_OVERFLOW (see
- * oovm_thread.h).
+ * \note Exceeding the size of the thread's stack raises a system.stack-overflow
+ * exception; exceeding it while handling an exception will cause the thread to
+ * exit, with the exit code OOVM_THREAD_FATAL_STACK_OVERFLOW (see oovm_thread.h).
  */
 static inline void ovm_stack_push(ovm_thread_t th, ovm_inst_t inst)
 {
@@ -856,8 +870,7 @@ static inline void ovm_stack_free(ovm_thread_t th, unsigned n)
  * \note Giving a number of instances to free larger than the thread's current stack size will cause
  * the thread to exit, with the exit code OVM_THREAD_FATAL_STACK_UNDERFLOW.
  * Allocating a number of instances that will exceeed the thread's stack maximum
- * size size will cause
- * the thread to exit, with the exit code OVM_THREAD_FATAL_STACK_OVERFLOW.
+ * size raises a system.stack-overflow exception, as for ovm_stack_alloc().
  */
 static inline ovm_inst_t ovm_stack_free_alloc(ovm_thread_t th, unsigned size_free, unsigned size_alloc)
 {
@@ -1079,6 +1092,54 @@ static inline ovm_obj_file_t ovm_inst_fileval_nochk(ovm_inst_t inst)
     return (ovm_obj_file(inst->objval));
 }
 
+/**
+ * \brief Return string builder value of instance
+ *
+ * Return the string builder value for an instance of Stringbuilder.
+ *
+ * \param[in] inst Instance
+ *
+ * \return Stringbuilder object
+ *
+ * \note The instance is not checked that is in fact a Stringbuilder.
+ */
+static inline ovm_obj_strbuilder_t ovm_inst_strbuilderval_nochk(ovm_inst_t inst)
+{
+    return (ovm_obj_strbuilder(inst->objval));
+}
+
+/**
+ * \brief Return range value of instance
+ *
+ * Return the range value for an instance of Range.
+ *
+ * \param[in] inst Instance
+ *
+ * \return Range object
+ *
+ * \note The instance is not checked that is in fact a Range.
+ */
+static inline ovm_obj_range_t ovm_inst_rangeval_nochk(ovm_inst_t inst)
+{
+    return (ovm_obj_range(inst->objval));
+}
+
+/**
+ * \brief Return numeric array value of instance
+ *
+ * Return the numeric array value for an instance of Int64array or Float64array.
+ *
+ * \param[in] inst Instance
+ *
+ * \return Numeric array object
+ *
+ * \note The instance is not checked that is in fact an Int64array or Float64array.
+ */
+static inline ovm_obj_numarray_t ovm_inst_numarrayval_nochk(ovm_inst_t inst)
+{
+    return (ovm_obj_numarray(inst->objval));
+}
+
 /**
  * \brief Return boolean value of instance
  *
@@ -1283,6 +1344,41 @@ static inline ovm_obj_slice_t ovm_inst_sliceval(ovm_thread_t th, ovm_inst_t inst
     ovm_except_inv_value(th, inst);
 }
 
+/**
+ * \brief Return the data of a byte slice
+ *
+ * Return a pointer to the first byte of a Byteslice or Cbyteslice, in the buffer of the String, Bytearray or
+ * Cbytearray it is a view of.
+ *
+ * \param[in] sl Byteslice or Cbyteslice
+ *
+ * \return Pointer to data
+ *
+ * \note The slice is not checked that is in fact a Byteslice or Cbyteslice.
+ */
+static inline unsigned char *ovm_byteslice_data(ovm_obj_slice_t sl)
+{
+    ovm_obj_t obj = sl->underlying;
+    unsigned char *p = ovm_obj_inst_of_raw(obj) == OVM_CL_STRING
+        ? (unsigned char *) ovm_obj_str(obj)->data : ovm_obj_barray(obj)->data;
+
+    return (p + sl->ofs);
+}
+
+/**
+ * \brief Return the bytes of an instance
+ *
+ * Get the size and data of a String (not including the terminating NUL), Bytearray, Cbytearray, Byteslice or
+ * Cbyteslice.
+ *
+ * \param[in] inst Instance
+ * \param[out] size Number of bytes
+ * \param[out] data Pointer to first byte
+ *
+ * \return true iff the instance is one of the above; size and data are set only then
+ */
+bool ovm_inst_bytes(ovm_inst_t inst, unsigned *size, const unsigned char **data);
+
 static inline ovm_obj_set_t ovm_inst_setval(ovm_thread_t th, ovm_inst_t inst)
 {
     if (inst->type == OVM_INST_TYPE_OBJ) {
@@ -1339,6 +1435,37 @@ static inline ovm_obj_file_t ovm_inst_fileval(ovm_thread_t th, ovm_inst_t inst)
     ovm_except_inv_value(th, inst);
 }
 
+static inline ovm_obj_strbuilder_t ovm_inst_strbuilderval(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (inst->type == OVM_INST_TYPE_OBJ) {
+        ovm_obj_t obj = inst->objval;
+        if (ovm_obj_inst_of_raw(obj) == OVM_CL_STRINGBUILDER)  return (ovm_obj_strbuilder(obj));
+    }
+
+    ovm_except_inv_value(th, inst);
+}
+
+static inline ovm_obj_range_t ovm_inst_rangeval(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (inst->type == OVM_INST_TYPE_OBJ) {
+        ovm_obj_t obj = inst->objval;
+        if (ovm_obj_inst_of_raw(obj) == OVM_CL_RANGE)  return (ovm_obj_range(obj));
+    }
+
+    ovm_except_inv_value(th, inst);
+}
+
+static inline ovm_obj_numarray_t ovm_inst_numarrayval(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (inst->type == OVM_INST_TYPE_OBJ) {
+        ovm_obj_t obj = inst->objval;
+        ovm_obj_class_t cl = ovm_obj_inst_of_raw(obj);
+        if (cl == OVM_CL_INT64ARRAY || cl == OVM_CL_FLOAT64ARRAY)  return (ovm_obj_numarray(obj));
+    }
+
+    ovm_except_inv_value(th, inst);
+}
+
 static inline ovm_obj_class_t ovm_inst_classval(ovm_thread_t th, ovm_inst_t inst)
 {
     if (inst->type == OVM_INST_TYPE_OBJ) {
@@ -1476,7 +1603,32 @@ void ovm_str_pushc(ovm_thread_t th, unsigned size, const char *data);
 void ovm_str_pushch(ovm_thread_t th, unsigned size, const char *data, unsigned hash);
 void ovm_str_pushc1(ovm_thread_t th, const char *data);
 void ovm_str_clist(ovm_inst_t dst, struct ovm_clist *cl);
+/**
+ * \brief Create a Bytearray instance
+ *
+ * \param[out] dst Where to store new instance
+ * \param[in] size Size of Bytearray
+ * \param[in] data Initial contents; 0 for all zeros
+ *
+ * \return Nothing
+ */
 void ovm_bytearray_newc(ovm_inst_t dst, unsigned size, unsigned char *data);
+
+/**
+ * \brief Create a Byteslice instance
+ *
+ * Create a view of the given bytes of a String, Bytearray, Cbytearray or byte slice, sharing its buffer.
+ *
+ * \param[out] dst Where to store new instance
+ * \param[in] underlying Object to view
+ * \param[in] ofs Offset of first byte
+ * \param[in] size Number of bytes
+ *
+ * \return Nothing
+ *
+ * \note The offset and size are not checked against the size of the underlying object.
+ */
+void ovm_byteslice_newc(ovm_inst_t dst, ovm_obj_t underlying, unsigned ofs, unsigned size);
 void ovm_bytearray_clist(ovm_inst_t dst, struct ovm_clist *cl);
 void ovm_file_newc(ovm_thread_t th, ovm_inst_t dst, unsigned name_size, const char *name, unsigned mode_size, const char *mode, FILE *fp);
 
@@ -1740,6 +1892,79 @@ void ovm_environ_atcput(ovm_thread_t th, unsigned nm_size, const char *nm, unsig
 
 bool ovm_bool_if(ovm_thread_t th);
 
+/**
+ * \brief Start iterating
+ *
+ * Set up a cursor, for a 'for' loop.  A cursor is 3 consecutive instances; the first holds the container to
+ * iterate over, the other 2 are filled in with the position.  Strings, Arrays, Bytearrays, Slices of those, Lists,
+ * Sets and Dictionaries are iterated over in place, and Files line by line; anything else is converted with its List
+ * method.  A String, Array or Bytearray is iterated over up to its size when iteration starts, so elements appended
+ * during the loop are not visited.  A Set or Dictionary modified during the loop may have elements visited twice, or
+ * not at all.
+ *
+ * \param[in] th Thread
+ * \param[in,out] it Cursor
+ *
+ * \return Nothing
+ *
+ * \exception system.invalid-value List method of container did not return a List
+ */
+void ovm_iter_init(ovm_thread_t th, ovm_inst_t it);
+
+/**
+ * \brief Step iteration
+ *
+ * Assign the next element of the container to dst, and advance the cursor.
+ *
+ * \param[in] th Thread
+ * \param[out] dst Next element
+ * \param[in,out] it Cursor, set up by ovm_iter_init()
+ *
+ * \return true <=> There was a next element, false <=> iteration is done
+ */
+bool ovm_iter_next(ovm_thread_t th, ovm_inst_t dst, ovm_inst_t it);
+
+/**
+ * \brief Start counting
+ *
+ * Set up a cursor, for a 'for' loop over #Range.new(...) -- the loop does not create the Range.  The cursor is 3
+ * consecutive instances, holding the start, stop and step; the first is advanced as the loop goes.
+ *
+ * \param[in] th Thread
+ * \param[in] it Cursor
+ *
+ * \return Nothing
+ *
+ * \exception system.invalid-value Start, stop or step not an Integer, or step is 0
+ */
+void ovm_range_init(ovm_thread_t th, ovm_inst_t it);
+
+/**
+ * \brief Step counting
+ *
+ * Assign the next value to dst, and advance the cursor.  If dst already holds an Integer, it is updated in place.
+ *
+ * \param[out] dst Next value
+ * \param[in,out] it Cursor, set up by ovm_range_init()
+ *
+ * \return true <=> dst was assigned, false <=> counting done
+ */
+static inline bool ovm_range_next(ovm_inst_t dst, ovm_inst_t it)
+{
+    ovm_intval_t cur = it[0].intval, stop = it[1].intval, step = it[2].intval;
+    if (step > 0 ? cur >= stop : cur <= stop)  return (false);
+
+    if (dst->type == OVM_INST_TYPE_INT) {
+        dst->intval = cur;
+    } else {
+        ovm_int_newc(dst, cur);
+    }
+    if (__builtin_add_overflow(cur, step, &cur))  cur = stop;
+    it[0].intval = cur;
+
+    return (true);
+}
+
 
 
 
@@ -1,11 +1,181 @@
+/***************************************************************************
+ *
+ * oovm_hash -- Compute string hashes at build time
+ *
+ * oovm_hash <string>
+ *   Print the hash of <string>
+ *
+ * oovm_hash <infile >outfile
+ *   Copy preprocessed C source, replacing every __str_hash__("...") with
+ *   the hash of the given string literal, as a decimal constant.  This is
+ *   done in a single pass, so the hashes for a whole module cost one process.
+ *
+ ***************************************************************************/
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 
 #include "oovm_hash.h"
 
+static unsigned line = 1;
+
+static void
+error(const char *mesg)
+{
+  fprintf(stderr, "oovm_hash: line %u: %s\n", line, mesg);
+  exit(1);
+}
+
+static int
+getch(void)
+{
+  int c = getchar();
+  if (c == '\n')  ++line;
+  return (c);
+}
+
+static void
+ungetch(int c)
+{
+  if (c == '\n')  --line;
+  ungetc(c, stdin);
+}
+
+static int
+skip_space(void)
+{
+  int c;
+  while ((c = getch()) != EOF && isspace(c));
+  return (c);
+}
+
+/* Copy a string or character literal, opening quote already copied */
+
+static void
+literal_copy(int q)
+{
+  int c;
+  while ((c = getch()) != EOF) {
+    putchar(c);
+    if (c == q)  return;
+    if (c == '\\') {
+      if ((c = getch()) == EOF)  break;
+      putchar(c);
+    }
+  }
+  error("Unterminated literal");
+}
+
+/* Append the value of a string literal, opening quote already read */
+
+static void
+literal_value(unsigned *size, unsigned *bufsize, char **buf)
+{
+  int c;
+  for (;;) {
+    if ((c = getch()) == EOF)  error("Unterminated string literal");
+    if (c == '"')  return;
+    if (c == '\\') {
+      switch (c = getch()) {
+      case 'a':  c = '\a';  break;
+      case 'b':  c = '\b';  break;
+      case 'f':  c = '\f';  break;
+      case 'n':  c = '\n';  break;
+      case 'r':  c = '\r';  break;
+      case 't':  c = '\t';  break;
+      case 'v':  c = '\v';  break;
+      case 'x':
+        {
+          unsigned v = 0;
+          while (isxdigit(c = getch()))  v = (v << 4) | (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+          ungetch(c);
+          c = v & 0xff;
+        }
+        break;
+      case EOF:
+        error("Unterminated string literal");
+      default:
+        if (c >= '0' && c <= '7') {
+          unsigned v = c - '0', n;
+          for (n = 1; n < 3 && (c = getch()) >= '0' && c <= '7'; ++n)  v = (v << 3) | (c - '0');
+          if (n < 3)  ungetch(c);
+          c = v & 0xff;
+        }
+      }
+    }
+    if (*size >= *bufsize) {
+      *bufsize = *bufsize == 0 ? 64 : *bufsize << 1;
+      if ((*buf = (char *) realloc(*buf, *bufsize)) == 0)  error("Out of memory");
+    }
+    (*buf)[(*size)++] = c;
+  }
+}
+
+static void
+str_hash_subst(void)
+{
+  static unsigned bufsize;
+  static char *buf;
+  unsigned size = 0;
+
+  int c = skip_space();
+  if (c != '(')  error("Expected '(' after __str_hash__");
+  c = skip_space();
+  if (c != '"')  error("Expected string literal");
+  do {
+    literal_value(&size, &bufsize, &buf);
+  } while ((c = skip_space()) == '"'); /* Adjacent literals are concatenated */
+  if (c != ')')  error("Expected ')'");
+
+  printf("%u", mem_hash(size, buf));
+}
+
+static void
+filter(void)
+{
+  static const char kw[] = "__str_hash__";
+  unsigned id_size = 64;
+  char *id = (char *) malloc(id_size);
+  int c;
+
+  if (id == 0)  error("Out of memory");
+  while ((c = getch()) != EOF) {
+    if (c == '"' || c == '\'') {
+      putchar(c);
+      literal_copy(c);
+      continue;
+    }
+    if (!(isalpha(c) || c == '_' || c == '$')) {
+      putchar(c);
+      continue;
+    }
+
+    /* Identifier */
+
+    unsigned n = 0;
+    do {
+      if (n >= id_size && (id = (char *) realloc(id, id_size <<= 1)) == 0)  error("Out of memory");
+      id[n++] = c;
+    } while ((c = getch()) != EOF && (isalnum(c) || c == '_' || c == '$'));
+    if (c != EOF)  ungetch(c);
+    if (n == sizeof(kw) - 1 && memcmp(id, kw, n) == 0) {
+      str_hash_subst();
+      continue;
+    }
+    fwrite(id, 1, n, stdout);
+  }
+
+  free(id);
+}
+
 int main(int argc, char **argv)
 {
+  if (argc == 1) {
+    filter();
+    return (ferror(stdout) ? 1 : 0);
+  }
   if (argc != 2)  abort();
 
   char *s = argv[1];
@@ -1,16 +1,57 @@
 #ifndef __OVM_HASH_H
 #define __OVM_HASH_H
 
-#include <zlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* defined(__cplusplus) */
-  
+
+/* String hash function
+ *
+ * Multiply-and-fold hash in the style of wyhash, consuming 8 bytes per
+ * step.  It must stay bit-for-bit identical to mem_hash() in ovmc5_vm.py,
+ * which computes the selector hashes baked into compiled modules.
+ */
+
+#define MEM_HASH_P0  0xa0761d6478bd642full
+#define MEM_HASH_P1  0xe7037ed1a0b428dbull
+#define MEM_HASH_P2  0x8ebc6af09c88c6e3ull
+
+static inline uint64_t
+mem_hash_mum(uint64_t a, uint64_t b)
+{
+  __uint128_t r = (__uint128_t) a * b;
+
+  return ((uint64_t) r ^ (uint64_t) (r >> 64));
+}
+
+static inline uint64_t
+mem_hash_rd(const unsigned char *p, unsigned n) /* Little-endian load of n <= 8 bytes */
+{
+  uint64_t result = 0;
+  memcpy(&result, p, n);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  result = __builtin_bswap64(result);
+#endif
+
+  return (result);
+}
+
 static inline unsigned
 mem_hash(unsigned size, const void *data)
 {
-  return (crc32(0, (unsigned char *) data, size));
+  const unsigned char *p = (const unsigned char *) data;
+  uint64_t h = MEM_HASH_P0 ^ size;
+
+  for (; size >= 8; size -= 8, p += 8) {
+    h = mem_hash_mum(mem_hash_rd(p, 8) ^ MEM_HASH_P1, h ^ MEM_HASH_P2);
+  }
+  h = mem_hash_mum(mem_hash_rd(p, size) ^ MEM_HASH_P1, h ^ MEM_HASH_P2);
+  h = mem_hash_mum(h, MEM_HASH_P0 ^ MEM_HASH_P1);
+
+  return ((unsigned) (h ^ (h >> 32)));
 }
 
 #ifdef __cplusplus
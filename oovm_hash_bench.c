@@ -0,0 +1,117 @@
+/***************************************************************************
+ *
+ * Benchmark string hash -- mem_hash() vs zlib crc32()
+ *
+ * Hashes sets of dictionary-style keys (short identifiers and longer
+ * generated strings), reporting time per key and bucket distribution for
+ * a power-of-2 table indexed by hash & (size - 1), as in set_find().
+ *
+ * Usage: oovm_hash_bench [<number-of-keys> [<rounds>]]
+ *
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "oovm_hash.h"
+
+static unsigned
+hash_crc32(unsigned size, const void *data)
+{
+  return (crc32(0, (const unsigned char *) data, size));
+}
+
+struct key {
+  unsigned size;
+  char     *data;
+};
+
+static struct key *
+keys_gen(unsigned n, unsigned min_len, unsigned max_len)
+{
+  struct key *result = (struct key *) calloc(n, sizeof(*result));
+  unsigned i;
+  for (i = 0; i < n; ++i) {
+    unsigned k = min_len + (unsigned) rand() % (max_len - min_len + 1);
+    char *p = (char *) malloc(k + 16);
+    int m = snprintf(p, k + 16, "%c%u", (i & 1) ? 'k' : 'f', i);
+    if ((unsigned) m > k)  k = m; /* Keep keys unique */
+    for (; (unsigned) m < k; ++m)  p[m] = 'a' + rand() % 26;
+    p[k] = 0;
+    result[i].size = k;
+    result[i].data = p;
+  }
+
+  return (result);
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static void
+bench(const char *nm, unsigned (*f)(unsigned, const void *), unsigned n, struct key *keys, unsigned rounds)
+{
+  unsigned tbl_size;
+  for (tbl_size = 1; tbl_size < n; tbl_size <<= 1);
+  unsigned *tbl = (unsigned *) calloc(tbl_size, sizeof(*tbl));
+
+  volatile unsigned sink = 0;
+  double t0 = now();
+  unsigned r, i;
+  for (r = 0; r < rounds; ++r) {
+    for (i = 0; i < n; ++i)  sink += (*f)(keys[i].size, keys[i].data);
+  }
+  double t = now() - t0;
+
+  for (i = 0; i < n; ++i)  ++tbl[(*f)(keys[i].size, keys[i].data) & (tbl_size - 1)];
+  unsigned max_chain = 0, empty = 0;
+  for (i = 0; i < tbl_size; ++i) {
+    if (tbl[i] > max_chain)  max_chain = tbl[i];
+    if (tbl[i] == 0)  ++empty;
+  }
+
+  printf("  %-8s %8.2f ns/key   max chain %3u   empty buckets %5.1f%%\n",
+         nm, t * 1e9 / ((double) n * rounds), max_chain, 100.0 * empty / tbl_size
+         );
+
+  free(tbl);
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned n = argc > 1 ? atoi(argv[1]) : 100000;
+  unsigned rounds = argc > 2 ? atoi(argv[2]) : 20;
+  static const struct {
+    unsigned min_len, max_len;
+  } lens[] = {
+    { 3, 12 },                  /* Selectors, identifiers */
+    { 16, 40 },                 /* Dictionary keys, header names */
+    { 100, 300 }                /* Lines of text */
+  };
+
+  srand(1);
+  unsigned i;
+  for (i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+    struct key *keys = keys_gen(n, lens[i].min_len, lens[i].max_len);
+
+    printf("%u keys, length %u-%u, %u rounds\n", n, lens[i].min_len, lens[i].max_len, rounds);
+    bench("crc32", hash_crc32, n, keys, rounds);
+    bench("mem_hash", mem_hash, n, keys, rounds);
+
+    unsigned j;
+    for (j = 0; j < n; ++j)  free(keys[j].data);
+    free(keys);
+  }
+
+  return (0);
+}
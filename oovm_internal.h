@@ -6,6 +6,7 @@
 #endif
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +39,8 @@
 struct ovm_obj_str {                                    
     struct ovm_obj base[1];                     
     unsigned size;                              
+    unsigned hash;              /* Cached hash value */
+    bool     hash_valid;        /* true <=> Cached hash value is valid */
     char     data[0];                           
 };
 typedef struct ovm_obj_str *ovm_obj_str_t;
@@ -68,8 +71,9 @@ OBJ_CAST_FUNC(list);
 
 struct ovm_obj_array {                                  
     struct ovm_obj  base[1];                    
-    unsigned        size;                               
-    struct ovm_inst data[0];                    
+    unsigned        size, capacity;
+    struct ovm_inst *data;      /* buf, until the array outgrows it */
+    struct ovm_inst buf[0];                    
 };
 typedef struct ovm_obj_array *ovm_obj_array_t;
 OBJ_CAST_FUNC(array);
@@ -140,6 +144,8 @@ struct ovm_thread {
     bool tracef;
     int _errno;
     unsigned fatal_lvl;
+    void *co;                   /* Coroutine state, if thread is a coroutine (see thread.c) */
+    int (*io_wait)(ovm_thread_t th, int fd, unsigned events); /* Suspend coroutine until fd ready */
 };
 
 enum { OVM_FRAME_TYPE_NAMESPACE, OVM_FRAME_TYPE_METHOD_CALL, OVM_FRAME_TYPE_EXCEPTION };
@@ -174,6 +180,7 @@ struct ovm_frame_except {
     bool          arg_valid;
     ovm_inst_t    sp;
     unsigned char *pc;
+    unsigned      locks_held;   /* See _ovm_locks_held */
     jmp_buf       jb;
 };
 
@@ -182,6 +189,31 @@ struct ovm_clist {
     unsigned      len;
 };
 
+struct ovm_obj_strbuilder {
+    struct ovm_obj   base[1];
+    struct ovm_clist clist[1];
+};
+typedef struct ovm_obj_strbuilder *ovm_obj_strbuilder_t;
+OBJ_CAST_FUNC(strbuilder);
+
+struct ovm_obj_range {
+    struct ovm_obj base[1];
+    ovm_intval_t   start, stop, step;
+};
+typedef struct ovm_obj_range *ovm_obj_range_t;
+OBJ_CAST_FUNC(range);
+
+struct ovm_obj_numarray {       /* Int64array or Float64array */
+    struct ovm_obj base[1];
+    unsigned       size;
+    union {
+        int64_t    i64[0];
+        double     f64[0];
+    };
+};
+typedef struct ovm_obj_numarray *ovm_obj_numarray_t;
+OBJ_CAST_FUNC(numarray);
+
 /***************************************************************************/
 
 #define _OVM_STR_CONST(s)  sizeof(s), s
@@ -212,10 +244,21 @@ void ovm_thread_fatal(ovm_thread_t th, unsigned line, unsigned exit_code, const
 
 #define OVM_THREAD_FATAL(th, exit_code, fmt, ...)  ovm_thread_fatal((th), __LINE__, (exit_code), (fmt), ## __VA_ARGS__)
 
+void _ovm_except_stack_overflow(ovm_thread_t th) __attribute__((noreturn));
+
+/* The last instances of a stack are kept for handling an overflow, as for the
+   frame stack, see frame_push()
+*/
+
+enum { OVM_STACK_RESERVE = 64 };
+
 static inline ovm_inst_t _ovm_stack_alloc(ovm_thread_t th, unsigned n)
 {
     ovm_inst_t p = th->sp - n;
-    if (p < th->stack)  OVM_THREAD_FATAL(th, OVM_THREAD_FATAL_STACK_OVERFLOW, 0);
+    if (p < th->stack + OVM_STACK_RESERVE) {
+        if (th->except_lvl == 0)  _ovm_except_stack_overflow(th);
+        if (p < th->stack)  OVM_THREAD_FATAL(th, OVM_THREAD_FATAL_STACK_OVERFLOW, 0);
+    }
     return (p);
 }
 
@@ -231,8 +274,14 @@ static inline void _ovm_objs_unlock(void)
     pthread_mutex_unlock(ovm_objs_mutex);
 }
 
+/* Object locks, and thread.Mutexes, held by the code running on this
+   pthread -- a coroutine holding any must not let others run (see thread.c)
+*/
+
+extern __thread unsigned _ovm_locks_held;
+
 #define OVM_INST_INIT(_dst, _type, _field, _val)        \
-    _dst->type = _type;  _dst->hash_valid = false;  _dst->_field = _val
+    _dst->type = _type;  _dst->_field = _val
 
 /* Assignment
    - Lock already held
@@ -0,0 +1,231 @@
+#ifndef __OVM_PSORT_H
+#define __OVM_PSORT_H
+
+#include <string.h>
+#include <pthread.h>
+
+#include "oovm_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/* Parallel stable sort of Integer or Float instances
+ *
+ * The instances are split into one chunk per thread, and each thread sorts
+ * its chunk with a bottom-up merge sort.  Sorted chunks are then merged
+ * pairwise, in log2(nthreads) rounds; in each round, the output of every
+ * merge is divided evenly among the threads merging it, each thread
+ * finding where its share starts by binary search (co-ranking), so that
+ * all threads stay busy until the end.
+ *
+ * Workers only ever see the given buffers -- no VM objects, no VM locks --
+ * so the caller must copy instances out of, and back into, any array.
+ */
+
+enum {
+    OVM_PSORT_INT,
+    OVM_PSORT_FLOAT
+};
+
+#define OVM_PSORT_THREADS_MAX  64
+
+struct ovm_psort_ctxt {
+    void       (*round)(struct ovm_psort_ctxt *ctxt, unsigned idx);
+    unsigned   nthreads, n;
+    unsigned   width;           /* Chunks per merge input; 0 => sorting chunks */
+    ovm_inst_t src, dst;
+};
+
+static inline int
+ovm_psort_cmp_int(ovm_inst_t a, ovm_inst_t b)
+{
+    return ((a->intval > b->intval) - (a->intval < b->intval));
+}
+
+static inline int
+ovm_psort_cmp_float(ovm_inst_t a, ovm_inst_t b)
+{
+    return ((a->floatval > b->floatval) - (a->floatval < b->floatval));
+}
+
+/* Number of elements of a that come before output position k, when merging
+   a and b with ties going to a
+*/
+
+__attribute__((always_inline))
+static inline unsigned
+ovm_psort_corank(unsigned k, ovm_inst_t a, unsigned na, ovm_inst_t b, unsigned nb, int (*cmp)(ovm_inst_t, ovm_inst_t))
+{
+    unsigned lo = k > nb ? k - nb : 0, hi = k < na ? k : na;
+    while (lo < hi) {
+        unsigned i = (lo + hi) >> 1;
+        if ((*cmp)(&b[k - i - 1], &a[i]) >= 0) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+
+    return (lo);
+}
+
+/* Write positions [lo, hi) of the merge of a and b to out */
+
+__attribute__((always_inline))
+static inline void
+ovm_psort_merge(ovm_inst_t a, unsigned na, ovm_inst_t b, unsigned nb, ovm_inst_t out, unsigned lo, unsigned hi, int (*cmp)(ovm_inst_t, ovm_inst_t))
+{
+    unsigned i = ovm_psort_corank(lo, a, na, b, nb, cmp), j = lo - i, k;
+    for (k = lo; k < hi; ++k) {
+        out[k] = j >= nb || (i < na && (*cmp)(&b[j], &a[i]) >= 0) ? a[i++] : b[j++];
+    }
+}
+
+/* Sort v[0, n), using tmp[0, n) as scratch */
+
+__attribute__((always_inline))
+static inline void
+ovm_psort_chunk(ovm_inst_t v, ovm_inst_t tmp, unsigned n, int (*cmp)(ovm_inst_t, ovm_inst_t))
+{
+    enum { RUN = 32 };
+    unsigned i, j, w;
+
+    for (i = 0; i < n; i += RUN) {
+        unsigned e = n - i < RUN ? n : i + RUN;
+        for (j = i + 1; j < e; ++j) {
+            struct ovm_inst x = v[j];
+            unsigned k;
+            for (k = j; k > i && (*cmp)(&v[k - 1], &x) > 0; --k)  v[k] = v[k - 1];
+            v[k] = x;
+        }
+    }
+
+    ovm_inst_t src = v, dst = tmp, t;
+    for (w = RUN; w < n; w <<= 1) {
+        for (i = 0; i < n; i += w << 1) {
+            unsigned m = n - i < w ? n : i + w, e = n - i < (w << 1) ? n : i + (w << 1);
+            ovm_psort_merge(&src[i], m - i, &src[m], e - m, &dst[i], 0, e - i, cmp);
+        }
+        t = src;  src = dst;  dst = t;
+    }
+    if (src != v)  memcpy(v, src, n * sizeof(*v));
+}
+
+static inline unsigned
+ovm_psort_chunk_ofs(struct ovm_psort_ctxt *ctxt, unsigned k)
+{
+    if (k > ctxt->nthreads)  k = ctxt->nthreads;
+
+    return ((unsigned) ((unsigned long long) ctxt->n * k / ctxt->nthreads));
+}
+
+__attribute__((always_inline))
+static inline void
+ovm_psort_round(struct ovm_psort_ctxt *ctxt, unsigned idx, int (*cmp)(ovm_inst_t, ovm_inst_t))
+{
+    if (ctxt->width == 0) {
+        unsigned lo = ovm_psort_chunk_ofs(ctxt, idx), hi = ovm_psort_chunk_ofs(ctxt, idx + 1);
+        ovm_psort_chunk(&ctxt->src[lo], &ctxt->dst[lo], hi - lo, cmp);
+
+        return;
+    }
+
+    /* Threads g .. g + 2 * width - 1 merge chunks g .. g + width - 1 with
+       the following width chunks
+    */
+    unsigned w = ctxt->width, g = idx / (w << 1) * (w << 1);
+    unsigned nw = ctxt->nthreads - g < (w << 1) ? ctxt->nthreads - g : w << 1;
+    unsigned a = ovm_psort_chunk_ofs(ctxt, g), b = ovm_psort_chunk_ofs(ctxt, g + w), e = ovm_psort_chunk_ofs(ctxt, g + (w << 1));
+    unsigned long long total = e - a;
+    ovm_psort_merge(&ctxt->src[a], b - a, &ctxt->src[b], e - b, &ctxt->dst[a],
+                    (unsigned) (total * (idx - g) / nw), (unsigned) (total * (idx - g + 1) / nw),
+                    cmp
+                    );
+}
+
+static void
+ovm_psort_round_int(struct ovm_psort_ctxt *ctxt, unsigned idx)
+{
+    ovm_psort_round(ctxt, idx, ovm_psort_cmp_int);
+}
+
+static void
+ovm_psort_round_float(struct ovm_psort_ctxt *ctxt, unsigned idx)
+{
+    ovm_psort_round(ctxt, idx, ovm_psort_cmp_float);
+}
+
+struct ovm_psort_worker {
+    struct ovm_psort_ctxt *ctxt;
+    unsigned              idx;
+    bool                  startedf;
+    pthread_t             id;
+};
+
+static void *
+ovm_psort_worker_entry(void *arg)
+{
+    struct ovm_psort_worker *w = (struct ovm_psort_worker *) arg;
+    (*w->ctxt->round)(w->ctxt, w->idx);
+
+    return (0);
+}
+
+/* Run one round on all threads, the calling thread being thread 0; if a
+   thread cannot be started, its share is done by the caller
+*/
+
+static void
+ovm_psort_fork_join(struct ovm_psort_ctxt *ctxt, struct ovm_psort_worker *workers)
+{
+    unsigned i;
+    for (i = 1; i < ctxt->nthreads; ++i) {
+        workers[i].ctxt = ctxt;
+        workers[i].idx  = i;
+        workers[i].startedf = pthread_create(&workers[i].id, 0, ovm_psort_worker_entry, &workers[i]) == 0;
+    }
+    (*ctxt->round)(ctxt, 0);
+    for (i = 1; i < ctxt->nthreads; ++i) {
+        if (workers[i].startedf) {
+            pthread_join(workers[i].id, 0);
+        } else {
+            (*ctxt->round)(ctxt, i);
+        }
+    }
+}
+
+/* Sort v[0, n) of the given type (OVM_PSORT_INT or OVM_PSORT_FLOAT), using
+   tmp[0, n) as scratch and up to nthreads threads (including the caller)
+*/
+
+static void
+ovm_psort(unsigned nthreads, unsigned n, ovm_inst_t v, ovm_inst_t tmp, int type)
+{
+    struct ovm_psort_ctxt   ctxt[1];
+    struct ovm_psort_worker workers[OVM_PSORT_THREADS_MAX];
+
+    if (nthreads > OVM_PSORT_THREADS_MAX)  nthreads = OVM_PSORT_THREADS_MAX;
+    if (nthreads > n)  nthreads = n;
+    if (nthreads == 0)  return;
+
+    ctxt->round    = type == OVM_PSORT_FLOAT ? ovm_psort_round_float : ovm_psort_round_int;
+    ctxt->nthreads = nthreads;
+    ctxt->n        = n;
+    ctxt->width    = 0;
+    ctxt->src      = v;
+    ctxt->dst      = tmp;
+    ovm_psort_fork_join(ctxt, workers);
+
+    for (ctxt->width = 1; ctxt->width < nthreads; ctxt->width <<= 1) {
+        ovm_psort_fork_join(ctxt, workers);
+        ovm_inst_t t = ctxt->src;  ctxt->src = ctxt->dst;  ctxt->dst = t;
+    }
+    if (ctxt->src != v)  memcpy(v, ctxt->src, n * sizeof(*v));
+}
+
+#ifdef __cplusplus
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* __OVM_PSORT_H */
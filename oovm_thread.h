@@ -67,6 +67,71 @@ sp-> entry method arg 1
  */
 void *ovm_thread_entry(void *arg);
 
+/**
+ * \brief Run thread entry method
+ *
+ * Run the entry method of a thread, laid out on its instance stack as for
+ * ovm_thread_entry(), but ending at the given top of stack rather than the
+ * real one, and return.  This is for threads not run by a pthread of their
+ * own, e.g. coroutines.
+ *
+ * \param[in] th Thread
+ * \param[in] top Top of entry method layout
+ */
+void ovm_thread_run(ovm_thread_t th, ovm_inst_t top);
+
+/**
+ * \brief Destroy thread
+ *
+ * Release everything on the thread's instance stack, and free the thread.
+ * The thread must not be running.
+ *
+ * \param[in] th Thread
+ */
+void ovm_thread_destroy(ovm_thread_t th);
+
+/**
+ * \brief Set current thread
+ *
+ * Set the thread that ovm_thread_self() returns, for the calling pthread.
+ *
+ * \param[in] th Thread
+ */
+void ovm_thread_self_set(ovm_thread_t th);
+
+/**
+ * \brief Wait for I/O
+ *
+ * If the given thread is a coroutine, suspend it until the given file
+ * descriptor is ready, letting other coroutines run meanwhile.
+ *
+ * \param[in] th Thread
+ * \param[in] fd File descriptor
+ * \param[in] events Events to wait for, as for poll(), e.g. POLLIN
+ *
+ * \return 0 once the file descriptor is ready, or -1 if the thread is not a coroutine (the caller should block instead) or waiting failed
+ */
+int ovm_thread_io_wait(ovm_thread_t th, int fd, unsigned events);
+
+/**
+ * \brief Note that a file descriptor is about to be closed
+ *
+ * Coroutines of the calling pthread waiting for the file descriptor, in
+ * ovm_thread_io_wait(), are resumed, and their waits fail, with errno set to
+ * EBADF.  Call this before closing a file descriptor that coroutines may be
+ * waiting for.
+ *
+ * \param[in] fd File descriptor
+ */
+void ovm_thread_io_close(int fd);
+
+/**
+ * \brief Set what ovm_thread_io_close() calls
+ *
+ * \param[in] hook Function to call with the file descriptor, or 0 for none
+ */
+void ovm_thread_io_close_hook_set(void (*hook)(int fd));
+
 /**@}*/
 
 #endif /* __OOVM_THREAD_H */
@@ -50,7 +50,17 @@ typedef struct ovm_thread *ovm_thread_t;
 
 typedef long long          ovm_intval_t;
 typedef unsigned long long ovm_uintval_t;
-typedef long double ovm_floatval_t;
+#ifdef OVM_FLOAT_LONG_DOUBLE
+typedef long double        ovm_floatval_t;
+#define OVM_FLOATVAL_LEN_MOD  "L"       /* printf()/scanf() length modifier */
+#define OVM_FLOATVAL_FUNC(f)  f ## l    /* libm function */
+#define OVM_FLOATVAL_STRTO    strtold
+#else
+typedef double             ovm_floatval_t;
+#define OVM_FLOATVAL_LEN_MOD  "l"
+#define OVM_FLOATVAL_FUNC(f)  f
+#define OVM_FLOATVAL_STRTO    strtod
+#endif
 typedef void (*ovm_codemethod_t)(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv);
 typedef unsigned char *ovm_method_t;
 
@@ -67,13 +77,13 @@ enum {
  * \brief Instance
  *
  * An instance stores any kind of value, both an atom and a reference to an object.
+ * With the default (double) Float representation, an instance is 16 bytes; hash
+ * values are cached in the objects that need them (see struct ovm_obj_str), not here.
  * This type should be
  * considered opaque; all fields are for internal use only, and should not be touched.
  */
 struct ovm_inst {
     unsigned char type;
-    bool          hash_valid;   /* true <=> Cached hash value is valid */
-    unsigned      hash;         /* Cached hash value */
     union {
         ovm_obj_t        objval;
         bool             boolval;
@@ -0,0 +1,236 @@
+#ifndef __OVM_VEC_H
+#define __OVM_VEC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/* Bulk kernels for Int64array and Float64array
+ *
+ * Each kernel is a plain loop over unboxed elements, written so that the
+ * compiler can vectorize it.  Kernels are always compiled with -O3, so they
+ * are vectorized in a debug build too; on x86-64 with GCC, each is also
+ * cloned for AVX2, and the clone to use is picked once, at load time, from
+ * the CPU actually present.
+ *
+ * Integer arithmetic wraps, as on the scalar path, but is done unsigned so
+ * that overflow is defined.  Callers check divisors for 0.
+ */
+
+#if defined(__GNUC__) && !defined(__clang__)
+#if defined(__x86_64__) && !defined(OVM_VEC_NO_CLONES)
+#define OVM_VEC_KERNEL  __attribute__((unused, optimize("O3"), target_clones("avx2", "default"))) static
+#else
+#define OVM_VEC_KERNEL  __attribute__((unused, optimize("O3"))) static
+#endif
+#else
+#define OVM_VEC_KERNEL  __attribute__((unused)) static
+#endif
+
+enum {
+    OVM_VEC_CMP_LT,
+    OVM_VEC_CMP_LE,
+    OVM_VEC_CMP_GT,
+    OVM_VEC_CMP_GE,
+    OVM_VEC_CMP_EQ,
+    OVM_VEC_CMP_NE
+};
+
+#define OVM_VEC_U64(x)  ((uint64_t)(x))
+
+/* r[i] = a[i] op b[i], and r[i] = a[i] op k -- r may be a or b */
+
+#define OVM_VEC_BINOP(nm, t, expr)                                                      \
+    OVM_VEC_KERNEL void                                                                 \
+    ovm_vec_ ## nm(unsigned n, t *r, const t *a, const t *b)                            \
+    {                                                                                   \
+        unsigned i;                                                                     \
+        for (i = 0; i < n; ++i) {                                                       \
+            t x = a[i], y = b[i];                                                       \
+            r[i] = (expr);                                                              \
+        }                                                                               \
+    }                                                                                   \
+    OVM_VEC_KERNEL void                                                                 \
+    ovm_vec_ ## nm ## k(unsigned n, t *r, const t *a, t y)                              \
+    {                                                                                   \
+        unsigned i;                                                                     \
+        for (i = 0; i < n; ++i) {                                                       \
+            t x = a[i];                                                                 \
+            r[i] = (expr);                                                              \
+        }                                                                               \
+    }
+
+OVM_VEC_BINOP(i64_add, int64_t, (int64_t)(OVM_VEC_U64(x) + OVM_VEC_U64(y)))
+OVM_VEC_BINOP(i64_sub, int64_t, (int64_t)(OVM_VEC_U64(x) - OVM_VEC_U64(y)))
+OVM_VEC_BINOP(i64_mul, int64_t, (int64_t)(OVM_VEC_U64(x) * OVM_VEC_U64(y)))
+OVM_VEC_BINOP(i64_div, int64_t, y == -1 ? (int64_t)(0 - OVM_VEC_U64(x)) : x / y)
+OVM_VEC_BINOP(f64_add, double, x + y)
+OVM_VEC_BINOP(f64_sub, double, x - y)
+OVM_VEC_BINOP(f64_mul, double, x * y)
+OVM_VEC_BINOP(f64_div, double, x / y)
+
+/* r[i] = 1 if a[i] cmp b[i] (or k), else 0 */
+
+#define OVM_VEC_CMPOP(nm, t, op)                                                        \
+    OVM_VEC_KERNEL void                                                                 \
+    ovm_vec_ ## nm(unsigned n, unsigned char *__restrict r, const t *__restrict a, const t *__restrict b) \
+    {                                                                                   \
+        unsigned i;                                                                     \
+        for (i = 0; i < n; ++i)  r[i] = a[i] op b[i];                                   \
+    }                                                                                   \
+    OVM_VEC_KERNEL void                                                                 \
+    ovm_vec_ ## nm ## k(unsigned n, unsigned char *__restrict r, const t *__restrict a, t k) \
+    {                                                                                   \
+        unsigned i;                                                                     \
+        for (i = 0; i < n; ++i)  r[i] = a[i] op k;                                      \
+    }
+
+OVM_VEC_CMPOP(i64_lt, int64_t, <)
+OVM_VEC_CMPOP(i64_le, int64_t, <=)
+OVM_VEC_CMPOP(i64_gt, int64_t, >)
+OVM_VEC_CMPOP(i64_ge, int64_t, >=)
+OVM_VEC_CMPOP(i64_eq, int64_t, ==)
+OVM_VEC_CMPOP(i64_ne, int64_t, !=)
+OVM_VEC_CMPOP(f64_lt, double, <)
+OVM_VEC_CMPOP(f64_le, double, <=)
+OVM_VEC_CMPOP(f64_gt, double, >)
+OVM_VEC_CMPOP(f64_ge, double, >=)
+OVM_VEC_CMPOP(f64_eq, double, ==)
+OVM_VEC_CMPOP(f64_ne, double, !=)
+
+OVM_VEC_KERNEL void
+ovm_vec_i64_fill(unsigned n, int64_t *__restrict r, int64_t k)
+{
+    unsigned i;
+    for (i = 0; i < n; ++i)  r[i] = k;
+}
+
+OVM_VEC_KERNEL void
+ovm_vec_f64_fill(unsigned n, double *__restrict r, double k)
+{
+    unsigned i;
+    for (i = 0; i < n; ++i)  r[i] = k;
+}
+
+OVM_VEC_KERNEL void
+ovm_vec_i64_to_f64(unsigned n, double *__restrict r, const int64_t *__restrict a)
+{
+    unsigned i;
+    for (i = 0; i < n; ++i)  r[i] = (double) a[i];
+}
+
+OVM_VEC_KERNEL unsigned
+ovm_vec_u8_count(unsigned n, const unsigned char *__restrict a, unsigned char k)
+{
+    unsigned i, c = 0;
+    for (i = 0; i < n; ++i)  c += a[i] == k;
+
+    return (c);
+}
+
+/* Reductions -- floating-point sums keep 4 partial sums, so that they can be
+   vectorized without -ffast-math; the result can therefore differ from a
+   strictly left-to-right sum in the last bits.
+*/
+
+OVM_VEC_KERNEL int64_t
+ovm_vec_i64_sum(unsigned n, const int64_t *__restrict a)
+{
+    uint64_t s = 0;
+    unsigned i;
+    for (i = 0; i < n; ++i)  s += OVM_VEC_U64(a[i]);
+
+    return ((int64_t) s);
+}
+
+OVM_VEC_KERNEL int64_t
+ovm_vec_i64_dot(unsigned n, const int64_t *__restrict a, const int64_t *__restrict b)
+{
+    uint64_t s = 0;
+    unsigned i;
+    for (i = 0; i < n; ++i)  s += OVM_VEC_U64(a[i]) * OVM_VEC_U64(b[i]);
+
+    return ((int64_t) s);
+}
+
+OVM_VEC_KERNEL int64_t
+ovm_vec_i64_min(unsigned n, const int64_t *__restrict a)
+{
+    int64_t m = a[0];
+    unsigned i;
+    for (i = 1; i < n; ++i)  m = a[i] < m ? a[i] : m;
+
+    return (m);
+}
+
+OVM_VEC_KERNEL int64_t
+ovm_vec_i64_max(unsigned n, const int64_t *__restrict a)
+{
+    int64_t m = a[0];
+    unsigned i;
+    for (i = 1; i < n; ++i)  m = a[i] > m ? a[i] : m;
+
+    return (m);
+}
+
+OVM_VEC_KERNEL double
+ovm_vec_f64_sum(unsigned n, const double *__restrict a)
+{
+    double s[4] = { 0, 0, 0, 0 };
+    unsigned i;
+    for (i = 0; i + 4 <= n; i += 4) {
+        s[0] += a[i];
+        s[1] += a[i + 1];
+        s[2] += a[i + 2];
+        s[3] += a[i + 3];
+    }
+    for (; i < n; ++i)  s[0] += a[i];
+
+    return ((s[0] + s[1]) + (s[2] + s[3]));
+}
+
+OVM_VEC_KERNEL double
+ovm_vec_f64_dot(unsigned n, const double *__restrict a, const double *__restrict b)
+{
+    double s[4] = { 0, 0, 0, 0 };
+    unsigned i;
+    for (i = 0; i + 4 <= n; i += 4) {
+        s[0] += a[i] * b[i];
+        s[1] += a[i + 1] * b[i + 1];
+        s[2] += a[i + 2] * b[i + 2];
+        s[3] += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i)  s[0] += a[i] * b[i];
+
+    return ((s[0] + s[1]) + (s[2] + s[3]));
+}
+
+/* NaNs are skipped, unless all elements are NaN */
+
+OVM_VEC_KERNEL double
+ovm_vec_f64_min(unsigned n, const double *__restrict a)
+{
+    double m = a[0];
+    unsigned i;
+    for (i = 1; i < n; ++i)  m = a[i] < m || m != m ? a[i] : m;
+
+    return (m);
+}
+
+OVM_VEC_KERNEL double
+ovm_vec_f64_max(unsigned n, const double *__restrict a)
+{
+    double m = a[0];
+    unsigned i;
+    for (i = 1; i < n; ++i)  m = a[i] > m || m != m ? a[i] : m;
+
+    return (m);
+}
+
+#ifdef __cplusplus
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* __OVM_VEC_H */
@@ -285,6 +285,18 @@ def gen_popjt(outf, label):
     
 def gen_popjf(outf, label):
     et.SubElement(outf, 'popjf', attrib={'label': label, 'line': line_num})
+
+def gen_iter_init(outf, it):
+    et.SubElement(outf, 'iter_init', attrib={'it': it, 'line': line_num})
+
+def gen_iter_next(outf, dst, it, label):
+    et.SubElement(outf, 'iter_next', attrib={'dst': dst, 'it': it, 'label': label, 'line': line_num})
+    
+def gen_range_init(outf, it):
+    et.SubElement(outf, 'range_init', attrib={'it': it, 'line': line_num})
+
+def gen_range_next(outf, dst, it, label):
+    et.SubElement(outf, 'range_next', attrib={'dst': dst, 'it': it, 'label': label, 'line': line_num})
     
 def gen_return(outf):
     et.SubElement(outf, 'ret', attrib={'line': line_num})
@@ -728,31 +740,55 @@ def parse_cond(outf, dst, nd):
     parse_node(outf, dst, nd[0])
     break_pop(outf, fr)
 
+# Arguments of #Range.new(...), if nd is such a call, else None
+
+def for_range_args(nd):
+    if nd.tag != 'methodcall' or nd[1].get('val') != 'new':
+        return None
+    r = nd[0]
+    if r.tag != 'obj1' or r[0].get('val') != '#Range' or block_var_find('#Range') is not None:
+        return None
+    args = list(nd[2])
+    return args if 1 <= len(args) <= 3 else None
+
 def parse_for(outf, dst, nd): 
     fr_break = break_push('for')
     fr_block = block_push()
     label_continue = label_new()
     fr_loop = loop_push('for', label_continue)
-    parse_node(outf, 'push', nd[1])
-    gen_method_call(outf, 'sp[0]', 'List', 1)
-    fr_block.size = 1
+    range_args = for_range_args(nd[1])
+    if range_args is not None:
+        # Counting loop, cursor is start (lowest), stop and step
+        gen_stack_alloc(outf, 3)
+        fr_block.size = 3
+        it = dst_from_ofs(fr_block.ofs - 3)
+        if len(range_args) == 1:
+            range_args = [None] + range_args
+        for i in range(3):
+            if i < len(range_args) and range_args[i] is not None:
+                parse_node(outf, dst_from_ofs(fr_block.ofs - 3 + i), range_args[i])
+            else:
+                gen_int_newc(outf, dst_from_ofs(fr_block.ofs - 3 + i), 1 if i == 2 else 0)
+        gen_range_init(outf, it)
+        gen_next = gen_range_next
+    else:
+        # Cursor is 3 slots, container in the lowest
+        gen_stack_alloc(outf, 2)
+        parse_node(outf, 'push', nd[1])
+        fr_block.size = 3
+        it = dst_from_ofs(fr_block.ofs - 3)
+        gen_iter_init(outf, it)
+        gen_next = gen_iter_next
     var = nd[0].get('val')
     if block_var_add_soft(outf, var):
-        get_stack_push(outf, 'sp[0]')
+        gen_stack_alloc(outf, 1)
     vofs = block_var_mark_defined(var)
     vdst = dst_from_ofs(vofs)
-    label_loop = label_new()
     label_done = label_new()
-    gen_label(outf, label_loop)
-    gen_stack_push(outf, 'sp[0]')
-    gen_method_call(outf, 'sp[0]', 'isnil', 1)
-    gen_popjt(outf, label_done)
-    gen_method_call(outf, vdst, 'car', 1)
+    gen_label(outf, label_continue)
+    gen_next(outf, vdst, it, label_done)
     parse_node(outf, None, nd[2])
-    if fr_loop.continue_label_used:
-        gen_label(outf, label_continue)
-    gen_method_call(outf, 'sp[0]', 'cdr', 1)
-    gen_jmp(outf, label_loop)
+    gen_jmp(outf, label_continue)
     gen_label(outf, label_done)
     cstack_pop(fr_loop)
     block_pop(outf, fr_block)
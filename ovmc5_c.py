@@ -60,10 +60,10 @@ def gen_int_pushc(outf, nd):
     outf.write('ovm_int_pushc(th, {});\n'.format(nd.get('val')))
 
 def gen_float_newc(outf, nd):
-    outf.write('ovm_float_newc({}, {});\n'.format(gen_src_dst(nd.get('dst')), nd.get('val')))
+    outf.write('ovm_float_newc({}, {});\n'.format(gen_src_dst(nd.get('dst')), float(nd.get('val')).hex()))
 
 def gen_float_pushc(outf, nd):
-    outf.write('ovm_float_pushc(th, {});\n'.format(nd.get('val')))
+    outf.write('ovm_float_pushc(th, {});\n'.format(float(nd.get('val')).hex()))
 
 def gen_method_newc(outf, nd):
     outf.write('ovm_codemethod_newc({}, {});\n'.format(gen_src_dst(nd.get('dst')), nd.get('func')))
@@ -101,6 +101,18 @@ def gen_jf(outf, nd):
 def gen_jmp(outf, nd):
     outf.write('goto {};\n'.format(nd.get('label')))
 
+def gen_iter_init(outf, nd):
+    outf.write('ovm_iter_init(th, {});\n'.format(gen_src_dst(nd.get('it'))))
+
+def gen_iter_next(outf, nd):
+    outf.write('if (!ovm_iter_next(th, {}, {}))  goto {};\n'.format(gen_src_dst(nd.get('dst')), gen_src_dst(nd.get('it')), nd.get('label')))
+
+def gen_range_init(outf, nd):
+    outf.write('ovm_range_init(th, {});\n'.format(gen_src_dst(nd.get('it'))))
+
+def gen_range_next(outf, nd):
+    outf.write('if (!ovm_range_next({}, {}))  goto {};\n'.format(gen_src_dst(nd.get('dst')), gen_src_dst(nd.get('it')), nd.get('label')))
+
 def gen_environ_at(outf, nd):
     outf.write('ovm_environ_atc(th, {}, _OVM_STR_CONST_HASH("{}"));\n'.format(gen_src_dst(nd.get('dst')), nd.get('name')))
 
@@ -4,7 +4,6 @@
 
 import sys
 import xml.etree.ElementTree as et
-import zlib
 
 
 def byte(x, n):
@@ -67,8 +66,33 @@ def gen_str(s):
     li = str_to_bytes(s)
     return gen_uint(len(li)) + li
 
+# String hash, must match mem_hash() in oovm_hash.h
+
+MEM_HASH_P0 = 0xa0761d6478bd642f
+MEM_HASH_P1 = 0xe7037ed1a0b428db
+MEM_HASH_P2 = 0x8ebc6af09c88c6e3
+MASK64 = (1 << 64) - 1
+
+def mem_hash_mum(a, b):
+    r = a * b
+    return (r ^ (r >> 64)) & MASK64
+
+def mem_hash_rd(li, i, n):
+    return sum(li[i + k] << (8 * k) for k in range(n))
+
+def mem_hash(li):
+    n = len(li)
+    h = MEM_HASH_P0 ^ n
+    i = 0
+    while n - i >= 8:
+        h = mem_hash_mum(mem_hash_rd(li, i, 8) ^ MEM_HASH_P1, h ^ MEM_HASH_P2)
+        i += 8
+    h = mem_hash_mum(mem_hash_rd(li, i, n - i) ^ MEM_HASH_P1, h ^ MEM_HASH_P2)
+    h = mem_hash_mum(h, MEM_HASH_P0 ^ MEM_HASH_P1)
+    return (h ^ (h >> 32)) & 0xffffffff
+
 def gen_str_hash(s):
-    return gen_str(s) + gen_uint32(zlib.crc32(s))
+    return gen_str(s) + gen_uint32(mem_hash(str_to_bytes(s)[:-1]))
 
 src_dst_base_regs = {'sp': 0, 'bp': 1 << 3, 'ap': 2 << 3}
 
@@ -190,6 +214,18 @@ def gen_jx(nd):
 def gen_jmp(nd):
     code_append(nd, symbol_ref_add(nd, [0x35], nd.get('label')))
 
+def gen_iter_next(nd):
+    code_append(nd, symbol_ref_add(nd, [0x36] + gen_src_dst(nd.get('dst')) + gen_src_dst(nd.get('it')), nd.get('label')))
+
+def gen_iter_init(nd):
+    code_append(nd, [0x60] + gen_src_dst(nd.get('it')))
+
+def gen_range_next(nd):
+    code_append(nd, symbol_ref_add(nd, [0x37] + gen_src_dst(nd.get('dst')) + gen_src_dst(nd.get('it')), nd.get('label')))
+
+def gen_range_init(nd):
+    code_append(nd, [0x61] + gen_src_dst(nd.get('it')))
+
 def gen_environ_at(nd):
     code_append(nd, [0x40] + gen_src_dst(nd.get('dst')) + gen_str_hash(nd.get('name')))
 
@@ -292,7 +328,7 @@ def listing_node(nd):
     else:
         sys.stdout.write('\t{}'.format(t))
         sep = '\t'
-        for k in ['dst', 'src', 'sel', 'argc', 'name', 'label', 'func', 'val', 'size', 'size_free', 'size_alloc']:
+        for k in ['dst', 'src', 'it', 'sel', 'argc', 'name', 'label', 'func', 'val', 'size', 'size_free', 'size_alloc']:
             v = nd.attrib.get(k)
             if v is None:
                 continue
@@ -0,0 +1,122 @@
+/***************************************************************************
+ *
+ * Benchmark parallel sort -- ovm_psort() on 1 .. N threads vs qsort()
+ *
+ * Sorts arrays of random Integer and Float instances, as Array.psort() does
+ * after copying them out of the array, and reports time and speedup over
+ * 1 thread for each thread count, doubling up to N.
+ *
+ * Usage: psort_bench [<number-of-elements> [<max-threads> [<rounds>]]]
+ *
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "oovm_psort.h"
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static int
+qsort_cmp_int(const void *a, const void *b)
+{
+  return (ovm_psort_cmp_int((ovm_inst_t) a, (ovm_inst_t) b));
+}
+
+static int
+qsort_cmp_float(const void *a, const void *b)
+{
+  return (ovm_psort_cmp_float((ovm_inst_t) a, (ovm_inst_t) b));
+}
+
+static void
+fill(ovm_inst_t v, unsigned n, int type)
+{
+  unsigned i;
+  for (i = 0; i < n; ++i) {
+    if (type == OVM_PSORT_FLOAT) {
+      v[i].type     = OVM_INST_TYPE_FLOAT;
+      v[i].floatval = (double) rand() / RAND_MAX - 0.5;
+    } else {
+      v[i].type   = OVM_INST_TYPE_INT;
+      v[i].intval = ((long long) rand() << 16) ^ rand();
+    }
+  }
+}
+
+static void
+chk(ovm_inst_t v, unsigned n, int type)
+{
+  unsigned i;
+  for (i = 1; i < n; ++i) {
+    if ((type == OVM_PSORT_FLOAT ? ovm_psort_cmp_float : ovm_psort_cmp_int)(&v[i - 1], &v[i]) > 0) {
+      fprintf(stderr, "psort_bench: not sorted at %u\n", i);
+      exit(1);
+    }
+  }
+}
+
+static void
+bench(const char *nm, int type, unsigned n, unsigned max_threads, unsigned rounds)
+{
+  ovm_inst_t src = (ovm_inst_t) malloc(n * sizeof(*src));
+  ovm_inst_t v   = (ovm_inst_t) malloc(n * sizeof(*v));
+  ovm_inst_t tmp = (ovm_inst_t) malloc(n * sizeof(*tmp));
+  unsigned   r, k;
+  double     t, t1 = 0;
+
+  fill(src, n, type);
+
+  printf("%u %s, %u rounds\n", n, nm, rounds);
+
+  for (t = 0, r = 0; r < rounds; ++r) {
+    memcpy(v, src, n * sizeof(*v));
+    double t0 = now();
+    qsort(v, n, sizeof(*v), type == OVM_PSORT_FLOAT ? qsort_cmp_float : qsort_cmp_int);
+    t += now() - t0;
+  }
+  printf("  qsort        %8.2f ms\n", t * 1e3 / rounds);
+
+  for (k = 1; k <= max_threads; k = k < max_threads && (k << 1) > max_threads ? max_threads : k << 1) {
+    for (t = 0, r = 0; r < rounds; ++r) {
+      memcpy(v, src, n * sizeof(*v));
+      double t0 = now();
+      ovm_psort(k, n, v, tmp, type);
+      t += now() - t0;
+    }
+    chk(v, n, type);
+    if (k == 1)  t1 = t;
+    printf("  %2u thread(s) %8.2f ms   speedup %5.2f\n", k, t * 1e3 / rounds, t1 / t);
+  }
+
+  free(tmp);
+  free(v);
+  free(src);
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned n = argc > 1 ? atoi(argv[1]) : 1000000;
+  unsigned max_threads = argc > 2 ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned rounds = argc > 3 ? atoi(argv[3]) : 5;
+
+  if (max_threads < 1)  max_threads = 1;
+  if (max_threads > OVM_PSORT_THREADS_MAX)  max_threads = OVM_PSORT_THREADS_MAX;
+
+  srand(1);
+  bench("Integers", OVM_PSORT_INT, n, max_threads, rounds);
+  bench("Floats", OVM_PSORT_FLOAT, n, max_threads, rounds);
+
+  return (0);
+}
@@ -1,4 +1,5 @@
 #include <sys/types.h>
+#include <string.h>
 #include <regex.h>
 
 #include "oovm.h"
@@ -69,19 +70,44 @@ CM_DECL(new)
   ovm_inst_assign(dst, &work[-1]);
 }
 
+/* The subject of a match is a String, or a Byteslice or Cbyteslice; for a
+   byte slice, the matched substrings are returned as Cbyteslices of it,
+   rather than copied out as Strings.
+*/
+
 CM_DECL(match)
 {
   ovm_method_argc_chk_range(th, 2, 3);
   ovm_obj_regexp_t re = ovm_inst_reval(th, &argv[0]);
-  ovm_obj_str_t s = ovm_inst_strval(th, &argv[1]);
+  ovm_inst_t subj = &argv[1];
+  ovm_obj_class_t cl = ovm_inst_of_raw(subj);
+  bool slicef = (cl == OVM_CL_BYTESLICE || cl == OVM_CL_CBYTESLICE);
+  ovm_obj_str_t s = slicef ? 0 : ovm_inst_strval(th, subj);
   ovm_intval_t n = 0;
   if (argc == 3) {
     n  = ovm_inst_intval(th, &argv[2]);
     if (n < 0)  ovm_except_inv_value(th, &argv[2]);
   }
 
-  regmatch_t m[n];
-  if (regexec(re->re, s->data, n, m, 0) != 0) {
+  regmatch_t m[n > 0 ? n : 1];
+  int rc;
+  if (slicef) {
+    ovm_obj_slice_t sl = ovm_inst_sliceval_nochk(subj);
+    const char *p = (const char *) ovm_byteslice_data(sl);
+#ifdef REG_STARTEND
+    m[0].rm_so = 0;
+    m[0].rm_eo = sl->size;
+    rc = regexec(re->re, p, n, m, REG_STARTEND);
+#else
+    char buf[sl->size + 1];
+    memcpy(buf, p, sl->size);
+    buf[sl->size] = 0;
+    rc = regexec(re->re, buf, n, m, 0);
+#endif
+  } else {
+    rc = regexec(re->re, s->data, n, m, 0);
+  }
+  if (rc != 0) {
     ovm_inst_assign_obj(dst, 0);
     return;
   }
@@ -97,7 +123,18 @@ CM_DECL(match)
   ovm_method_callsch(th, &work[-3], OVM_STR_CONST_HASH(new), 2);
   for (i = 0; i < k; ++i) {
     ovm_int_newc(&work[-2], i);
-    ovm_str_newc(&work[-1], m[i].rm_eo + 1 - m[i].rm_so, s->data + m[i].rm_so);
+    if (slicef) {
+      ovm_inst_t work2 = ovm_stack_alloc(th, 3);
+
+      ovm_inst_assign(&work2[-3], subj);
+      ovm_int_newc(&work2[-2], m[i].rm_so);
+      ovm_int_newc(&work2[-1], m[i].rm_eo - m[i].rm_so);
+      ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(Cbyteslice), 3);
+
+      ovm_stack_unwind(th, work2);
+    } else {
+      ovm_str_newc(&work[-1], m[i].rm_eo + 1 - m[i].rm_so, s->data + m[i].rm_so);
+    }
     ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(atput), 3);
   }
   
@@ -1,10 +1,21 @@
+#define _GNU_SOURCE             /* For memmem(), splice() */
+
 #include <sys/types.h>          /* See NOTES */
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <fcntl.h>
 #include <errno.h>
 
 #include "oovm.h"
@@ -12,12 +23,16 @@
 #define ARRAY_SIZE(a)  (sizeof(a) / sizeof((a)[0]))
 
 static ovm_obj_t my_class;      /* Just a short-cut, really held in module/class hierarchy */
+static ovm_obj_t selector_class;
 
 struct ovm_obj_socket {
     struct ovm_obj  base[1];
     int             domain, type, proto;
     struct sockaddr sa_local[1], sa_remote[1];
     int             fd, _errno;
+    unsigned char   *rbuf;      /* Receive buffer, allocated on first read */
+    unsigned        rbuf_size;  /* Size of receive buffer */
+    unsigned        rbuf_ofs, rbuf_len; /* Received data not yet read */
 };
 typedef struct ovm_obj_socket *ovm_obj_socket_t;
 
@@ -39,12 +54,16 @@ static inline ovm_obj_socket_t ovm_inst_socketval(ovm_thread_t th, ovm_inst_t in
 
 static void socket_cleanup(ovm_obj_t obj)
 {
-    close(ovm_obj_socket(obj)->fd);
+    ovm_obj_socket_t s = ovm_obj_socket(obj);
+    ovm_thread_io_close(s->fd);
+    close(s->fd);
+    free(s->rbuf);
 }
 
 static void socket_init(ovm_obj_t obj, va_list ap)
 {
     ovm_obj_socket_t s = ovm_obj_socket(obj);
+    memset(obj + 1, 0, sizeof(*s) - sizeof(*obj));
     s->domain = va_arg(ap, int);
     s->type   = va_arg(ap, int);
     s->proto  = va_arg(ap, int);
@@ -56,6 +75,131 @@ static ovm_obj_socket_t socket_newc(ovm_inst_t dst, int domain, int type, int pr
     return (ovm_obj_socket(ovm_obj_alloc(dst, sizeof(struct ovm_obj_socket), ovm_obj_class(my_class), 2, socket_init, domain, type, proto, fd)));
 }
 
+/* In a coroutine (see the thread module), I/O that would block suspends the
+   coroutine instead, until the socket is ready -- reads and writes are done
+   without waiting, and retried once the socket is ready.  Hence, in a
+   coroutine, reads and writes do not fail with #EAGAIN, and write() writes
+   everything.
+*/
+
+static inline int socket_io_flags(ovm_thread_t th)
+{
+    return (th->co != 0 ? MSG_DONTWAIT : 0);
+}
+
+/* After an operation failed, wait if it would have blocked, and in a
+   coroutine; returns true if the operation should be retried
+*/
+
+static bool socket_io_wait(ovm_thread_t th, ovm_obj_socket_t s, unsigned events)
+{
+    return ((errno == EAGAIN || errno == EWOULDBLOCK) && ovm_thread_io_wait(th, s->fd, events) == 0);
+}
+
+/* In a coroutine, wait until the socket is ready, before an operation that
+   has no non-blocking flag
+*/
+
+static void socket_ready_wait(ovm_thread_t th, ovm_obj_socket_t s, short events)
+{
+    struct pollfd pfd[1];
+    pfd->fd     = s->fd;
+    pfd->events = events;
+    if (th->co != 0 && poll(pfd, 1, 0) == 0)  ovm_thread_io_wait(th, s->fd, events);
+}
+
+static int socket_recv(ovm_thread_t th, ovm_obj_socket_t s, void *buf, unsigned n)
+{
+    int rc;
+    do {
+        rc = recv(s->fd, buf, n, socket_io_flags(th));
+    } while (rc < 0 && (errno == EINTR || socket_io_wait(th, s, EPOLLIN)));
+    if (rc < 0)  s->_errno = errno;
+
+    return (rc);
+}
+
+static int socket_send(ovm_thread_t th, ovm_obj_socket_t s, const unsigned char *p, unsigned n)
+{
+    if (th->co == 0)  return (write(s->fd, p, n));
+
+    unsigned ofs = 0;
+    while (ofs < n) {
+        int rc = send(s->fd, p + ofs, n - ofs, MSG_DONTWAIT);
+        if (rc >= 0) {
+            ofs += rc;
+            continue;
+        }
+        if (errno == EINTR || socket_io_wait(th, s, EPOLLOUT))  continue;
+        s->_errno = errno;
+
+        return (ofs > 0 ? (int) ofs : rc);
+    }
+
+    return (ofs);
+}
+
+/* Reads are done in pieces of at least this much, into the socket's receive
+   buffer, and read(), readln(), readuntil() and peek() are served from there,
+   so that reading a line costs one system call, rather than one per byte.
+   The buffer grows only as needed to hold a line longer than it.
+*/
+
+enum {
+    SOCKET_RBUF_SIZE = 16384
+};
+
+/* Read more into the receive buffer, making room first; returns number of
+   bytes read, 0 for end-of-file, or < 0 for error.  In a coroutine, another
+   coroutine may use the buffer while this one waits, so the room is made,
+   and where to read into worked out, again after every wait.
+*/
+
+static int socket_rbuf_fill(ovm_thread_t th, ovm_obj_socket_t s)
+{
+    int n;
+    do {
+        if (s->rbuf == 0) {
+            if ((s->rbuf = (unsigned char *) malloc(SOCKET_RBUF_SIZE)) == 0) {
+                s->_errno = ENOMEM;
+                return (-1);
+            }
+            s->rbuf_size = SOCKET_RBUF_SIZE;
+        }
+        if (s->rbuf_len == 0)  s->rbuf_ofs = 0;
+        if (s->rbuf_ofs + s->rbuf_len == s->rbuf_size) {
+            if (s->rbuf_ofs > 0) {
+                memmove(s->rbuf, s->rbuf + s->rbuf_ofs, s->rbuf_len);
+                s->rbuf_ofs = 0;
+            } else {
+                unsigned char *p = s->rbuf_size > (~0U >> 1) ? 0 : (unsigned char *) realloc(s->rbuf, s->rbuf_size << 1);
+                if (p == 0) {
+                    s->_errno = ENOMEM;
+                    return (-1);
+                }
+                s->rbuf = p;
+                s->rbuf_size <<= 1;
+            }
+        }
+
+        unsigned ofs = s->rbuf_ofs + s->rbuf_len;
+        n = recv(s->fd, s->rbuf + ofs, s->rbuf_size - ofs, socket_io_flags(th));
+    } while (n < 0 && (errno == EINTR || socket_io_wait(th, s, EPOLLIN)));
+    if (n < 0) {
+        s->_errno = errno;
+        return (n);
+    }
+    s->rbuf_len += n;
+
+    return (n);
+}
+
+static void socket_rbuf_consume(ovm_obj_socket_t s, unsigned n)
+{
+    s->rbuf_ofs += n;
+    s->rbuf_len -= n;
+}
+
 static bool inet_addr_inst(ovm_inst_t inst, struct sockaddr_in *sa)
 {
     if (ovm_inst_of_raw(inst) != OVM_CL_PAIR)  return (false);
@@ -177,7 +321,16 @@ CM_DECL(connect)
         {
             struct sockaddr_in sa[1];
             if (!inet_addr_inst(arg, sa))  ovm_except_inv_value(th, arg);
-            if (connect(s->fd, (struct sockaddr *) sa, sizeof(*sa)) != 0) {
+            int rc = connect(s->fd, (struct sockaddr *) sa, sizeof(*sa));
+            if (rc != 0 && errno == EINPROGRESS && ovm_thread_io_wait(th, s->fd, EPOLLOUT) == 0) {
+                /* Non-blocking, in a coroutine => wait for outcome */
+
+                int err;
+                socklen_t n = sizeof(err);
+                if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &n) != 0)  err = errno;
+                if ((errno = err) == 0)  rc = 0;
+            }
+            if (rc != 0) {
                 s->_errno = errno;
                 ovm_inst_assign_obj(dst, 0);
             } else {
@@ -209,21 +362,233 @@ CM_DECL(listen)
     ovm_inst_assign(dst, &argv[0]);
 }
 
+/* accept([flags]) -- flags being an or of #SOCK_NONBLOCK and #SOCK_CLOEXEC,
+   default #SOCK_CLOEXEC, applied to the accepted socket as it is created
+*/
+
 CM_DECL(accept)
 {
+    ovm_method_argc_chk_range(th, 1, 2);
     ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
-    socklen_t  salen = sizeof(s->sa_remote);
+    int flags = SOCK_CLOEXEC;
+    if (argc > 1) {
+        flags = ovm_inst_intval(th, &argv[1]);
+        if ((flags & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)) != 0)  ovm_except_inv_value(th, &argv[1]);
+    }
+    struct sockaddr sa[1];
+    socklen_t  salen = sizeof(sa);
   
-    int fd = accept(s->fd, s->sa_remote, &salen);
+    socket_ready_wait(th, s, POLLIN);
+    int fd;
+    while ((fd = accept4(s->fd, sa, &salen, flags)) < 0
+           && (errno == EINTR || socket_io_wait(th, s, EPOLLIN))
+           );
     if (fd < 0) {
         s->_errno = errno;
         ovm_inst_assign_obj(dst, 0);
         return;
     }
 
-    socket_newc(dst, s->domain, s->type, s->proto, fd);
+    ovm_obj_socket_t a = socket_newc(dst, s->domain, s->type, s->proto, fd);
+    memcpy(a->sa_local, s->sa_local, sizeof(a->sa_local));
+    memcpy(a->sa_remote, sa, sizeof(a->sa_remote));
+}
+
+/* serve(n, address, qlen, method, args...) -- run a server with n acceptor
+   threads.  Each thread gets a listening socket of its own, bound to the
+   same address with #SO_REUSEPORT, so that the kernel spreads incoming
+   connections across them, and calls method(args..., socket), which
+   typically accepts and handles connections in a loop.  Waits for all the
+   threads to finish, and returns an Array of their results, as for
+   Thread.join(); or nil, if any socket cannot be set up, before any thread
+   is started.  In a coroutine, other coroutines run while it waits.
+*/
+
+enum { SOCKET_ACCEPTORS_MAX = 1024 };
+
+/* Acceptor threads count themselves on done_fd, an eventfd, as they finish,
+   however they finish, so that serve() can wait for that through the
+   scheduler in a coroutine, rather than in pthread_join()
+*/
+
+struct acceptor {
+    ovm_thread_t th;
+    int          done_fd;
+};
+
+static void acceptor_done(void *arg)
+{
+    uint64_t one = 1;
+    while (write(((struct acceptor *) arg)->done_fd, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+static void *acceptor_entry(void *arg)
+{
+    void *result;
+    pthread_cleanup_push(acceptor_done, arg);
+    result = ovm_thread_entry(((struct acceptor *) arg)->th); /* Exits the pthread */
+    pthread_cleanup_pop(1);
+
+    return (result);
+}
+
+/* Wait in a coroutine until n acceptors have finished; false if the wait
+   failed
+*/
+
+static bool acceptors_co_wait(ovm_thread_t th, int done_fd, unsigned n)
+{
+    while (n > 0) {
+        uint64_t cnt;
+        if (read(done_fd, &cnt, sizeof(cnt)) == sizeof(cnt)) {
+            n = cnt >= n ? 0 : n - cnt;
+            continue;
+        }
+        if (errno == EINTR)  continue;
+        if (errno != EAGAIN || ovm_thread_io_wait(th, done_fd, EPOLLIN) != 0)  return (false);
+    }
+
+    return (true);
+}
+
+CM_DECL(serve)
+{
+    ovm_method_argc_chk_min(th, 5);
+    ovm_intval_t n = ovm_inst_intval(th, &argv[1]);
+    if (n < 1 || n > SOCKET_ACCEPTORS_MAX)  ovm_except_inv_value(th, &argv[1]);
+    struct sockaddr_in sa[1];
+    if (!inet_addr_inst(&argv[2], sa))  ovm_except_inv_value(th, &argv[2]);
+    int qlen = ovm_inst_intval(th, &argv[3]);
+    switch (argv[4].type) {
+    case OVM_INST_TYPE_CODEMETHOD:
+    case OVM_INST_TYPE_METHOD:
+        break;
+    default:
+        ovm_except_inv_value(th, &argv[4]);
+    }
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2); /* Listening sockets, namespace */
+
+    ovm_inst_t work2 = ovm_stack_alloc(th, 2);
+
+    ovm_inst_assign_obj(&work2[-2], ovm_consts.Array);
+    ovm_int_newc(&work2[-1], n);
+    ovm_method_callsch(th, &work[-2], OVM_STR_CONST_HASH(new), 2);
+
+    ovm_stack_unwind(th, work2);
+
+    ovm_obj_array_t listeners = ovm_inst_arrayval_nochk(&work[-2]);
+    unsigned i;
+    for (i = 0; i < n; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            ovm_inst_assign_obj(dst, 0);
+            return;
+        }
+        ovm_obj_socket_t s = socket_newc(&listeners->data[i], AF_INET, SOCK_STREAM, 0, fd);
+        int one = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+            || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0
+            || bind(fd, (struct sockaddr *) sa, sizeof(*sa)) != 0
+            || listen(fd, qlen) != 0
+            ) {
+            ovm_inst_assign_obj(dst, 0);
+            return;
+        }
+        memcpy(s->sa_local, sa, sizeof(s->sa_local));
+    }
+
+    int done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (done_fd < 0) {
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    /* Same namespace as for Thread.new() */
+
+    ovm_stack_push_obj(th, ovm_consts.Namespace);
+    ovm_method_callsch(th, th->sp, OVM_STR_CONST_HASH(current), 1);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(parent), 1);
+    ovm_stack_free(th, 1);
+
+    pthread_t ids[n];
+    struct acceptor acceptors[n];
+    unsigned nargs = argc - 5, nstarted;
+    for (nstarted = 0; nstarted < n; ++nstarted) {
+        ovm_thread_t newth = ovm_thread_create(0, 0);
+
+        newth->sp -= nargs + 4; /* args socket dst method ns -- */
+
+        ovm_inst_t p = newth->sp, q;
+        unsigned k;
+        for (q = &argv[5], k = nargs; k > 0; --k, ++p, ++q)  ovm_inst_assign(p, q);
+        ovm_inst_assign(p, &listeners->data[nstarted]);
+        ++p;                    /* Result */
+        ovm_inst_assign(++p, &argv[4]);
+        ovm_inst_assign(++p, &work[-1]);
+
+        acceptors[nstarted].th      = newth;
+        acceptors[nstarted].done_fd = done_fd;
+        if (pthread_create(&ids[nstarted], 0, acceptor_entry, &acceptors[nstarted]) != 0) {
+            ovm_thread_destroy(newth);
+
+            break;
+        }
+    }
+    if (nstarted < n) {
+        /* Wake the acceptors already started out of accept(), and wait
+           for them to finish
+        */
+
+        for (i = 0; i < nstarted; ++i) {
+            shutdown(ovm_inst_socketval_nochk(&listeners->data[i])->fd, SHUT_RDWR);
+        }
+        for (i = 0; i < nstarted; ++i)  pthread_join(ids[i], 0);
+        close(done_fd);
+        ovm_inst_assign_obj(dst, 0);
+
+        return;
+    }
+
+    /* In a coroutine, joining below returns at once, or nearly */
+
+    if (th->co != 0)  acceptors_co_wait(th, done_fd, n);
+
+    ovm_inst_t work3 = ovm_stack_alloc(th, 2);
+
+    ovm_inst_assign_obj(&work3[-2], ovm_consts.Array);
+    ovm_int_newc(&work3[-1], n);
+    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(new), 2);
+
+    ovm_stack_unwind(th, work3);
+
+    ovm_obj_array_t results = ovm_inst_arrayval_nochk(dst);
+    for (i = 0; i < n; ++i) {
+        void *result;
+        pthread_join(ids[i], &result);
+        ovm_int_newc(&results->data[i], PTR_TO_UINT(result));
+    }
+    ovm_thread_io_close(done_fd);
+    close(done_fd);
+}
+
+/* Make a Bytearray of the given bytes */
+
+static void barray_newc(ovm_thread_t th, ovm_inst_t dst, unsigned size, const unsigned char *data)
+{
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    ovm_inst_assign_obj(&work[-2], ovm_consts.Bytearray);
+    ovm_int_newc(&work[-1], size);
+    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(new), 2);
+    memcpy(ovm_inst_barrayval_nochk(dst)->data, data, size);
+
+    ovm_stack_unwind(th, work);
 }
 
+/* Read up to n bytes -- what is buffered if anything is, else from a single
+   read
+*/
 
 CM_DECL(read)
 {
@@ -232,48 +597,206 @@ CM_DECL(read)
     ovm_intval_t n = ovm_inst_intval(th, &argv[1]);
     if (n < 0)  ovm_except_inv_value(th, &argv[1]);
 
-    ovm_inst_t work = ovm_stack_alloc(th, 2);
+    if (s->rbuf_len == 0 && n >= SOCKET_RBUF_SIZE) {
+        /* Big read, nothing buffered => read directly */
+
+        ovm_inst_t work = ovm_stack_alloc(th, 2);
     
-    ovm_inst_assign_obj(&work[-2], ovm_consts.Bytearray);
-    ovm_int_newc(&work[-1], n);
-    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(new), 2);
-    ovm_obj_barray_t b = ovm_inst_barrayval_nochk(&work[-1]);
-    int nn = read(s->fd, b->data, n);
-    if (nn < 0) {
-        ovm_int_newc(dst, nn);
+        ovm_inst_assign_obj(&work[-2], ovm_consts.Bytearray);
+        ovm_int_newc(&work[-1], n);
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(new), 2);
+        ovm_obj_barray_t b = ovm_inst_barrayval_nochk(&work[-1]);
+        int nn = socket_recv(th, s, b->data, n);
+        if (nn < 0) {
+            ovm_int_newc(dst, nn);
+            return;
+        }
+        if (nn == n) {
+            ovm_inst_assign(dst, &work[-1]);
+            return;
+        }
+
+        barray_newc(th, dst, nn, b->data);
+
         return;
     }
-    if (nn == n) {
-        ovm_inst_assign(dst, &work[-1]);
-        return;
+
+    if (s->rbuf_len == 0 && n > 0) {
+        int nn = socket_rbuf_fill(th, s);
+        if (nn < 0) {
+            ovm_int_newc(dst, nn);
+            return;
+        }
     }
-    
-    ovm_stack_alloc(th, 1);
-    ovm_inst_assign_obj(&work[-3], ovm_consts.Bytearray);
-    ovm_int_newc(&work[-2], nn);
-    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(new), 2);
-    memcpy(ovm_inst_barrayval_nochk(dst)->data, b->data, nn);
+    if (n > s->rbuf_len)  n = s->rbuf_len;
+    barray_newc(th, dst, n, s->rbuf + s->rbuf_ofs);
+    socket_rbuf_consume(s, n);
+}
+
+/* Up to n bytes, without consuming them -- reads only if fewer than n are
+   buffered, and then only once
+*/
+
+CM_DECL(peek)
+{
+    ovm_method_argc_chk_exact(th, 2);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    ovm_intval_t n = ovm_inst_intval(th, &argv[1]);
+    if (n < 0)  ovm_except_inv_value(th, &argv[1]);
+
+    if (n > s->rbuf_len) {
+        int nn = socket_rbuf_fill(th, s);
+        if (nn < 0) {
+            ovm_int_newc(dst, nn);
+            return;
+        }
+    }
+    if (n > s->rbuf_len)  n = s->rbuf_len;
+    barray_newc(th, dst, n, s->rbuf + s->rbuf_ofs);
+}
+
+/* Read up to and including the given delimiter, or up to end-of-file (or
+   an error), as a String; for a non-blocking socket, nil if the delimiter
+   has not arrived yet
+*/
+
+static void socket_readuntil(ovm_thread_t th, ovm_inst_t dst, ovm_obj_socket_t s, unsigned delim_size, const unsigned char *delim)
+{
+    unsigned scan = 0, n;       /* Search resumes at scan, in buffered data */
+    for (;;) {
+        const unsigned char *p = s->rbuf + s->rbuf_ofs, *q;
+        if (s->rbuf_len >= scan + delim_size) {
+            q = delim_size == 1
+                ? (const unsigned char *) memchr(p + scan, delim[0], s->rbuf_len - scan)
+                : (const unsigned char *) memmem(p + scan, s->rbuf_len - scan, delim, delim_size);
+            if (q != 0) {
+                n = q + delim_size - p;
+                break;
+            }
+            scan = s->rbuf_len - delim_size + 1;
+        }
+        int rc = socket_rbuf_fill(th, s);
+        if (rc < 0 && (s->_errno == EAGAIN || s->_errno == EWOULDBLOCK)) {
+            /* Non-blocking, and no complete line yet -- keep what there is */
+
+            ovm_inst_assign_obj(dst, 0);
+            return;
+        }
+        if (rc <= 0) {
+            n = s->rbuf_len;
+            break;
+        }
+    }
+
+    ovm_str_newc(dst, n + 1, (const char *) s->rbuf + s->rbuf_ofs);
+    socket_rbuf_consume(s, n);
 }
 
 CM_DECL(readln)
 {
     ovm_method_argc_chk_exact(th, 1);
+    socket_readuntil(th, dst, ovm_inst_socketval(th, &argv[0]), 1, (const unsigned char *) "\n");
+}
+
+/* readuntil(delim), delim being a non-empty String, or an Integer for a
+   single byte
+*/
+
+CM_DECL(readuntil)
+{
+    ovm_method_argc_chk_exact(th, 2);
     ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
-  
-    struct ovm_clist cl[1];
-    ovm_clist_init(cl);
+    ovm_inst_t arg = &argv[1];
+    unsigned char c;
+    const unsigned char *delim;
+    unsigned delim_size;
+    if (arg->type == OVM_INST_TYPE_INT) {
+        if (arg->intval < 0 || arg->intval > 255)  ovm_except_inv_value(th, arg);
+        c = arg->intval;
+        delim = &c;
+        delim_size = 1;
+    } else {
+        ovm_obj_str_t d = ovm_inst_strval(th, arg);
+        if (d->size < 2)  ovm_except_inv_value(th, arg);
+        delim = (const unsigned char *) d->data;
+        delim_size = d->size - 1;
+    }
+    socket_readuntil(th, dst, s, delim_size, delim);
+}
 
-    char c;
-    for (;;) {
-        int n = read(s->fd, &c, 1);
-        if (n <= 0)  break;
-        ovm_clist_append_char(cl, c);
-        if (c == '\n')  break;
+/* Set blocking (true) or non-blocking (false) mode.  A non-blocking
+   operation that cannot be done at once fails, with errno #EAGAIN (or
+   #EINPROGRESS, for connect).
+*/
+
+CM_DECL(setblocking)
+{
+    ovm_method_argc_chk_exact(th, 2);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    bool blockingf = ovm_inst_boolval(th, &argv[1]);
+
+    int flags = fcntl(s->fd, F_GETFL);
+    if (flags < 0 || fcntl(s->fd, F_SETFL, blockingf ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) < 0) {
+        s->_errno = errno;
+        ovm_inst_assign_obj(dst, 0);
+        return;
     }
 
-    ovm_str_clist(dst, cl);
+    ovm_inst_assign(dst, &argv[0]);
+}
 
-    ovm_clist_fini(cl);
+/* setsockopt(level, option, value) -- set an integer-valued option, e.g.
+   level #SOL_SOCKET, option #SO_REUSEPORT or #SO_RCVBUF; or level
+   #IPPROTO_TCP, option #TCP_NODELAY.  The value is an Integer or a Boolean.
+*/
+
+CM_DECL(setsockopt)
+{
+    ovm_method_argc_chk_exact(th, 4);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    int level = ovm_inst_intval(th, &argv[1]);
+    int opt   = ovm_inst_intval(th, &argv[2]);
+    int val   = argv[3].type == OVM_INST_TYPE_BOOL ? argv[3].boolval : ovm_inst_intval(th, &argv[3]);
+
+    if (setsockopt(s->fd, level, opt, &val, sizeof(val)) != 0) {
+        s->_errno = errno;
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    ovm_inst_assign(dst, &argv[0]);
+}
+
+/* getsockopt(level, option) -- get an integer-valued option, or nil on
+   error
+*/
+
+CM_DECL(getsockopt)
+{
+    ovm_method_argc_chk_exact(th, 3);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    int level = ovm_inst_intval(th, &argv[1]);
+    int opt   = ovm_inst_intval(th, &argv[2]);
+
+    int val = 0;
+    socklen_t n = sizeof(val);
+    if (getsockopt(s->fd, level, opt, &val, &n) != 0) {
+        s->_errno = errno;
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    ovm_int_newc(dst, val);
+}
+
+/* Number of bytes received and buffered, i.e. readable without waiting --
+   a Selector does not see these, so should be drained before waiting
+*/
+
+CM_DECL(pending)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    ovm_int_newc(dst, ovm_inst_socketval(th, &argv[0])->rbuf_len);
 }
 
 static const char *domain_to_str(unsigned domain)
@@ -356,70 +879,876 @@ CM_DECL(write)
     ovm_method_argc_chk_range(th, 2, 3);
 
     ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
-    ovm_inst_t arg = &argv[1];
-    const unsigned char *p = 0;
-    unsigned n = 0;
-#if 0
-    if (ovm_inst_is_obj_cl(arg, OVM_CL_BYTEARRAY)) {
-        ovm_obj_bytearr_t b = ovm_inst_barrval_nochk(arg);
-        p = b->data;
-        n = b->size;
-    } else
-#endif
-        if (ovm_inst_of_raw(arg) == OVM_CL_STRING) {
-            ovm_obj_str_t ss = ovm_inst_strval_nochk(arg);
-            p = (const unsigned char *) ss->data;
-            n = ss->size - 1;
-        } else  ovm_except_inv_value(th, arg);
+    const unsigned char *p;
+    unsigned n;
+    if (!ovm_inst_bytes(&argv[1], &n, &p))  ovm_except_inv_value(th, &argv[1]);
 
-    ovm_int_newc(dst, write(s->fd, p, n));
+    ovm_int_newc(dst, socket_send(th, s, p, n));
 }
 
+/* writev(items) -- write an Array or List of Strings, Bytearrays and byte
+   slices, gathered with as few sendmsg() calls as possible, rather than
+   copied together or written one by one.  Returns the number of bytes
+   written, which is all of them, unless the socket is non-blocking (and
+   not in a coroutine), or an error occurs part way; or -1 on error, before
+   anything was written.
+*/
 
-static struct {
-    unsigned   nm_size;
-    const char *nm;
-    unsigned   hash;
-    int        val;
-} class_vars[] = {
-    { _OVM_STR_CONST_HASH("#AF_INET"),     AF_INET },
-    { _OVM_STR_CONST_HASH("#SOCK_DGRAM"),  SOCK_DGRAM },
-    { _OVM_STR_CONST_HASH("#SOCK_STREAM"), SOCK_STREAM }
+enum {
+    SOCKET_IOV_MAX = 1024       /* Most pieces per sendmsg() */
 };
 
-void __socket_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv)
+/* Position in an Array or List of items to send */
+
+struct items_pos {
+    ovm_obj_array_t a;          /* Array of items, or */
+    ovm_obj_list_t  li;         /* list node of current item */
+    unsigned        idx, ofs;   /* Current item index in Array, and offset of first byte not sent in item */
+};
+
+static void items_init(ovm_thread_t th, struct items_pos *pos, ovm_inst_t inst)
 {
-    ovm_inst_t old = th->sp;
+    memset(pos, 0, sizeof(*pos));
+    if (inst->type == OVM_INST_TYPE_OBJ && inst->objval != 0
+        && ovm_is_subclass_of(ovm_inst_of_raw(inst), OVM_CL_ARRAY)
+        ) {
+        pos->a = ovm_inst_arrayval_nochk(inst);
+    } else {
+        pos->li = ovm_inst_listval(th, inst);
+    }
+}
 
-    ovm_stack_push(th, &argv[0]);
+static inline ovm_inst_t items_cur(struct items_pos *pos)
+{
+    if (pos->a != 0)  return (pos->idx < pos->a->size ? &pos->a->data[pos->idx] : 0);
+    return (pos->li != 0 ? pos->li->item : 0);
+}
 
-    ovm_stack_push_obj(th, ovm_consts.Object);
-    ovm_class_new(th, OVM_STR_CONST_HASH(Socket), 0, socket_cleanup, socket_cleanup);
-    my_class = th->sp->objval;
+static inline void items_next(struct items_pos *pos)
+{
+    if (pos->a != 0) {
+        ++pos->idx;
+    } else {
+        pos->li = ovm_obj_list(pos->li->next);
+    }
+    pos->ofs = 0;
+}
 
-    ovm_inst_t work = ovm_stack_alloc(th, 3);
+CM_DECL(writev)
+{
+    ovm_method_argc_chk_exact(th, 2);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    struct items_pos pos[1];
+    items_init(th, pos, &argv[1]);
 
-    ovm_inst_assign(&work[-3], &work[0]);
-    unsigned i;
-    for (i = 0; i < ARRAY_SIZE(class_vars); ++i) {
-        ovm_str_newc(&work[-2], class_vars[i].nm_size, class_vars[i].nm);
-        ovm_int_newc(&work[-1], class_vars[i].val);
-        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(atput), 3);
+    /* Check all items first, so that nothing is written if any is bad */
+
+    const unsigned char *p;
+    unsigned n;
+    {
+        struct items_pos chk[1] = { *pos };
+        ovm_inst_t item;
+        for (; (item = items_cur(chk)) != 0; items_next(chk)) {
+            if (!ovm_inst_bytes(item, &n, &p))  ovm_except_inv_value(th, item);
+        }
     }
 
-    ovm_stack_unwind(th, work);
-    
-    ovm_classmethod_add(th, OVM_STR_CONST_HASH(new), METHOD_NAME(new));
-    ovm_method_add(th, _OVM_STR_CONST_HASH("errno"), socket$Socket$errno);
-    ovm_method_add(th, OVM_STR_CONST_HASH(bind),     METHOD_NAME(bind));
-    ovm_method_add(th, OVM_STR_CONST_HASH(connect),  METHOD_NAME(connect));
-    ovm_method_add(th, OVM_STR_CONST_HASH(listen),   METHOD_NAME(listen));
+    ovm_intval_t result = 0;
+    for (;;) {
+        /* Gather from current position on */
+
+        struct iovec iov[SOCKET_IOV_MAX];
+        struct items_pos g[1] = { *pos };
+        unsigned cnt = 0;
+        ovm_inst_t item;
+        for (; cnt < SOCKET_IOV_MAX && (item = items_cur(g)) != 0; items_next(g)) {
+            if (!ovm_inst_bytes(item, &n, &p))  ovm_except_inv_value(th, item);
+            if (n <= g->ofs)  continue;
+            iov[cnt].iov_base = (void *)(p + g->ofs);
+            iov[cnt].iov_len  = n - g->ofs;
+            ++cnt;
+        }
+        if (cnt == 0)  break;
+
+        struct msghdr msg[1];
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_iov    = iov;
+        msg->msg_iovlen = cnt;
+        ssize_t nn = sendmsg(s->fd, msg, socket_io_flags(th));
+        if (nn < 0) {
+            if (errno == EINTR || socket_io_wait(th, s, EPOLLOUT))  continue;
+            s->_errno = errno;
+            if (result == 0)  result = -1;
+            break;
+        }
+        result += nn;
+
+        /* Advance past what was written */
+
+        while ((item = items_cur(pos)) != 0) {
+            if (!ovm_inst_bytes(item, &n, &p))  ovm_except_inv_value(th, item);
+            if (nn < n - pos->ofs) {
+                pos->ofs += nn;
+                break;
+            }
+            nn -= n - pos->ofs;
+            items_next(pos);
+        }
+    }
+
+    ovm_int_newc(dst, result);
+}
+
+
+/* sendfile(file[, offset[, count]]) -- send count bytes (default: to
+   end-of-file) of a File, from offset, without copying them through the
+   VM: with sendfile(2) for a regular file, or splice(2) for a pipe, e.g. a
+   Process's stdout.  For a regular file, offset defaults to the File's
+   position, which is then advanced past what was sent; a pipe has no
+   offset.  Returns the number of bytes sent, which is fewer than count only
+   at end-of-file, on error, or if the socket is non-blocking; or -1 on
+   error, before anything was sent.
+*/
+
+enum {
+    SOCKET_SENDFILE_CHUNK = 1 << 20 /* Most bytes per system call */
+};
+
+static ovm_intval_t socket_sendfile(ovm_thread_t th, ovm_obj_socket_t s, int fd, off_t *ofs, ovm_intval_t count)
+{
+    ovm_intval_t result = 0;
+    while (result < count) {
+        size_t n = count - result;
+        if (n > SOCKET_SENDFILE_CHUNK)  n = SOCKET_SENDFILE_CHUNK;
+        socket_ready_wait(th, s, POLLOUT);
+        ssize_t nn = sendfile(s->fd, fd, ofs, n);
+        if (nn < 0) {
+            if (errno == EINTR || socket_io_wait(th, s, EPOLLOUT))  continue;
+            s->_errno = errno;
+
+            return (result > 0 ? result : -1);
+        }
+        if (nn == 0)  break;    /* End-of-file */
+        result += nn;
+    }
+
+    return (result);
+}
+
+/* count < 0 => to end-of-file */
+
+static ovm_intval_t socket_splice(ovm_thread_t th, ovm_obj_socket_t s, FILE *fp, ovm_intval_t count)
+{
+    ovm_intval_t result = 0;
+
+#ifdef __GLIBC__
+    /* First, whatever stdio has already read from the pipe */
+
+    unsigned n = fp->_IO_read_end - fp->_IO_read_ptr;
+    if (count >= 0 && n > count)  n = count;
+    if (n > 0) {
+        unsigned char buf[n];
+        n = fread(buf, 1, n, fp);
+        int rc = socket_send(th, s, buf, n);
+        if (rc < 0) {
+            s->_errno = errno;
+            return (-1);
+        }
+        result = rc;
+        if (rc < n)  return (result);
+    }
+#endif
+
+    int fd = fileno(fp);
+    unsigned flags = SPLICE_F_MOVE | (th->co != 0 ? SPLICE_F_NONBLOCK : 0);
+    while (count < 0 || result < count) {
+        size_t n = SOCKET_SENDFILE_CHUNK;
+        if (count >= 0 && count - result < n)  n = count - result;
+        ssize_t nn = splice(fd, 0, s->fd, 0, n, flags);
+        if (nn < 0) {
+            if (errno == EINTR)  continue;
+            if (errno == EAGAIN && th->co != 0) {
+                /* In a coroutine => wait for the pipe, or the socket */
+
+                struct pollfd pfd[2];
+                pfd[0].fd = fd;
+                pfd[0].events = POLLIN;
+                pfd[1].fd = s->fd;
+                pfd[1].events = POLLOUT;
+                pfd[0].revents = pfd[1].revents = 0;
+                poll(pfd, 2, 0);
+                bool pipef = pfd[0].revents == 0;
+                if (ovm_thread_io_wait(th, pipef ? fd : s->fd, pipef ? EPOLLIN : EPOLLOUT) == 0)  continue;
+            }
+            s->_errno = errno;
+
+            return (result > 0 ? result : -1);
+        }
+        if (nn == 0)  break;    /* End-of-file */
+        result += nn;
+    }
+
+    return (result);
+}
+
+CM_DECL(sendfile)
+{
+    ovm_method_argc_chk_range(th, 2, 4);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    ovm_obj_file_t f = ovm_inst_fileval(th, &argv[1]);
+    if (f->fp == 0)  ovm_except_inv_value(th, &argv[1]);
+    bool ofsf = argc > 2 && !ovm_inst_is_nil(&argv[2]);
+    off_t ofs = 0;
+    if (ofsf) {
+        ovm_intval_t k = ovm_inst_intval(th, &argv[2]);
+        if (k < 0)  ovm_except_inv_value(th, &argv[2]);
+        ofs = k;
+    }
+    ovm_intval_t count = -1;
+    if (argc > 3 && !ovm_inst_is_nil(&argv[3])) {
+        count = ovm_inst_intval(th, &argv[3]);
+        if (count < 0)  ovm_except_inv_value(th, &argv[3]);
+    }
+
+    int fd = fileno(f->fp);
+    struct stat st[1];
+    fflush(f->fp);              /* Anything written, for a regular file */
+    if (fstat(fd, st) != 0) {
+        s->_errno = errno;
+        ovm_int_newc(dst, -1);
+        return;
+    }
+    if (S_ISREG(st->st_mode)) {
+        if (!ofsf)  ofs = ftello(f->fp);
+        ovm_intval_t n = st->st_size > ofs ? st->st_size - ofs : 0;
+        if (count < 0 || count > n)  count = n;
+        ovm_int_newc(dst, socket_sendfile(th, s, fd, &ofs, count));
+        if (!ofsf)  fseeko(f->fp, ofs, SEEK_SET);
+
+        return;
+    }
+    if (S_ISFIFO(st->st_mode)) {
+        if (ofsf)  ovm_except_inv_value(th, &argv[2]);
+        ovm_int_newc(dst, socket_splice(th, s, f->fp, count));
+
+        return;
+    }
+
+    ovm_except_inv_value(th, &argv[1]);
+}
+
+/* Batched datagrams -- many in one system call, with recvmmsg() and
+   sendmmsg()
+*/
+
+enum {
+    SOCKET_MMSG_MAX  = 256,     /* Most datagrams per call */
+    SOCKET_DGRAM_MAX = 65536    /* Largest datagram */
+};
+
+/* Make an <address, port> Pair */
+
+static void inet_addr_newc(ovm_thread_t th, ovm_inst_t dst, const struct sockaddr_in *sa)
+{
+    char buf[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &sa->sin_addr, buf, sizeof(buf));
+
+    ovm_inst_t work = ovm_stack_alloc(th, 3);
+
+    ovm_inst_assign_obj(&work[-3], ovm_consts.Pair);
+    ovm_str_newc1(&work[-2], buf);
+    ovm_int_newc(&work[-1], ntohs(sa->sin_port));
+    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(new), 3);
+
+    ovm_stack_unwind(th, work);
+}
+
+/* recvmany(n, maxsize[, pool]) -- receive up to n datagrams, waiting only
+   for the first, as an Array of <data, <address, port>> Pairs.  Each data
+   is a Byteslice of at most maxsize bytes, in a Bytearray pool of n *
+   maxsize bytes, so that a batch costs one buffer and no copying.  Pass the
+   pool from a previous call to reuse it, once that call's slices are done
+   with.  Returns nil on error.
+*/
+
+CM_DECL(recvmany)
+{
+    ovm_method_argc_chk_range(th, 3, 4);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    ovm_intval_t n = ovm_inst_intval(th, &argv[1]);
+    if (n < 1 || n > SOCKET_MMSG_MAX)  ovm_except_inv_value(th, &argv[1]);
+    ovm_intval_t maxsize = ovm_inst_intval(th, &argv[2]);
+    if (maxsize < 1 || maxsize > SOCKET_DGRAM_MAX)  ovm_except_inv_value(th, &argv[2]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2); /* Pool, result */
+
+    if (argc > 3) {
+        if (ovm_inst_of_raw(&argv[3]) != OVM_CL_BYTEARRAY
+            || ovm_inst_barrayval_nochk(&argv[3])->size < n * maxsize
+            ) {
+            ovm_except_inv_value(th, &argv[3]);
+        }
+        ovm_inst_assign(&work[-2], &argv[3]);
+    } else {
+        ovm_bytearray_newc(&work[-2], n * maxsize, 0);
+    }
+    unsigned char *data = ovm_inst_barrayval_nochk(&work[-2])->data;
+
+    struct mmsghdr msgs[n];
+    struct iovec iov[n];
+    struct sockaddr_in sa[n];
+    memset(msgs, 0, sizeof(msgs));
+    unsigned i;
+    for (i = 0; i < n; ++i) {
+        iov[i].iov_base = data + i * maxsize;
+        iov[i].iov_len  = maxsize;
+        msgs[i].msg_hdr.msg_iov     = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen  = 1;
+        msgs[i].msg_hdr.msg_name    = &sa[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(sa[i]);
+    }
+    int rc;
+    while ((rc = recvmmsg(s->fd, msgs, n, MSG_WAITFORONE | socket_io_flags(th), 0)) < 0
+           && (errno == EINTR || socket_io_wait(th, s, EPOLLIN))
+           );
+    if (rc < 0) {
+        s->_errno = errno;
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    ovm_inst_t work2 = ovm_stack_alloc(th, 2);
+
+    ovm_inst_assign_obj(&work2[-2], ovm_consts.Array);
+    ovm_int_newc(&work2[-1], rc);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(new), 2);
+
+    ovm_stack_unwind(th, work2);
+
+    for (i = 0; i < rc; ++i) {
+        ovm_inst_t work2 = ovm_stack_alloc(th, 3); /* Arguments for atput */
+
+        ovm_inst_assign(&work2[-3], &work[-1]);
+        ovm_int_newc(&work2[-2], i);
+
+        ovm_inst_t work3 = ovm_stack_alloc(th, 3);
+
+        ovm_inst_assign_obj(&work3[-3], ovm_consts.Pair);
+        ovm_byteslice_newc(&work3[-2], work[-2].objval, i * maxsize, msgs[i].msg_len);
+        inet_addr_newc(th, &work3[-1], &sa[i]);
+        ovm_method_callsch(th, &work2[-1], OVM_STR_CONST_HASH(new), 3);
+
+        ovm_stack_unwind(th, work3);
+
+        ovm_method_callsch(th, &work2[-1], OVM_STR_CONST_HASH(atput), 3);
+
+        ovm_stack_unwind(th, work2);
+    }
+
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+/* Get a datagram to send -- its data, or a Pair <data, <address, port>> */
+
+static bool dgram_item(ovm_thread_t th, ovm_inst_t item, unsigned *size, const unsigned char **data, struct sockaddr_in *sa)
+{
+    bool result = false;
+    if (ovm_inst_of_raw(item) == OVM_CL_PAIR) {
+        ovm_obj_pair_t pr = ovm_inst_pairval_nochk(item);
+        if (!inet_addr_inst(pr->second, sa))  ovm_except_inv_value(th, item);
+        item = pr->first;
+        result = true;
+    }
+    if (!ovm_inst_bytes(item, size, data))  ovm_except_inv_value(th, item);
+
+    return (result);
+}
+
+/* sendmany(items) -- send an Array or List of datagrams, with as few
+   sendmmsg() calls as possible.  Each item is the data (a String, Bytearray
+   or byte slice), for a connected socket, or a Pair <data, <address,
+   port>>.  Returns the number of datagrams sent, which is all of them,
+   unless the socket is non-blocking (and not in a coroutine), or an error
+   occurs part way; or -1 on error, before any was sent.
+*/
+
+CM_DECL(sendmany)
+{
+    ovm_method_argc_chk_exact(th, 2);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[0]);
+    struct items_pos pos[1];
+    items_init(th, pos, &argv[1]);
+
+    /* Check all items first, so that nothing is sent if any is bad */
+
+    const unsigned char *p;
+    unsigned n;
+    struct sockaddr_in sa[SOCKET_MMSG_MAX];
+    {
+        struct items_pos chk[1] = { *pos };
+        ovm_inst_t item;
+        for (; (item = items_cur(chk)) != 0; items_next(chk))  dgram_item(th, item, &n, &p, sa);
+    }
+
+    ovm_intval_t result = 0;
+    for (;;) {
+        struct mmsghdr msgs[SOCKET_MMSG_MAX];
+        struct iovec iov[SOCKET_MMSG_MAX];
+        struct items_pos g[1] = { *pos };
+        unsigned cnt;
+        ovm_inst_t item;
+        for (cnt = 0; cnt < SOCKET_MMSG_MAX && (item = items_cur(g)) != 0; items_next(g), ++cnt) {
+            memset(&msgs[cnt], 0, sizeof(msgs[cnt]));
+            if (dgram_item(th, item, &n, &p, &sa[cnt])) {
+                msgs[cnt].msg_hdr.msg_name    = &sa[cnt];
+                msgs[cnt].msg_hdr.msg_namelen = sizeof(sa[cnt]);
+            }
+            iov[cnt].iov_base = (void *) p;
+            iov[cnt].iov_len  = n;
+            msgs[cnt].msg_hdr.msg_iov    = &iov[cnt];
+            msgs[cnt].msg_hdr.msg_iovlen = 1;
+        }
+        if (cnt == 0)  break;
+
+        int rc = sendmmsg(s->fd, msgs, cnt, socket_io_flags(th));
+        if (rc < 0) {
+            if (errno == EINTR || socket_io_wait(th, s, EPOLLOUT))  continue;
+            s->_errno = errno;
+            if (result == 0)  result = -1;
+            break;
+        }
+        result += rc;
+        for (; rc > 0; --rc)  items_next(pos);
+    }
+
+    ovm_int_newc(dst, result);
+}
+
+/***************************************************************************/
+
+/* Selector -- wait for any of many sockets to be ready, with epoll.  Each
+   registered socket has a datum (default the socket itself), and wait()
+   gives an Array of <datum, events> Pairs.
+*/
+
+struct ovm_obj_selector {
+    struct ovm_obj  base[1];
+    ovm_obj_t       regs;       /* Dictionary, fd => <socket, datum> */
+    int             fd, _errno;
+};
+typedef struct ovm_obj_selector *ovm_obj_selector_t;
+
+static inline ovm_obj_selector_t ovm_obj_selector(ovm_obj_t obj)
+{
+    return ((ovm_obj_selector_t) obj);
+}
+
+static inline ovm_obj_selector_t ovm_inst_selectorval(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (ovm_inst_of_raw(inst) != ovm_obj_class(selector_class))  ovm_except_inv_value(th, inst);
+    return (ovm_obj_selector(inst->objval));
+}
+
+static void selector_mark(ovm_obj_t obj)
+{
+    ovm_obj_mark(ovm_obj_selector(obj)->regs);
+}
+
+static void selector_cleanup(ovm_obj_t obj)
+{
+    ovm_thread_io_close(ovm_obj_selector(obj)->fd);
+    close(ovm_obj_selector(obj)->fd);
+}
+
+static void selector_free(ovm_obj_t obj)
+{
+    ovm_obj_release(ovm_obj_selector(obj)->regs);
+    selector_cleanup(obj);
+}
+
+static void selector_init(ovm_obj_t obj, va_list ap)
+{
+    ovm_obj_selector_t sel = ovm_obj_selector(obj);
+    memset(obj + 1, 0, sizeof(*sel) - sizeof(*obj));
+    sel->fd = va_arg(ap, int);
+}
+
+enum {
+    SELECTOR_WAIT_MAX = 1024    /* Most events returned by one wait() */
+};
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Selector
+
+CM_DECL(new)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0) {
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    ovm_obj_selector_t sel = ovm_obj_selector(ovm_obj_alloc(&work[-1], sizeof(struct ovm_obj_selector), ovm_obj_class(selector_class), OVM_MEM_ALLOC_NO_HINT, selector_init, fd));
+    ovm_inst_assign_obj(&work[-2], ovm_consts.Dictionary);
+    ovm_method_callsch(th, &work[-2], OVM_STR_CONST_HASH(new), 1);
+    ovm_obj_assign(&sel->regs, work[-2].objval);
+    ovm_inst_assign(dst, &work[-1]);
+}
+
+_CM_DECL(socket$Selector$errno)
+{
+    ovm_int_newc(dst, ovm_inst_selectorval(th, &argv[0])->_errno);
+}
+
+/* Add, or change, a socket's registration, and record its datum */
+
+static void selector_ctl(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, int op)
+{
+    ovm_method_argc_chk_range(th, 3, 4);
+    ovm_obj_selector_t sel = ovm_inst_selectorval(th, &argv[0]);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[1]);
+    ovm_intval_t events = ovm_inst_intval(th, &argv[2]);
+
+    struct epoll_event ev[1];
+    memset(ev, 0, sizeof(*ev));
+    ev->events  = events;
+    ev->data.fd = s->fd;
+    if (epoll_ctl(sel->fd, op, s->fd, ev) != 0) {
+        sel->_errno = errno;
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    if (op == EPOLL_CTL_ADD || argc > 3) {
+        ovm_inst_t work = ovm_stack_alloc(th, 3);
+
+        ovm_inst_assign_obj(&work[-3], sel->regs);
+        ovm_int_newc(&work[-2], s->fd);
+
+        ovm_inst_t work2 = ovm_stack_alloc(th, 3);
+
+        ovm_inst_assign_obj(&work2[-3], ovm_consts.Pair);
+        ovm_inst_assign(&work2[-2], &argv[1]);
+        ovm_inst_assign(&work2[-1], argc > 3 ? &argv[3] : &argv[1]);
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(new), 3);
+
+        ovm_stack_unwind(th, work2);
+
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(atput), 3);
+
+        ovm_stack_unwind(th, work);
+    }
+
+    ovm_inst_assign(dst, &argv[0]);
+}
+
+/* register(socket, events[, datum]), events being an or of #EPOLLIN,
+   #EPOLLOUT, etc.
+*/
+
+CM_DECL(register)
+{
+    selector_ctl(th, dst, argc, argv, EPOLL_CTL_ADD);
+}
+
+/* modify(socket, events[, datum]); the datum is kept if not given */
+
+CM_DECL(modify)
+{
+    selector_ctl(th, dst, argc, argv, EPOLL_CTL_MOD);
+}
+
+CM_DECL(unregister)
+{
+    ovm_method_argc_chk_exact(th, 2);
+    ovm_obj_selector_t sel = ovm_inst_selectorval(th, &argv[0]);
+    ovm_obj_socket_t s = ovm_inst_socketval(th, &argv[1]);
+
+    if (epoll_ctl(sel->fd, EPOLL_CTL_DEL, s->fd, 0) != 0) {
+        sel->_errno = errno;
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    ovm_inst_assign_obj(&work[-2], sel->regs);
+    ovm_int_newc(&work[-1], s->fd);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(del), 2);
+
+    ovm_stack_free(th, 2);
+    
+    ovm_inst_assign(dst, &argv[0]);
+}
+
+/* Number of sockets registered */
+
+CM_DECL(size)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    ovm_obj_selector_t sel = ovm_inst_selectorval(th, &argv[0]);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+    ovm_inst_assign_obj(&work[-1], sel->regs);
+    ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(size), 1);
+}
+
+/* In a coroutine, wait for the Selector's epoll fd itself to be ready,
+   through the scheduler, so that other coroutines run meanwhile; a timer fd,
+   registered alongside the sockets, ends the wait on time
+*/
+
+static int selector_co_wait(ovm_thread_t th, ovm_obj_selector_t sel, struct epoll_event *ev, int max, int timeout)
+{
+    int n = epoll_wait(sel->fd, ev, max, 0);
+    if (n != 0 || timeout == 0)  return (n);
+
+    int tfd = -1;
+    if (timeout > 0) {
+        struct itimerspec its[1];
+        memset(its, 0, sizeof(*its));
+        its->it_value.tv_sec  = timeout / 1000;
+        its->it_value.tv_nsec = (timeout % 1000) * 1000000L;
+        struct epoll_event tev[1];
+        memset(tev, 0, sizeof(*tev));
+        tev->events  = EPOLLIN;
+        if ((tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) < 0
+            || timerfd_settime(tfd, 0, its, 0) != 0
+            || (tev->data.fd = tfd, epoll_ctl(sel->fd, EPOLL_CTL_ADD, tfd, tev)) != 0
+            ) {
+            int e = errno;
+            if (tfd >= 0)  close(tfd);
+            errno = e;
+
+            return (-1);
+        }
+    }
+
+    bool timedoutf = false;
+    do {
+        if (ovm_thread_io_wait(th, sel->fd, EPOLLIN) != 0) {
+            n = -1;
+            break;
+        }
+        if ((n = epoll_wait(sel->fd, ev, max, 0)) < 0)  break;
+        int i, k;
+        for (i = k = 0; i < n; ++i) {
+            if (tfd >= 0 && ev[i].data.fd == tfd) {
+                timedoutf = true;
+            } else {
+                ev[k++] = ev[i];
+            }
+        }
+        n = k;
+    } while (n == 0 && !timedoutf);
+
+    if (tfd >= 0) {
+        int e = errno;
+        epoll_ctl(sel->fd, EPOLL_CTL_DEL, tfd, 0);
+        close(tfd);
+        errno = e;
+    }
+
+    return (n);
+}
+
+/* wait([timeout[, max]]) -- wait up to timeout seconds (Integer or Float;
+   nil or not given => forever), and return an Array of <datum, events>
+   Pairs, at most max (default 64) of them; empty on timeout or interrupt,
+   nil on error.  In a coroutine, other coroutines run while it waits.
+*/
+
+CM_DECL(wait)
+{
+    ovm_method_argc_chk_range(th, 1, 3);
+    ovm_obj_selector_t sel = ovm_inst_selectorval(th, &argv[0]);
+    int timeout = -1;
+    if (argc > 1 && !ovm_inst_is_nil(&argv[1])) {
+        ovm_inst_t arg = &argv[1];
+        double t = arg->type == OVM_INST_TYPE_INT ? arg->intval : ovm_inst_floatval(th, arg);
+        if (t < 0)  ovm_except_inv_value(th, arg);
+        timeout = t * 1000 >= 0x7fffffff ? -1 : (int) (t * 1000);
+    }
+    ovm_intval_t max = 64;
+    if (argc > 2) {
+        max = ovm_inst_intval(th, &argv[2]);
+        if (max < 1 || max > SELECTOR_WAIT_MAX)  ovm_except_inv_value(th, &argv[2]);
+    }
+
+    struct epoll_event ev[max];
+    int n = th->co != 0 ? selector_co_wait(th, sel, ev, max, timeout) : epoll_wait(sel->fd, ev, max, timeout);
+    if (n < 0) {
+        if (errno != EINTR) {
+            sel->_errno = errno;
+            ovm_inst_assign_obj(dst, 0);
+            return;
+        }
+        n = 0;
+    }
+
+    ovm_inst_t result = ovm_stack_alloc(th, 1);
+
+    ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+    ovm_inst_assign_obj(&work[-2], ovm_consts.Array);
+    ovm_int_newc(&work[-1], n);
+    ovm_method_callsch(th, &result[-1], OVM_STR_CONST_HASH(new), 2);
+
+    ovm_stack_unwind(th, work);
+
+    int i;
+    for (i = 0; i < n; ++i) {
+        ovm_inst_t work = ovm_stack_alloc(th, 3); /* Arguments for atput */
+
+        ovm_inst_assign(&work[-3], &result[-1]);
+        ovm_int_newc(&work[-2], i);
+
+        ovm_inst_t work2 = ovm_stack_alloc(th, 2);
+
+        ovm_inst_assign_obj(&work2[-2], sel->regs);
+        ovm_int_newc(&work2[-1], ev[i].data.fd);
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(at), 2);
+
+        ovm_stack_unwind(th, work2);
+
+        work2 = ovm_stack_alloc(th, 3);
+
+        ovm_inst_assign_obj(&work2[-3], ovm_consts.Pair);
+        if (ovm_inst_of_raw(&work[-1]) == OVM_CL_PAIR) {
+            /* Dictionary entry is <fd, <socket, datum>> */
+
+            ovm_inst_assign(&work2[-2], ovm_inst_pairval_nochk(ovm_inst_pairval_nochk(&work[-1])->second)->second);
+        }
+        ovm_int_newc(&work2[-1], ev[i].events);
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(new), 3);
+
+        ovm_stack_unwind(th, work2);
+
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(atput), 3);
+
+        ovm_stack_unwind(th, work);
+    }
+
+    ovm_inst_assign(dst, &result[-1]);
+}
+
+/***************************************************************************/
+
+struct class_var {
+    unsigned   nm_size;
+    const char *nm;
+    unsigned   hash;
+    int        val;
+};
+
+static const struct class_var socket_class_vars[] = {
+    { _OVM_STR_CONST_HASH("#AF_INET"),     AF_INET },
+    { _OVM_STR_CONST_HASH("#SOCK_DGRAM"),  SOCK_DGRAM },
+    { _OVM_STR_CONST_HASH("#SOCK_STREAM"), SOCK_STREAM },
+    { _OVM_STR_CONST_HASH("#SOCK_NONBLOCK"), SOCK_NONBLOCK },
+    { _OVM_STR_CONST_HASH("#SOCK_CLOEXEC"), SOCK_CLOEXEC },
+    { _OVM_STR_CONST_HASH("#EAGAIN"),      EAGAIN },
+    { _OVM_STR_CONST_HASH("#EINPROGRESS"), EINPROGRESS },
+    { _OVM_STR_CONST_HASH("#SOL_SOCKET"),  SOL_SOCKET },
+    { _OVM_STR_CONST_HASH("#IPPROTO_TCP"), IPPROTO_TCP },
+    { _OVM_STR_CONST_HASH("#SO_REUSEADDR"), SO_REUSEADDR },
+    { _OVM_STR_CONST_HASH("#SO_REUSEPORT"), SO_REUSEPORT },
+    { _OVM_STR_CONST_HASH("#SO_KEEPALIVE"), SO_KEEPALIVE },
+    { _OVM_STR_CONST_HASH("#SO_RCVBUF"),   SO_RCVBUF },
+    { _OVM_STR_CONST_HASH("#SO_SNDBUF"),   SO_SNDBUF },
+    { _OVM_STR_CONST_HASH("#SO_ERROR"),    SO_ERROR },
+    { _OVM_STR_CONST_HASH("#TCP_NODELAY"), TCP_NODELAY }
+};
+
+static const struct class_var selector_class_vars[] = {
+    { _OVM_STR_CONST_HASH("#EPOLLIN"),      EPOLLIN },
+    { _OVM_STR_CONST_HASH("#EPOLLOUT"),     EPOLLOUT },
+    { _OVM_STR_CONST_HASH("#EPOLLPRI"),     EPOLLPRI },
+    { _OVM_STR_CONST_HASH("#EPOLLERR"),     EPOLLERR },
+    { _OVM_STR_CONST_HASH("#EPOLLHUP"),     EPOLLHUP },
+    { _OVM_STR_CONST_HASH("#EPOLLRDHUP"),   EPOLLRDHUP },
+    { _OVM_STR_CONST_HASH("#EPOLLET"),      EPOLLET },
+    { _OVM_STR_CONST_HASH("#EPOLLONESHOT"), EPOLLONESHOT }
+};
+
+/* Class on top of stack */
+
+static void class_vars_init(ovm_thread_t th, unsigned n, const struct class_var *v)
+{
+    ovm_inst_t work = ovm_stack_alloc(th, 3);
+
+    for (; n > 0; --n, ++v) {
+        ovm_inst_assign(&work[-3], &work[0]);
+        ovm_str_newc(&work[-2], v->nm_size, v->nm);
+        ovm_int_newc(&work[-1], v->val);
+        ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(atput), 3);
+    }
+
+    ovm_stack_unwind(th, work);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Socket
+
+void __socket_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv)
+{
+    ovm_inst_t old = th->sp;
+
+    ovm_stack_push(th, &argv[0]);
+
+    ovm_stack_push_obj(th, ovm_consts.Object);
+    ovm_class_new(th, OVM_STR_CONST_HASH(Socket), 0, socket_cleanup, socket_cleanup);
+    my_class = th->sp->objval;
+
+    class_vars_init(th, ARRAY_SIZE(socket_class_vars), socket_class_vars);
+    
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(new), METHOD_NAME(new));
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(serve), METHOD_NAME(serve));
+    ovm_method_add(th, _OVM_STR_CONST_HASH("errno"), socket$Socket$errno);
+    ovm_method_add(th, OVM_STR_CONST_HASH(bind),     METHOD_NAME(bind));
+    ovm_method_add(th, OVM_STR_CONST_HASH(connect),  METHOD_NAME(connect));
+    ovm_method_add(th, OVM_STR_CONST_HASH(listen),   METHOD_NAME(listen));
     ovm_method_add(th, OVM_STR_CONST_HASH(accept),   METHOD_NAME(accept));
     ovm_method_add(th, OVM_STR_CONST_HASH(read),     METHOD_NAME(read));
     ovm_method_add(th, OVM_STR_CONST_HASH(readln),   METHOD_NAME(readln));
+    ovm_method_add(th, OVM_STR_CONST_HASH(readuntil), METHOD_NAME(readuntil));
+    ovm_method_add(th, OVM_STR_CONST_HASH(peek),     METHOD_NAME(peek));
+    ovm_method_add(th, OVM_STR_CONST_HASH(pending),  METHOD_NAME(pending));
+    ovm_method_add(th, OVM_STR_CONST_HASH(setblocking), METHOD_NAME(setblocking));
+    ovm_method_add(th, OVM_STR_CONST_HASH(setsockopt), METHOD_NAME(setsockopt));
+    ovm_method_add(th, OVM_STR_CONST_HASH(getsockopt), METHOD_NAME(getsockopt));
     ovm_method_add(th, OVM_STR_CONST_HASH(write),    METHOD_NAME(write));
+    ovm_method_add(th, OVM_STR_CONST_HASH(writev),   METHOD_NAME(writev));
+    ovm_method_add(th, OVM_STR_CONST_HASH(sendfile), METHOD_NAME(sendfile));
+    ovm_method_add(th, OVM_STR_CONST_HASH(recvmany), METHOD_NAME(recvmany));
+    ovm_method_add(th, OVM_STR_CONST_HASH(sendmany), METHOD_NAME(sendmany));
     ovm_method_add(th, OVM_STR_CONST_HASH(String),   METHOD_NAME(write));
 
+    ovm_stack_unwind(th, old);
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Selector
+
+    ovm_stack_push(th, &argv[0]);
+
+    ovm_stack_push_obj(th, ovm_consts.Object);
+    ovm_class_new(th, OVM_STR_CONST_HASH(Selector), selector_mark, selector_free, selector_cleanup);
+    selector_class = th->sp->objval;
+
+    class_vars_init(th, ARRAY_SIZE(selector_class_vars), selector_class_vars);
+
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(new), METHOD_NAME(new));
+    ovm_method_add(th, _OVM_STR_CONST_HASH("errno"), socket$Selector$errno);
+    ovm_method_add(th, OVM_STR_CONST_HASH(register),   METHOD_NAME(register));
+    ovm_method_add(th, OVM_STR_CONST_HASH(modify),     METHOD_NAME(modify));
+    ovm_method_add(th, OVM_STR_CONST_HASH(unregister), METHOD_NAME(unregister));
+    ovm_method_add(th, OVM_STR_CONST_HASH(size),       METHOD_NAME(size));
+    ovm_method_add(th, OVM_STR_CONST_HASH(wait),       METHOD_NAME(wait));
+
     ovm_stack_unwind(th, old);
 }
 
@@ -1,4 +1,13 @@
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <poll.h>
+
 #include "oovm.h"
+#include "oovm_psort.h"
 
 static ovm_obj_t cl_thread;
 
@@ -146,18 +155,629 @@ CM_DECL(new)
 
 CM_DECL(lock)
 {
-    pthread_mutex_lock(ovm_inst_mutexval(th, &argv[0])->mutex);
+    if (pthread_mutex_lock(ovm_inst_mutexval(th, &argv[0])->mutex) == 0)  ++_ovm_locks_held;
     ovm_inst_assign(dst, &argv[0]);
 }
 
 CM_DECL(unlock)
 {
-    pthread_mutex_unlock(ovm_inst_mutexval(th, &argv[0])->mutex);
+    if (pthread_mutex_unlock(ovm_inst_mutexval(th, &argv[0])->mutex) == 0 && _ovm_locks_held > 0)  --_ovm_locks_held;
     ovm_inst_assign(dst, &argv[0]);
 }
 
 /***************************************************************************/
 
+/* Coroutines -- green threads, each an OVM thread with small stacks and a C
+   stack of its own, switched with swapcontext().
+
+   Each pthread has its own scheduler, which runs the coroutines created on
+   that pthread, one at a time, whenever the pthread calls Coroutine.run(),
+   or join()s a coroutine.  A coroutine runs until it finishes, yields,
+   sleeps, joins another coroutine, or does I/O that would block -- the
+   socket module, for one, suspends the coroutine then, see
+   ovm_thread_io_wait() -- and the scheduler waits with epoll for whatever
+   coroutines are waiting on, once none is ready to run.
+
+   Coroutines of a pthread share its locks, so one holding a lock -- an
+   object's, as an Array's while its write() method runs, or a Mutex -- must
+   not let others run, which could then deadlock on it.  Joining, yielding
+   and sleeping then raise an exception, and I/O blocks the whole pthread,
+   rather than suspending the coroutine.  A coroutine waiting for I/O on a
+   file descriptor about to be closed, on the same pthread, is resumed, and
+   its wait fails -- see ovm_thread_io_close().
+
+   So a connection handled by a coroutine costs some 56K of instance and
+   frame stack, plus what of its C stack it touches, rather than a pthread.
+   For more cores, run a scheduler in each of several Threads.
+*/
+
+enum {
+    CO_STACK_SIZE       = 2048,       /* Instance stack, in instances */
+    CO_FRAME_STACK_SIZE = 24 * 1024,  /* Frame stack, in bytes -- both allow some 250 nested method calls */
+    CO_CSTACK_SIZE      = 256 * 1024, /* C stack, in bytes; pages are only committed as touched */
+    CO_EPOLL_EVENTS     = 64          /* Most events taken per epoll_wait() */
+};
+
+struct sched {
+    ovm_thread_t      host;     /* Thread running scheduler */
+    ucontext_t        ctx[1];   /* Scheduler context */
+    int               epoll_fd;
+    struct ovm_dllist ready[1]; /* Runnable coroutines, in order */
+    struct co         **sleeping; /* Sleeping coroutines, heap by wake-up time */
+    unsigned          sleeping_cnt, sleeping_size;
+    struct co         *cur;     /* Running coroutine */
+    unsigned          cnt;      /* Coroutines not finished */
+    struct ovm_dllist io_waiting[1]; /* Coroutines waiting for I/O */
+};
+
+static __thread struct sched *sched_self; /* This pthread's scheduler */
+
+struct co {
+    struct ovm_dllist list_node[1]; /* In a ready or joiners list */
+    struct sched      *sched;
+    ovm_thread_t      th;
+    ucontext_t        ctx[1];
+    void              *cstack;
+    double            wake;     /* Wake-up time, if sleeping */
+    int               io_fd, io_wfd; /* File descriptor waited for, and one registered with epoll, if waiting for I/O */
+    struct ovm_dllist joiners[1]; /* Coroutines waiting for this one to finish */
+    bool              donef;
+};
+
+static inline struct co *co_list_node(struct ovm_dllist *p)
+{
+    return (FIELD_PTR_TO_STRUCT_PTR(p, struct co, list_node));
+}
+
+static ovm_obj_t cl_coroutine;
+
+struct ovm_obj_coroutine {
+    struct ovm_obj  base[1];
+    struct ovm_inst result[1];  /* Result of entry method, once finished */
+    struct co       *co;        /* 0 once finished */
+};
+typedef struct ovm_obj_coroutine *ovm_obj_coroutine_t;
+
+static inline ovm_obj_coroutine_t ovm_obj_coroutine(ovm_obj_t obj)
+{
+    return ((ovm_obj_coroutine_t) obj);
+}
+
+static ovm_obj_coroutine_t ovm_inst_coroutineval(ovm_thread_t th, ovm_inst_t inst)
+{
+    if (ovm_inst_of_raw(inst) != ovm_obj_class(cl_coroutine))  ovm_except_inv_value(th, inst);
+    return (ovm_obj_coroutine(inst->objval));
+}
+
+static void coroutine_mark(ovm_obj_t obj)
+{
+    ovm_inst_mark(ovm_obj_coroutine(obj)->result);
+}
+
+static void coroutine_free(ovm_obj_t obj)
+{
+    ovm_inst_release(ovm_obj_coroutine(obj)->result);
+}
+
+static void coroutine_init(ovm_obj_t obj, va_list ap)
+{
+    ovm_obj_coroutine_t c = ovm_obj_coroutine(obj);
+    memset(obj + 1, 0, sizeof(*c) - sizeof(*obj));
+}
+
+/* A coroutine's instance stack is laid out as for ovm_thread_entry(), with
+   its Coroutine below that, which keeps the Coroutine alive while it runs
+*/
+
+static inline ovm_inst_t co_top(struct co *co)
+{
+    return (&co->th->stack_top[-1]);
+}
+
+static inline ovm_obj_coroutine_t co_obj(struct co *co)
+{
+    return (ovm_obj_coroutine(co->th->stack_top[-1].objval));
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static struct sched *sched_get(void)
+{
+    struct sched *s = sched_self;
+    if (s != 0)  return (s);
+
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0)  return (0);
+    s = (struct sched *) ovm_mem_alloc(sizeof(*s), OVM_MEM_ALLOC_NO_HINT, true);
+    s->epoll_fd = fd;
+    ovm_dllist_init(s->ready);
+    ovm_dllist_init(s->io_waiting);
+
+    return (sched_self = s);
+}
+
+static void sched_free(struct sched *s)
+{
+    close(s->epoll_fd);
+    free(s->sleeping);
+    ovm_mem_free(s, sizeof(*s));
+    sched_self = 0;
+}
+
+static inline void co_ready(struct co *co)
+{
+    ovm_dllist_insert(co->list_node, ovm_dllist_end(co->sched->ready));
+}
+
+/* Switch from the running coroutine to the scheduler, until resumed */
+
+static inline void co_suspend(struct co *co)
+{
+    swapcontext(co->ctx, co->sched->ctx);
+}
+
+static void co_entry(void)
+{
+    struct sched *s = sched_self;
+    struct co *co = s->cur;
+
+    ovm_thread_run(co->th, co_top(co));
+
+    ovm_obj_coroutine_t c = co_obj(co);
+    ovm_inst_assign(c->result, &co_top(co)[-3]);
+    c->co = 0;
+    struct ovm_dllist *p;
+    while ((p = ovm_dllist_first(co->joiners)) != ovm_dllist_end(co->joiners)) {
+        ovm_dllist_erase(p);
+        co_ready(co_list_node(p));
+    }
+    co->donef = true;
+    --s->cnt;
+
+    /* Return to the scheduler, through uc_link */
+}
+
+static void co_free(struct co *co)
+{
+    ovm_thread_destroy(co->th);
+    munmap(co->cstack, CO_CSTACK_SIZE);
+    ovm_mem_free(co, sizeof(*co));
+}
+
+static void co_resume(struct sched *s, struct co *co)
+{
+    s->cur = co;
+    ovm_thread_self_set(co->th);
+    unsigned locks_held = _ovm_locks_held;
+    _ovm_locks_held = 0;
+
+    swapcontext(s->ctx, co->ctx);
+
+    _ovm_locks_held = locks_held;
+    ovm_thread_self_set(s->host);
+    s->cur = 0;
+    if (co->donef)  co_free(co);
+}
+
+/* Suspend the running coroutine until fd is ready -- see ovm_thread_io_wait() */
+
+static int co_io_wait(ovm_thread_t th, int fd, unsigned events)
+{
+    if (_ovm_locks_held != 0) {
+        /* Holding a lock => block the pthread, see above */
+
+        struct pollfd pfd[1];
+        pfd->fd     = fd;
+        pfd->events = events;
+        while (poll(pfd, 1, -1) < 0) {
+            if (errno != EINTR)  return (-1);
+        }
+
+        return (0);
+    }
+
+    struct co *co = (struct co *) th->co;
+    struct sched *s = co->sched;
+    struct epoll_event ev[1];
+    ev->events   = events | EPOLLONESHOT;
+    ev->data.ptr = co;
+    int wfd = fd;
+    if (epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, wfd, ev) < 0) {
+        /* Another coroutine is waiting on the same fd => wait on a
+           duplicate of it, which epoll keeps apart
+        */
+
+        if (errno != EEXIST || (wfd = dup(fd)) < 0)  return (-1);
+        if (epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, wfd, ev) < 0) {
+            close(wfd);
+            return (-1);
+        }
+    }
+
+    co->io_fd  = fd;
+    co->io_wfd = wfd;
+    ovm_dllist_insert(co->list_node, ovm_dllist_end(s->io_waiting));
+    co_suspend(co);
+
+    if (co->io_wfd < 0) {
+        /* fd was closed, see co_io_close() */
+
+        errno = EBADF;
+        return (-1);
+    }
+    epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, wfd, 0);
+    if (wfd != fd)  close(wfd);
+
+    return (0);
+}
+
+/* fd is about to be closed => resume this pthread's coroutines waiting for it,
+   their waits failing -- see ovm_thread_io_close()
+*/
+
+static void co_io_close(int fd)
+{
+    struct sched *s = sched_self;
+    if (s == 0)  return;
+
+    struct ovm_dllist *p, *q;
+    for (p = ovm_dllist_first(s->io_waiting); p != ovm_dllist_end(s->io_waiting); p = q) {
+        q = ovm_dllist_next(p);
+        struct co *co = co_list_node(p);
+        if (co->io_fd != fd)  continue;
+        epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, co->io_wfd, 0);
+        if (co->io_wfd != fd)  close(co->io_wfd);
+        co->io_wfd = -1;
+        ovm_dllist_erase(p);
+        co_ready(co);
+    }
+}
+
+static void co_sleep(struct co *co, double t)
+{
+    struct sched *s = co->sched;
+    if (s->sleeping_cnt == s->sleeping_size) {
+        unsigned n = s->sleeping_size == 0 ? 16 : s->sleeping_size << 1;
+        struct co **p = (struct co **) realloc(s->sleeping, n * sizeof(*p));
+        if (p == 0) {
+            /* No room => just yield */
+
+            co_ready(co);
+            co_suspend(co);
+            return;
+        }
+        s->sleeping = p;
+        s->sleeping_size = n;
+    }
+
+    co->wake = now() + t;
+    unsigned i, j;
+    for (i = s->sleeping_cnt++; i > 0; i = j) {
+        j = (i - 1) >> 1;
+        if (s->sleeping[j]->wake <= co->wake)  break;
+        s->sleeping[i] = s->sleeping[j];
+    }
+    s->sleeping[i] = co;
+
+    co_suspend(co);
+}
+
+/* Remove the coroutine to wake up first */
+
+static struct co *sleeping_pop(struct sched *s)
+{
+    struct co *result = s->sleeping[0], *co = s->sleeping[--s->sleeping_cnt];
+    unsigned n = s->sleeping_cnt, i, j;
+    for (i = 0; (j = 2 * i + 1) < n; i = j) {
+        if (j + 1 < n && s->sleeping[j + 1]->wake < s->sleeping[j]->wake)  ++j;
+        if (co->wake <= s->sleeping[j]->wake)  break;
+        s->sleeping[i] = s->sleeping[j];
+    }
+    s->sleeping[i] = co;
+
+    return (result);
+}
+
+/* Run coroutines, until all have finished, or the given one has, or none
+   can ever run again (all remaining are joining each other)
+*/
+
+static void sched_run(ovm_thread_t th, struct sched *s, ovm_obj_coroutine_t until)
+{
+    s->host = th;
+
+    while (s->cnt > 0 && (until == 0 || until->co != 0)) {
+        struct ovm_dllist *p;
+        if ((p = ovm_dllist_first(s->ready)) != ovm_dllist_end(s->ready)) {
+            ovm_dllist_erase(p);
+            co_resume(s, co_list_node(p));
+            continue;
+        }
+
+        int timeout = -1;
+        if (s->sleeping_cnt > 0) {
+            double t = s->sleeping[0]->wake - now();
+            timeout = t <= 0 ? 0 : (int)(t * 1000) + 1;
+        } else if (ovm_dllist_empty(s->io_waiting))  break;
+
+        struct epoll_event ev[CO_EPOLL_EVENTS];
+        int n = epoll_wait(s->epoll_fd, ev, CO_EPOLL_EVENTS, timeout);
+        int i;
+        for (i = 0; i < n; ++i) {
+            struct co *co = (struct co *) ev[i].data.ptr;
+            ovm_dllist_erase(co->list_node);
+            co_ready(co);
+        }
+
+        double t = now();
+        while (s->sleeping_cnt > 0 && s->sleeping[0]->wake <= t)  co_ready(sleeping_pop(s));
+    }
+}
+
+static double secs_inst(ovm_thread_t th, ovm_inst_t inst)
+{
+    double t = inst->type == OVM_INST_TYPE_INT ? inst->intval : ovm_inst_floatval(th, inst);
+    if (t < 0)  ovm_except_inv_value(th, inst);
+
+    return (t);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Coroutine
+
+/* new(method, args...) -- make a coroutine, to run method(args...) */
+
+CM_DECL(new)
+{
+    ovm_method_argc_chk_min(th, 2);
+    switch (argv[1].type) {
+    case OVM_INST_TYPE_CODEMETHOD:
+    case OVM_INST_TYPE_METHOD:
+	break;
+    default:
+	ovm_except_inv_value(th, &argv[1]);
+    }
+
+    struct sched *s = sched_get();
+    void *cstack;
+    if (s == 0
+        || (cstack = mmap(0, CO_CSTACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_NORESERVE, -1, 0)) == MAP_FAILED
+        ) {
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+    mprotect(cstack, sysconf(_SC_PAGESIZE), PROT_NONE); /* Guard page */
+
+    ovm_obj_coroutine_t c = ovm_obj_coroutine(ovm_obj_alloc(dst, sizeof(struct ovm_obj_coroutine), ovm_obj_class(cl_coroutine), OVM_MEM_ALLOC_NO_HINT, coroutine_init));
+    struct co *co = (struct co *) ovm_mem_alloc(sizeof(*co), OVM_MEM_ALLOC_NO_HINT, true);
+    ovm_dllist_init(co->joiners);
+    co->sched  = s;
+    co->cstack = cstack;
+    co->th = ovm_thread_create(CO_STACK_SIZE, CO_FRAME_STACK_SIZE);
+    co->th->id      = th->id;
+    co->th->co      = co;
+    co->th->io_wait = co_io_wait;
+    c->co = co;
+
+    unsigned n = argc - 2;
+    co->th->sp -= n + 4;	/* ns method dst args, with Coroutine below */
+
+    ovm_inst_t p, q;
+    for (q = &argv[2], p = co->th->sp; n > 0; --n, ++p, ++q)  ovm_inst_assign(p, q);
+    ovm_inst_assign(++p, &argv[1]);
+    ovm_stack_push_obj(th, ovm_consts.Namespace);
+    ovm_method_callsch(th, th->sp, OVM_STR_CONST_HASH(current), 1);
+    ovm_method_callsch(th, ++p, OVM_STR_CONST_HASH(parent), 1);
+    ovm_stack_free(th, 1);
+    ovm_inst_assign(++p, dst);
+
+    getcontext(co->ctx);
+    co->ctx->uc_stack.ss_sp   = cstack;
+    co->ctx->uc_stack.ss_size = CO_CSTACK_SIZE;
+    co->ctx->uc_link          = s->ctx;
+    makecontext(co->ctx, co_entry, 0);
+
+    ++s->cnt;
+    co_ready(co);
+}
+
+/* Run this pthread's coroutines, until none can run any more; returns the
+   number that never finished
+*/
+
+CM_DECL(run)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    if (th->co != 0)  ovm_except_inv_value(th, &argv[0]);
+
+    struct sched *s = sched_self;
+    unsigned n = 0;
+    if (s != 0) {
+        sched_run(th, s, 0);
+        if ((n = s->cnt) == 0)  sched_free(s);
+    }
+
+    ovm_int_newc(dst, n);
+}
+
+CM_DECL(current)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    if (th->co == 0) {
+        ovm_inst_assign_obj(dst, 0);
+        return;
+    }
+    ovm_inst_assign(dst, co_top((struct co *) th->co));
+}
+
+/* Let other ready coroutines run */
+
+CM_DECL(yield)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    struct co *co = (struct co *) th->co;
+    if (co != 0) {
+        if (_ovm_locks_held != 0)  ovm_except_inv_value(th, &argv[0]);
+        co_ready(co);
+        co_suspend(co);
+    }
+
+    ovm_inst_assign_obj(dst, 0);
+}
+
+/* sleep(secs) -- outside a coroutine, sleeps the pthread */
+
+CM_DECL(sleep)
+{
+    ovm_method_argc_chk_exact(th, 2);
+    double t = secs_inst(th, &argv[1]);
+    struct co *co = (struct co *) th->co;
+    if (co != 0) {
+        if (_ovm_locks_held != 0)  ovm_except_inv_value(th, &argv[0]);
+        co_sleep(co, t);
+    } else {
+        struct timespec ts[1];
+        ts->tv_sec  = (time_t) t;
+        ts->tv_nsec = (long)((t - ts->tv_sec) * 1e9);
+        while (nanosleep(ts, ts) < 0 && errno == EINTR);
+    }
+
+    ovm_inst_assign_obj(dst, 0);
+}
+
+/* Wait for a coroutine to finish, and return the result of its entry
+   method -- outside a coroutine, runs the scheduler meanwhile
+*/
+
+CM_DECL(join)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    ovm_obj_coroutine_t c = ovm_inst_coroutineval(th, &argv[0]);
+    if (c->co != 0) {
+        struct sched *s = c->co->sched;
+        struct co *co = (struct co *) th->co;
+        if (s != sched_self || c->co == co)  ovm_except_inv_value(th, &argv[0]);
+        if (co != 0) {
+            if (_ovm_locks_held != 0)  ovm_except_inv_value(th, &argv[0]);
+            ovm_dllist_insert(co->list_node, ovm_dllist_end(c->co->joiners));
+            co_suspend(co);
+        } else {
+            sched_run(th, s, c);
+            if (s->cnt == 0)  sched_free(s);
+        }
+    }
+
+    ovm_inst_assign(dst, c->result);
+}
+
+CM_DECL(done)
+{
+    ovm_method_argc_chk_exact(th, 1);
+    ovm_bool_newc(dst, ovm_inst_coroutineval(th, &argv[0])->co == 0);
+}
+
+/***************************************************************************/
+
+/* Parallel sorting, see oovm_psort.h
+
+   Array.psort([nthreads]) sorts an Array in place, like Array.sort(), using
+   up to nthreads threads (default: number of CPUs online).  Only Arrays of
+   all Integers or all Floats, big enough to be worth it, are sorted in
+   parallel; anything else is handed to Array.sort().
+*/
+
+#define PSORT_MIN_SIZE   (1 << 16) /* Arrays smaller than this are sorted serially */
+#define PSORT_MIN_CHUNK  (1 << 12) /* Minimum elements per thread */
+
+static int psort_type(unsigned n, ovm_inst_t data)
+{
+    unsigned char type = data->type;
+    if (type != OVM_INST_TYPE_INT && type != OVM_INST_TYPE_FLOAT)  return (-1);
+    for (++data, --n; n > 0; --n, ++data) {
+        if (data->type != type)  return (-1);
+    }
+
+    return (type == OVM_INST_TYPE_FLOAT ? OVM_PSORT_FLOAT : OVM_PSORT_INT);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Array
+
+CM_DECL(psort)
+{
+    ovm_method_argc_chk_range(th, 1, 2);
+    ovm_inst_t recvr = &argv[0];
+    if (ovm_inst_of_raw(recvr) != OVM_CL_ARRAY)  ovm_except_inv_value(th, recvr);
+    ovm_obj_array_t a = ovm_inst_arrayval_nochk(recvr);
+    unsigned n = a->size;
+
+    long nthreads;
+    if (argc > 1) {
+        ovm_intval_t k = ovm_inst_intval(th, &argv[1]);
+        if (k < 1)  ovm_except_inv_value(th, &argv[1]);
+        nthreads = k > OVM_PSORT_THREADS_MAX ? OVM_PSORT_THREADS_MAX : k;
+    } else {
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (nthreads > n / PSORT_MIN_CHUNK)  nthreads = n / PSORT_MIN_CHUNK;
+
+    int type = -1;
+    unsigned size = 0;
+    ovm_inst_t v = 0;
+    if (n >= PSORT_MIN_SIZE && n <= UINT_MAX / (2 * sizeof(*a->data))
+        && nthreads >= 2
+        ) {
+        /* Workers sort a private copy, holding no VM locks.  Other threads
+           may change the Array meanwhile, moving its elements, so the copy
+           is taken, and the result assigned back, under the lock.
+        */
+        size = 2 * n * sizeof(*a->data);
+        v = (ovm_inst_t) ovm_mem_alloc(size, OVM_MEM_ALLOC_NO_HINT, false);
+
+        _ovm_objs_lock();
+
+        bool copiedf = (a->size == n);
+        if (copiedf)  memcpy(v, a->data, n * sizeof(*v));
+
+        _ovm_objs_unlock();
+
+        if (copiedf)  type = psort_type(n, v);
+    }
+    if (type < 0) {
+        if (v != 0)  ovm_mem_free(v, size);
+
+        ovm_stack_push(th, recvr);
+        ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(sort), 1);
+        ovm_stack_free(th, 1);
+
+        return;
+    }
+
+    ovm_psort(nthreads, n, v, &v[n], type);
+
+    _ovm_objs_lock();
+
+    bool resizedf = (a->size != n);
+    if (!resizedf) {
+        unsigned i;
+        for (i = 0; i < n; ++i)  _ovm_inst_assign_nolock(&a->data[i], &v[i]);
+    }
+
+    _ovm_objs_unlock();
+
+    ovm_mem_free(v, size);
+    if (resizedf)  ovm_except_inv_value(th, recvr);
+    ovm_inst_assign(dst, recvr);
+}
+
+/***************************************************************************/
+
 void __thread_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv)
 {
     ovm_inst_t old = th->sp;
@@ -190,6 +810,34 @@ void __thread_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t
     ovm_method_add(th, OVM_STR_CONST_HASH(lock),   METHOD_NAME(lock));
     ovm_method_add(th, OVM_STR_CONST_HASH(unlock), METHOD_NAME(unlock));
 
+    ovm_stack_free(th, 1);
+
+    ovm_stack_push_obj(th, ovm_consts.Object);
+    ovm_class_new(th, OVM_STR_CONST_HASH(Coroutine), coroutine_mark, coroutine_free, 0);
+    cl_coroutine = th->sp->objval;
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Coroutine
+  
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(new),     METHOD_NAME(new));
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(run),     METHOD_NAME(run));
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(current), METHOD_NAME(current));
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(yield),   METHOD_NAME(yield));
+    ovm_classmethod_add(th, OVM_STR_CONST_HASH(sleep),   METHOD_NAME(sleep));
+    ovm_method_add(th, OVM_STR_CONST_HASH(join), METHOD_NAME(join));
+    ovm_method_add(th, OVM_STR_CONST_HASH(done), METHOD_NAME(done));
+
+    ovm_stack_free(th, 1);
+
+    ovm_thread_io_close_hook_set(co_io_close);
+
+    ovm_stack_push_obj(th, ovm_consts.Array);
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Array
+
+    ovm_method_add(th, OVM_STR_CONST_HASH(psort), METHOD_NAME(psort));
+
     ovm_stack_unwind(th, old);
 }
 
@@ -0,0 +1,668 @@
+/***************************************************************************
+ *
+ * zlib module
+ *
+ * - Add one-shot compression and checksum methods to Bytearray and
+ *   Byteslice (and so to Cbytearray and Cbyteslice):
+ *     deflate([level]), gzip([level])  - compress, to zlib or gzip format
+ *     inflate()                        - decompress either format
+ *     crc32([crc]), adler32([adler]), crc32c([crc])
+ *                                      - checksum, optionally continuing
+ *                                        from a previous one
+ * - Deflater and Inflater classes, for streaming; each wraps a sink --
+ *   any object with a write() method taking a Bytearray, e.g. a File or a
+ *   Socket, or another Deflater or Inflater -- and writes its output there
+ *   as it is produced
+ * - CRC32C uses the SSE4.2 crc32 instruction when the CPU has it
+ *
+ ***************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "oovm.h"
+
+#define ARRAY_SIZE(a)  (sizeof(a) / sizeof((a)[0]))
+
+enum {
+  ZLIB_FORMAT_ZLIB = MAX_WBITS,
+  ZLIB_FORMAT_GZIP = MAX_WBITS + 16,
+  ZLIB_FORMAT_AUTO = MAX_WBITS + 32, /* Inflate only */
+  ZLIB_FORMAT_RAW  = -MAX_WBITS,
+
+  ZLIB_CHUNK_SIZE  = 16384       /* Streaming output is written in pieces of at most this */
+};
+
+static ovm_obj_t deflater_class, inflater_class;
+
+static z_stream *zstream_oneshot(ovm_inst_t dst, bool inflatef);
+
+static int level_arg(ovm_thread_t th, unsigned argc, ovm_inst_t argv, unsigned i)
+{
+  if (argc <= i)  return (Z_DEFAULT_COMPRESSION);
+  ovm_intval_t level = ovm_inst_intval(th, &argv[i]);
+  if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION)  ovm_except_inv_value(th, &argv[i]);
+
+  return (level);
+}
+
+/* Make a new, zeroed Bytearray of the given size */
+
+static ovm_obj_barray_t barray_new(ovm_thread_t th, ovm_inst_t dst, unsigned size)
+{
+  ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+  ovm_inst_assign_obj(&work[-2], ovm_consts.Bytearray);
+  ovm_int_newc(&work[-1], size);
+  ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(new), 2);
+
+  ovm_stack_unwind(th, work);
+
+  return (ovm_inst_barrayval_nochk(dst));
+}
+
+/* Make a Bytearray holding a copy of the given bytes */
+
+static void barray_newc(ovm_thread_t th, ovm_inst_t dst, unsigned size, const unsigned char *data)
+{
+  ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+  memcpy(barray_new(th, &work[-1], size)->data, data, size);
+  ovm_inst_assign(dst, &work[-1]);
+
+  ovm_stack_unwind(th, work);
+}
+
+/***************************************************************************/
+
+/* CRC32C (Castagnoli), which, unlike zlib's CRC32, x86-64 has an
+   instruction for
+*/
+
+#define CRC32C_POLY  0x82f63b78U /* Reflected */
+
+static uint32_t crc32c_tbl[256];
+
+static void crc32c_tbl_init(void)
+{
+  unsigned i, k;
+  for (i = 0; i < ARRAY_SIZE(crc32c_tbl); ++i) {
+    uint32_t c = i;
+    for (k = 0; k < 8; ++k)  c = (c >> 1) ^ (c & 1 ? CRC32C_POLY : 0);
+    crc32c_tbl[i] = c;
+  }
+}
+
+static uint32_t crc32c_sw(uint32_t crc, unsigned size, const unsigned char *data)
+{
+  for (; size > 0; --size, ++data)  crc = crc32c_tbl[(crc ^ *data) & 0xff] ^ (crc >> 8);
+
+  return (crc);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, unsigned size, const unsigned char *data)
+{
+  unsigned long long c = crc;
+  for (; size >= 8; size -= 8, data += 8) {
+    unsigned long long v;
+    memcpy(&v, data, sizeof(v));
+    c = __builtin_ia32_crc32di(c, v);
+  }
+  crc = c;
+  for (; size > 0; --size, ++data)  crc = __builtin_ia32_crc32qi(crc, *data);
+
+  return (crc);
+}
+
+#endif
+
+static uint32_t (*crc32c_func)(uint32_t crc, unsigned size, const unsigned char *data) = crc32c_sw;
+
+/***************************************************************************/
+
+#define METHOD_MODULE  zlib
+#define METHOD_CLASS   Bytearray
+
+/* Compress, in one go, with the given window bits (so format) */
+
+static void zdeflate(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv, int window_bits)
+{
+  ovm_method_argc_chk_range(th, 1, 2);
+  unsigned size;
+  const unsigned char *data;
+  if (!ovm_inst_bytes(&argv[0], &size, &data))  ovm_except_inv_value(th, &argv[0]);
+  int level = level_arg(th, argc, argv, 1);
+
+  ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+  z_stream *zs = zstream_oneshot(&work[-2], false);
+  if (deflateInit2(zs, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)  ovm_except_inv_value(th, &argv[0]);
+
+  ovm_obj_barray_t b = barray_new(th, &work[-1], deflateBound(zs, size));
+  zs->next_in   = (unsigned char *) data;
+  zs->avail_in  = size;
+  zs->next_out  = b->data;
+  zs->avail_out = b->size;
+  int rc = deflate(zs, Z_FINISH);
+  deflateEnd(zs);
+  if (rc != Z_STREAM_END)  ovm_except_inv_value(th, &argv[0]);
+
+  barray_newc(th, dst, zs->total_out, b->data);
+}
+
+CM_DECL(deflate)
+{
+  zdeflate(th, dst, argc, argv, ZLIB_FORMAT_ZLIB);
+}
+
+CM_DECL(gzip)
+{
+  zdeflate(th, dst, argc, argv, ZLIB_FORMAT_GZIP);
+}
+
+/* Decompress, in one go, zlib or gzip format; the output buffer starts at a
+   guess and is doubled as needed
+*/
+
+CM_DECL(inflate)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  unsigned size;
+  const unsigned char *data;
+  if (!ovm_inst_bytes(&argv[0], &size, &data))  ovm_except_inv_value(th, &argv[0]);
+
+  ovm_inst_t work = ovm_stack_alloc(th, 3);
+
+  z_stream *zs = zstream_oneshot(&work[-3], true);
+  if (inflateInit2(zs, ZLIB_FORMAT_AUTO) != Z_OK)  ovm_except_inv_value(th, &argv[0]);
+
+  unsigned n = size < (1U << 26) ? size << 2 : size;
+  if (n < 64)  n = 64;
+  ovm_obj_barray_t b = barray_new(th, &work[-1], n);
+  zs->next_in   = (unsigned char *) data;
+  zs->avail_in  = size;
+  zs->next_out  = b->data;
+  zs->avail_out = b->size;
+  int rc;
+  while ((rc = inflate(zs, Z_FINISH)) != Z_STREAM_END) {
+    if (!((rc == Z_OK || rc == Z_BUF_ERROR) && zs->avail_out == 0 && b->size <= (~0U >> 2))) {
+      /* Corrupt, truncated or too big */
+
+      inflateEnd(zs);
+      ovm_except_inv_value(th, &argv[0]);
+    }
+
+    ovm_inst_assign(&work[-2], &work[-1]);
+    ovm_obj_barray_t bb = barray_new(th, &work[-1], b->size << 1);
+    memcpy(bb->data, b->data, b->size);
+    zs->next_out  = bb->data + b->size;
+    zs->avail_out = bb->size - b->size;
+    b = bb;
+  }
+  inflateEnd(zs);
+
+  barray_newc(th, dst, zs->total_out, b->data);
+}
+
+/* Checksums -- the optional argument is a previous checksum to continue
+   from, so that a checksum can be computed over several pieces
+*/
+
+static uint32_t checksum_arg(ovm_thread_t th, unsigned argc, ovm_inst_t argv, uint32_t dflt)
+{
+  ovm_method_argc_chk_range(th, 1, 2);
+  if (argc < 2)  return (dflt);
+  ovm_intval_t v = ovm_inst_intval(th, &argv[1]);
+  if (v < 0 || v > 0xffffffffLL)  ovm_except_inv_value(th, &argv[1]);
+
+  return (v);
+}
+
+CM_DECL(crc32)
+{
+  uint32_t crc = checksum_arg(th, argc, argv, 0);
+  unsigned size;
+  const unsigned char *data;
+  if (!ovm_inst_bytes(&argv[0], &size, &data))  ovm_except_inv_value(th, &argv[0]);
+  ovm_int_newc(dst, crc32(crc, data, size));
+}
+
+CM_DECL(adler32)
+{
+  uint32_t adler = checksum_arg(th, argc, argv, 1);
+  unsigned size;
+  const unsigned char *data;
+  if (!ovm_inst_bytes(&argv[0], &size, &data))  ovm_except_inv_value(th, &argv[0]);
+  ovm_int_newc(dst, adler32(adler, data, size));
+}
+
+CM_DECL(crc32c)
+{
+  uint32_t crc = checksum_arg(th, argc, argv, 0);
+  unsigned size;
+  const unsigned char *data;
+  if (!ovm_inst_bytes(&argv[0], &size, &data))  ovm_except_inv_value(th, &argv[0]);
+  ovm_int_newc(dst, ~(*crc32c_func)(~crc, size, data));
+}
+
+/***************************************************************************/
+
+/* Streaming */
+
+struct ovm_obj_zstream {
+  struct ovm_obj base[1];
+  ovm_obj_t      sink;
+  bool           inflatef;      /* Inflater, else Deflater */
+  bool           initf;         /* zs needs to be ended */
+  bool           endf;          /* Stream end seen (Inflater) or written (Deflater) */
+  z_stream       zs[1];
+};
+typedef struct ovm_obj_zstream *ovm_obj_zstream_t;
+
+static inline ovm_obj_zstream_t ovm_obj_zstream(ovm_obj_t obj)
+{
+  return ((ovm_obj_zstream_t) obj);
+}
+
+static ovm_obj_zstream_t ovm_inst_zstreamval(ovm_thread_t th, ovm_inst_t inst)
+{
+  ovm_obj_class_t cl = ovm_inst_of_raw(inst);
+  if (!(cl == ovm_obj_class(deflater_class) || cl == ovm_obj_class(inflater_class)))  ovm_except_inv_value(th, inst);
+
+  return (ovm_obj_zstream(inst->objval));
+}
+
+static void zstream_mark(ovm_obj_t obj)
+{
+  ovm_obj_mark(ovm_obj_zstream(obj)->sink);
+}
+
+static void zstream_cleanup(ovm_obj_t obj)
+{
+  ovm_obj_zstream_t z = ovm_obj_zstream(obj);
+  if (!z->initf)  return;
+  if (z->inflatef) {
+    inflateEnd(z->zs);
+  } else {
+    deflateEnd(z->zs);
+  }
+  z->initf = false;
+}
+
+static void zstream_free(ovm_obj_t obj)
+{
+  ovm_obj_release(ovm_obj_zstream(obj)->sink);
+  zstream_cleanup(obj);
+}
+
+static void zstream_init(ovm_obj_t obj, va_list ap)
+{
+  ovm_obj_zstream_t z = ovm_obj_zstream(obj);
+  memset(obj + 1, 0, sizeof(*z) - sizeof(*obj));
+  z->inflatef = va_arg(ap, int);
+}
+
+static ovm_obj_zstream_t zstream_newc(ovm_inst_t dst, bool inflatef)
+{
+  return (ovm_obj_zstream(ovm_obj_alloc(dst, sizeof(struct ovm_obj_zstream), ovm_obj_class(inflatef ? inflater_class : deflater_class), OVM_MEM_ALLOC_NO_HINT, zstream_init, inflatef)));
+}
+
+/* A stream for one-shot (de)compression, held in a Deflater or Inflater
+   with no sink, so that, if an exception is raised before the stream is
+   ended, it is ended when the holder is collected.  Ending a stream twice,
+   or one whose init failed, is harmless.
+*/
+
+static z_stream *zstream_oneshot(ovm_inst_t dst, bool inflatef)
+{
+  ovm_obj_zstream_t z = zstream_newc(dst, inflatef);
+  z->initf = true;
+
+  return (z->zs);
+}
+
+static ovm_obj_zstream_t zstream_new(ovm_thread_t th, ovm_inst_t dst, ovm_inst_t argv, bool inflatef)
+{
+  ovm_inst_t sink = &argv[1];
+  if (sink->type != OVM_INST_TYPE_OBJ || sink->objval == 0)  ovm_except_inv_value(th, sink);
+
+  ovm_inst_t work = ovm_stack_alloc(th, 1);
+
+  ovm_obj_zstream_t z = zstream_newc(&work[-1], inflatef);
+  ovm_obj_assign(&z->sink, sink->objval);
+  ovm_inst_assign(dst, &work[-1]);
+
+  ovm_stack_unwind(th, work);
+
+  return (z);
+}
+
+static int format_arg(ovm_thread_t th, unsigned argc, ovm_inst_t argv, unsigned i, int dflt)
+{
+  if (argc <= i)  return (dflt);
+  ovm_intval_t fmt = ovm_inst_intval(th, &argv[i]);
+  if (!(fmt == ZLIB_FORMAT_ZLIB || fmt == ZLIB_FORMAT_GZIP || fmt == ZLIB_FORMAT_RAW
+        || (fmt == ZLIB_FORMAT_AUTO && dflt == ZLIB_FORMAT_AUTO)
+        )
+      ) {
+    ovm_except_inv_value(th, &argv[i]);
+  }
+
+  return (fmt);
+}
+
+/* Write the given bytes to the sink, as a Bytearray */
+
+static void zstream_emit(ovm_thread_t th, ovm_obj_zstream_t z, unsigned size, const unsigned char *data)
+{
+  if (size == 0)  return;
+
+  ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+  ovm_inst_assign_obj(&work[-2], z->sink);
+  barray_newc(th, &work[-1], size, data);
+  ovm_method_callsch(th, &work[-2], OVM_STR_CONST_HASH(write), 2);
+
+  ovm_stack_unwind(th, work);
+}
+
+/* Run the stream over the given input, with the given flush mode, writing
+   all output produced to the sink
+*/
+
+static void zstream_run(ovm_thread_t th, ovm_inst_t recvr, ovm_obj_zstream_t z, unsigned size, const unsigned char *data, int flush)
+{
+  if (z->endf)  ovm_except_inv_value(th, recvr);
+
+  unsigned char buf[ZLIB_CHUNK_SIZE];
+  z->zs->next_in  = (unsigned char *) data;
+  z->zs->avail_in = size;
+  for (;;) {
+    z->zs->next_out  = buf;
+    z->zs->avail_out = sizeof(buf);
+    int rc = z->inflatef ? inflate(z->zs, flush) : deflate(z->zs, flush);
+    if (!(rc == Z_OK || rc == Z_BUF_ERROR || rc == Z_STREAM_END))  ovm_except_inv_value(th, recvr);
+    zstream_emit(th, z, sizeof(buf) - z->zs->avail_out, buf);
+    if (rc == Z_STREAM_END) {
+      z->endf = true;
+
+      return;
+    }
+    /* Output space left over => all input consumed, or flush done */
+    if (z->zs->avail_out != 0)  return;
+  }
+}
+
+/* Not a byte-writing call -- the usual printable form, from Object */
+
+static void zstream_repr(ovm_thread_t th, ovm_inst_t dst, ovm_inst_t recvr)
+{
+  ovm_inst_t work = ovm_stack_alloc(th, 2);
+
+  ovm_inst_assign_obj(&work[-2], ovm_consts.Object);
+  ovm_str_newc(&work[-1], OVM_STR_CONST(write));
+  ovm_method_callsch(th, &work[-2], OVM_STR_CONST_HASH(method), 2);
+  ovm_inst_assign(&work[-1], recvr);
+  ovm_method_callsch(th, dst, OVM_STR_CONST_HASH(call), 2);
+
+  ovm_stack_unwind(th, work);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Deflater
+
+/* new(sink[, level[, format]]), format being one of #FORMAT_ZLIB (default),
+   #FORMAT_GZIP or #FORMAT_RAW
+*/
+
+CM_DECL(new)
+{
+  ovm_method_argc_chk_range(th, 2, 4);
+  int level = level_arg(th, argc, argv, 2);
+  int fmt   = format_arg(th, argc, argv, 3, ZLIB_FORMAT_ZLIB);
+  ovm_obj_zstream_t z = zstream_new(th, dst, argv, false);
+  if (deflateInit2(z->zs, level, Z_DEFLATED, fmt, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    ovm_inst_assign_obj(dst, 0);
+
+    return;
+  }
+  z->initf = true;
+}
+
+/* write(bytes) -- compress bytes, writing any output to the sink */
+
+CM_DECL(write)
+{
+  if (argc == 1) {
+    zstream_repr(th, dst, &argv[0]);
+
+    return;
+  }
+  ovm_method_argc_chk_exact(th, 2);
+  ovm_obj_zstream_t z = ovm_inst_zstreamval(th, &argv[0]);
+  unsigned size;
+  const unsigned char *data;
+  if (!ovm_inst_bytes(&argv[1], &size, &data))  ovm_except_inv_value(th, &argv[1]);
+  zstream_run(th, &argv[0], z, size, data, Z_NO_FLUSH);
+  ovm_inst_assign(dst, &argv[0]);
+}
+
+/* Write all input so far to the sink, so that it can be decompressed
+   without waiting for more
+*/
+
+CM_DECL(flush)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  ovm_obj_zstream_t z = ovm_inst_zstreamval(th, &argv[0]);
+  zstream_run(th, &argv[0], z, 0, 0, Z_SYNC_FLUSH);
+  ovm_inst_assign(dst, &argv[0]);
+}
+
+/* Finish the stream, writing the rest of the output, e.g. the trailer */
+
+CM_DECL(close)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  ovm_obj_zstream_t z = ovm_inst_zstreamval(th, &argv[0]);
+  if (!z->endf)  zstream_run(th, &argv[0], z, 0, 0, Z_FINISH);
+  zstream_cleanup(z->base);
+  ovm_inst_assign(dst, &argv[0]);
+}
+
+/* Number of bytes input and output so far */
+
+CM_DECL(size_in)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  ovm_int_newc(dst, ovm_inst_zstreamval(th, &argv[0])->zs->total_in);
+}
+
+CM_DECL(size_out)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  ovm_int_newc(dst, ovm_inst_zstreamval(th, &argv[0])->zs->total_out);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Inflater
+
+/* new(sink[, format]), format being one of #FORMAT_AUTO (default, zlib or
+   gzip), #FORMAT_ZLIB, #FORMAT_GZIP or #FORMAT_RAW
+*/
+
+CM_DECL(new)
+{
+  ovm_method_argc_chk_range(th, 2, 3);
+  int fmt = format_arg(th, argc, argv, 2, ZLIB_FORMAT_AUTO);
+  ovm_obj_zstream_t z = zstream_new(th, dst, argv, true);
+  if (inflateInit2(z->zs, fmt) != Z_OK) {
+    ovm_inst_assign_obj(dst, 0);
+
+    return;
+  }
+  z->initf = true;
+}
+
+/* Whether the end of the compressed stream has been seen */
+
+CM_DECL(end)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  ovm_bool_newc(dst, ovm_inst_zstreamval(th, &argv[0])->endf);
+}
+
+/* Finish; the stream must have ended */
+
+CM_DECL(close)
+{
+  ovm_method_argc_chk_exact(th, 1);
+  ovm_obj_zstream_t z = ovm_inst_zstreamval(th, &argv[0]);
+  if (!z->endf)  ovm_except_inv_value(th, &argv[0]);
+  zstream_cleanup(z->base);
+  ovm_inst_assign(dst, &argv[0]);
+}
+
+/***************************************************************************/
+
+static struct {
+  unsigned   nm_size;
+  const char *nm;
+  unsigned   hash;
+  int        val;
+  bool       inflatef;          /* Inflater only */
+} class_vars[] = {
+  { _OVM_STR_CONST_HASH("#FORMAT_ZLIB"), ZLIB_FORMAT_ZLIB, false },
+  { _OVM_STR_CONST_HASH("#FORMAT_GZIP"), ZLIB_FORMAT_GZIP, false },
+  { _OVM_STR_CONST_HASH("#FORMAT_RAW"),  ZLIB_FORMAT_RAW,  false },
+  { _OVM_STR_CONST_HASH("#FORMAT_AUTO"), ZLIB_FORMAT_AUTO, true },
+  { _OVM_STR_CONST_HASH("#Z_NO_COMPRESSION"),      Z_NO_COMPRESSION,      false },
+  { _OVM_STR_CONST_HASH("#Z_BEST_SPEED"),          Z_BEST_SPEED,          false },
+  { _OVM_STR_CONST_HASH("#Z_BEST_COMPRESSION"),    Z_BEST_COMPRESSION,    false },
+  { _OVM_STR_CONST_HASH("#Z_DEFAULT_COMPRESSION"), Z_DEFAULT_COMPRESSION, false }
+};
+
+/* Class on top of stack */
+
+static void class_vars_init(ovm_thread_t th, bool inflatef)
+{
+  ovm_inst_t work = ovm_stack_alloc(th, 3);
+
+  unsigned i;
+  for (i = 0; i < ARRAY_SIZE(class_vars); ++i) {
+    if (class_vars[i].inflatef && !inflatef)  continue;
+    ovm_inst_assign(&work[-3], &work[0]);
+    ovm_str_newch(&work[-2], class_vars[i].nm_size, class_vars[i].nm, class_vars[i].hash);
+    ovm_int_newc(&work[-1], class_vars[i].val);
+    ovm_method_callsch(th, &work[-1], OVM_STR_CONST_HASH(atput), 3);
+  }
+
+  ovm_stack_unwind(th, work);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Bytearray
+
+static void bytes_methods_add(ovm_thread_t th, ovm_obj_t cl)
+{
+  ovm_stack_push_obj(th, cl);
+
+  ovm_method_add(th, OVM_STR_CONST_HASH(deflate), METHOD_NAME(deflate));
+  ovm_method_add(th, OVM_STR_CONST_HASH(gzip),    METHOD_NAME(gzip));
+  ovm_method_add(th, OVM_STR_CONST_HASH(inflate), METHOD_NAME(inflate));
+  ovm_method_add(th, OVM_STR_CONST_HASH(crc32),   METHOD_NAME(crc32));
+  ovm_method_add(th, OVM_STR_CONST_HASH(adler32), METHOD_NAME(adler32));
+  ovm_method_add(th, OVM_STR_CONST_HASH(crc32c),  METHOD_NAME(crc32c));
+
+  ovm_stack_free(th, 1);
+}
+
+static void bytes_methods_del(ovm_obj_class_t cl)
+{
+  ovm_method_del(cl, OVM_STR_CONST_HASH(deflate));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(gzip));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(inflate));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(crc32));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(adler32));
+  ovm_method_del(cl, OVM_STR_CONST_HASH(crc32c));
+}
+
+/* Module on top of stack */
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Deflater
+
+static void deflater_class_init(ovm_thread_t th)
+{
+  ovm_inst_t old = th->sp;
+
+  ovm_stack_push(th, th->sp);
+  ovm_stack_push_obj(th, ovm_consts.Object);
+  ovm_class_new(th, OVM_STR_CONST_HASH(Deflater), zstream_mark, zstream_free, zstream_cleanup);
+  deflater_class = th->sp->objval;
+  class_vars_init(th, false);
+
+  ovm_classmethod_add(th, OVM_STR_CONST_HASH(new), METHOD_NAME(new));
+  ovm_method_add(th, OVM_STR_CONST_HASH(write),    METHOD_NAME(write));
+  ovm_method_add(th, OVM_STR_CONST_HASH(String),   METHOD_NAME(write));
+  ovm_method_add(th, OVM_STR_CONST_HASH(flush),    METHOD_NAME(flush));
+  ovm_method_add(th, OVM_STR_CONST_HASH(close),    METHOD_NAME(close));
+  ovm_method_add(th, OVM_STR_CONST_HASH(size_in),  METHOD_NAME(size_in));
+  ovm_method_add(th, OVM_STR_CONST_HASH(size_out), METHOD_NAME(size_out));
+
+  ovm_stack_unwind(th, old);
+}
+
+#undef  METHOD_CLASS
+#define METHOD_CLASS  Inflater
+
+static void inflater_class_init(ovm_thread_t th)
+{
+  ovm_inst_t old = th->sp;
+
+  ovm_stack_push(th, th->sp);
+  ovm_stack_push_obj(th, ovm_consts.Object);
+  ovm_class_new(th, OVM_STR_CONST_HASH(Inflater), zstream_mark, zstream_free, zstream_cleanup);
+  inflater_class = th->sp->objval;
+  class_vars_init(th, true);
+
+  ovm_classmethod_add(th, OVM_STR_CONST_HASH(new), METHOD_NAME(new));
+  ovm_method_add(th, OVM_STR_CONST_HASH(write),    zlib$Deflater$write);
+  ovm_method_add(th, OVM_STR_CONST_HASH(String),   zlib$Deflater$write);
+  ovm_method_add(th, OVM_STR_CONST_HASH(end),      METHOD_NAME(end));
+  ovm_method_add(th, OVM_STR_CONST_HASH(close),    METHOD_NAME(close));
+  ovm_method_add(th, OVM_STR_CONST_HASH(size_in),  zlib$Deflater$size_in);
+  ovm_method_add(th, OVM_STR_CONST_HASH(size_out), zlib$Deflater$size_out);
+
+  ovm_stack_unwind(th, old);
+}
+
+void __zlib_init__(ovm_thread_t th, ovm_inst_t dst, unsigned argc, ovm_inst_t argv)
+{
+  ovm_inst_t old = th->sp;
+
+  crc32c_tbl_init();
+#if defined(__x86_64__) && defined(__GNUC__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2"))  crc32c_func = crc32c_hw;
+#endif
+
+  bytes_methods_add(th, ovm_consts.Bytearray);
+  bytes_methods_add(th, ovm_consts.Byteslice);
+
+  ovm_stack_push(th, &argv[0]);
+  deflater_class_init(th);
+  inflater_class_init(th);
+
+  ovm_stack_unwind(th, old);
+}
+
+void __zlib_fini__(void)
+{
+  bytes_methods_del(OVM_CL_BYTEARRAY);
+  bytes_methods_del(OVM_CL_BYTESLICE);
+}